@@ -0,0 +1,375 @@
+#include "asset_bundle.hpp"
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace assets
+{
+    namespace
+    {
+        std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        void write_padding(core::io::OutputStream& stream, std::uint64_t count)
+        {
+            static constexpr std::array<std::byte, 64> zeros{};
+            for (; count >= zeros.size(); count -= zeros.size())
+            {
+                stream.write_value(zeros);
+            }
+
+            for (; count > 0; --count)
+            {
+                stream.write_value(std::byte{0});
+            }
+        }
+
+        void write_bytes(core::io::OutputStream& stream, std::span<std::byte const> bytes)
+        {
+            std::array<std::byte, 64> block;
+            for (; bytes.size() >= block.size(); bytes = bytes.subspan(block.size()))
+            {
+                std::memcpy(block.data(), bytes.data(), block.size());
+                stream.write_value(block);
+            }
+
+            for (auto byte : bytes)
+            {
+                stream.write_value(byte);
+            }
+        }
+
+        std::uint64_t toc_size(std::uint64_t entry_count)
+        {
+            return entry_count * sizeof(BundleEntry);
+        }
+
+        bool entry_less(BundleEntry const& entry,
+                        std::tuple<std::uint64_t, std::array<char, 4>> const& key)
+        {
+            return std::tie(entry.name_hash, entry.type) < key;
+        }
+    } // namespace
+
+    std::uint64_t hash_name(std::string_view name)
+    {
+        // 64-bit FNV-1a.
+        std::uint64_t hash{14695981039346656037ull};
+        for (char c : name)
+        {
+            hash ^= static_cast<std::uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    AssetBundleWriter::AssetBundleWriter(ChunkCodec codec) :
+        m_codec{codec}
+    {}
+
+    void AssetBundleWriter::add(std::string_view name, AssetFile file)
+    {
+        m_entries.push_back({hash_name(name), std::move(file)});
+    }
+
+    std::size_t AssetBundleWriter::size() const
+    {
+        return m_entries.size();
+    }
+
+    void AssetBundleWriter::save(core::io::OutputStream& stream) const
+    {
+        std::vector<std::size_t> order(m_entries.size());
+        for (std::size_t i{0}; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+
+        std::sort(order.begin(), order.end(), [this](std::size_t lhs, std::size_t rhs) {
+            auto const& a = m_entries[lhs];
+            auto const& b = m_entries[rhs];
+            return std::tie(a.name_hash, a.file.type)
+                   < std::tie(b.name_hash, b.file.type);
+        });
+
+        for (std::size_t i{1}; i < order.size(); ++i)
+        {
+            auto const& prev = m_entries[order[i - 1]];
+            auto const& cur  = m_entries[order[i]];
+            if (prev.name_hash == cur.name_hash && prev.file.type == cur.file.type)
+            {
+                throw std::runtime_error{"error: duplicate entry found in bundle"};
+            }
+        }
+
+        // Small entries are serialised up front, both to train the dictionary on and
+        // to be compressed against it.
+        std::vector<std::vector<std::byte>> payloads(order.size());
+        std::vector<std::span<std::byte const>> samples;
+        if (m_codec.codec != Codec::none)
+        {
+            for (std::size_t i{0}; i < order.size(); ++i)
+            {
+                auto const& file = m_entries[order[i]].file;
+                if (file.size() <= small_entry_size)
+                {
+                    payloads[i] = file.to_bytes();
+                    samples.push_back(payloads[i]);
+                }
+            }
+        }
+
+        std::vector<std::byte> dictionary_bytes;
+        if (samples.size() >= min_dictionary_samples)
+        {
+            dictionary_bytes = CodecDictionary::train(samples, max_dictionary_size);
+        }
+
+        std::unique_ptr<CodecDictionary> dictionary;
+        if (!dictionary_bytes.empty())
+        {
+            dictionary = std::make_unique<CodecDictionary>(m_codec, dictionary_bytes);
+        }
+
+        // Entries that don't shrink are stored as-is after all.
+        for (auto& payload : payloads)
+        {
+            if (payload.empty())
+            {
+                continue;
+            }
+
+            std::vector<std::byte> compressed;
+            if (dictionary)
+            {
+                dictionary->compress(payload, compressed);
+            }
+
+            payload = (!compressed.empty() && compressed.size() < payload.size())
+                          ? std::move(compressed)
+                          : std::vector<std::byte>{};
+        }
+
+        ChunkCodec compressed_codec{Codec::none};
+        if (dictionary)
+        {
+            compressed_codec = dictionary->codec();
+        }
+
+        BundleHeader header;
+        header.type              = BundleHeader::magic;
+        header.version           = BundleHeader::current_version;
+        header.entry_count       = static_cast<std::uint32_t>(m_entries.size());
+        header.page_size         = BundleHeader::default_page_size;
+        header.toc_offset        = sizeof(BundleHeader);
+        header.dictionary_offset = header.toc_offset + toc_size(m_entries.size());
+        header.dictionary_size   = static_cast<std::uint32_t>(dictionary_bytes.size());
+        header.dictionary_codec  = compressed_codec;
+
+        std::vector<BundleEntry> toc;
+        toc.reserve(m_entries.size());
+
+        std::uint64_t offset = header.dictionary_offset + header.dictionary_size;
+        for (std::size_t i{0}; i < order.size(); ++i)
+        {
+            auto const& pending = m_entries[order[i]];
+            auto const& payload = payloads[i];
+
+            BundleEntry entry;
+            entry.type              = pending.file.type;
+            entry.codec             = ChunkCodec{Codec::none};
+            entry.name_hash         = pending.name_hash;
+            entry.offset            = align_up(offset, header.page_size);
+            entry.size              = pending.file.size();
+            entry.uncompressed_size = pending.file.size();
+            if (!payload.empty())
+            {
+                entry.codec  = compressed_codec;
+                entry.offset = offset;
+                entry.size   = payload.size();
+            }
+            toc.push_back(entry);
+
+            offset = entry.offset + entry.size;
+        }
+
+        stream.write_value(header);
+        for (auto const& entry : toc)
+        {
+            stream.write_value(entry);
+        }
+        write_bytes(stream, dictionary_bytes);
+
+        std::uint64_t position = header.dictionary_offset + header.dictionary_size;
+        for (std::size_t i{0}; i < toc.size(); ++i)
+        {
+            write_padding(stream, toc[i].offset - position);
+            if (payloads[i].empty())
+            {
+                m_entries[order[i]].file.save(stream);
+            }
+            else
+            {
+                write_bytes(stream, payloads[i]);
+            }
+            position = toc[i].offset + toc[i].size;
+        }
+    }
+
+    AssetBundle::AssetBundle(std::filesystem::path const& path) :
+        m_file{path}
+    {
+        auto bytes = m_file.bytes();
+        if (bytes.size() < sizeof(BundleHeader))
+        {
+            auto msg = fmt::format("error: {} is not a valid bundle", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        std::memcpy(&m_header, bytes.data(), sizeof(BundleHeader));
+        if (m_header.type != BundleHeader::magic)
+        {
+            auto msg = fmt::format("error: {} is not a valid bundle", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        if (m_header.version != BundleHeader::current_version)
+        {
+            auto msg = fmt::format("error: incompatible bundle version found, expected "
+                                   "version {} but got version {}",
+                                   BundleHeader::current_version,
+                                   m_header.version);
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        if (m_header.toc_offset + toc_size(m_header.entry_count) > bytes.size())
+        {
+            throw std::runtime_error{"error: bundle table of contents is truncated"};
+        }
+
+        m_entries.resize(m_header.entry_count);
+        std::memcpy(m_entries.data(),
+                    bytes.data() + m_header.toc_offset,
+                    toc_size(m_header.entry_count));
+
+        // The dictionary is loaded once here rather than for every entry.
+        if (m_header.dictionary_size != 0)
+        {
+            if (m_header.dictionary_offset + m_header.dictionary_size > bytes.size())
+            {
+                throw std::runtime_error{"error: bundle dictionary is truncated"};
+            }
+
+            validate_codec(m_header.dictionary_codec);
+            m_dictionary = std::make_unique<CodecDictionary>(
+                m_header.dictionary_codec,
+                bytes.subspan(m_header.dictionary_offset, m_header.dictionary_size));
+        }
+    }
+
+    std::span<BundleEntry const> AssetBundle::entries() const
+    {
+        return m_entries;
+    }
+
+    std::optional<BundleEntry> AssetBundle::find(std::array<char, 4> const& type,
+                                                 std::uint64_t name_hash) const
+    {
+        auto key = std::make_tuple(name_hash, type);
+        auto it  = std::lower_bound(m_entries.begin(), m_entries.end(), key, entry_less);
+        if (it == m_entries.end() || it->name_hash != name_hash || it->type != type)
+        {
+            return {};
+        }
+
+        return *it;
+    }
+
+    std::optional<BundleEntry> AssetBundle::find(std::array<char, 4> const& type,
+                                                 std::string_view name) const
+    {
+        return find(type, hash_name(name));
+    }
+
+    AssetFileView AssetBundle::view(BundleEntry const& entry) const
+    {
+        if (entry.codec.codec != Codec::none)
+        {
+            throw std::runtime_error{"error: compressed bundle entries cannot be viewed "
+                                     "in place"};
+        }
+
+        return AssetFileView::load(payload(entry));
+    }
+
+    std::vector<std::byte> AssetBundle::decompress(BundleEntry const& entry) const
+    {
+        auto bytes = payload(entry);
+        if (entry.codec.codec == Codec::none)
+        {
+            return {bytes.begin(), bytes.end()};
+        }
+
+        if (!m_dictionary || m_dictionary->codec().codec != entry.codec.codec)
+        {
+            throw std::runtime_error{"error: unsupported bundle entry compression"};
+        }
+
+        std::vector<std::byte> file(entry.uncompressed_size);
+        if (m_dictionary->decompress(bytes, file) != file.size())
+        {
+            throw std::runtime_error{"error: failed de-compressing bundle entry"};
+        }
+
+        return file;
+    }
+
+    void AssetBundle::prefetch(BundleEntry const& entry) const
+    {
+        m_file.prefetch(entry.offset, entry.size);
+    }
+
+    void AssetBundle::prefetch(std::span<BundleEntry const> entries) const
+    {
+        std::vector<BundleEntry> sorted{entries.begin(), entries.end()};
+        std::sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) {
+            return a.offset < b.offset;
+        });
+
+        if (sorted.empty())
+        {
+            return;
+        }
+
+        auto start = sorted.front().offset;
+        auto end   = start;
+        for (auto const& entry : sorted)
+        {
+            if (entry.offset > end + m_header.page_size)
+            {
+                m_file.prefetch(start, end - start);
+                start = entry.offset;
+            }
+            end = std::max(end, entry.offset + entry.size);
+        }
+
+        m_file.prefetch(start, end - start);
+    }
+
+    std::span<std::byte const> AssetBundle::payload(BundleEntry const& entry) const
+    {
+        auto bytes = m_file.bytes();
+        if (entry.offset + entry.size > bytes.size())
+        {
+            throw std::runtime_error{"error: bundle entry is out of bounds"};
+        }
+
+        return bytes.subspan(entry.offset, entry.size);
+    }
+} // namespace assets
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "asset_file.hpp"
+#include "codec.hpp"
+#include "mapped_file.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+namespace assets
+{
+    std::uint64_t hash_name(std::string_view name);
+
+    // On-disk layout of a bundle:
+    // * BundleHeader.
+    // * Table of contents: entry_count BundleEntry records sorted by (name_hash, type).
+    // * The dictionary shared by the compressed entries, if there are any.
+    // * Payloads. A payload is a serialised AssetFile, so stored payloads can be parsed
+    //   in place with AssetFileView::load. Those start on a page_size boundary, while
+    //   compressed payloads are packed back to back.
+    struct BundleHeader
+    {
+        static constexpr std::array<char, 4> magic{'K', 'B', 'D', 'L'};
+        static constexpr std::uint32_t current_version{2};
+        static constexpr std::uint32_t default_page_size{4096};
+
+        std::array<char, 4> type;
+        std::uint32_t version;
+        std::uint32_t entry_count;
+        std::uint32_t page_size;
+        std::uint64_t toc_offset;
+        std::uint64_t dictionary_offset;
+        std::uint32_t dictionary_size;
+        ChunkCodec dictionary_codec;
+    };
+
+    struct BundleEntry
+    {
+        std::array<char, 4> type;
+        // Entries that aren't stored as-is are compressed against the bundle dictionary.
+        ChunkCodec codec;
+        std::uint64_t name_hash;
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint64_t uncompressed_size;
+    };
+
+    static_assert(sizeof(BundleHeader) == 40);
+    static_assert(sizeof(BundleEntry) == 40);
+
+    class AssetBundleWriter
+    {
+    public:
+        // Small assets (materials, prefabs, low mips) compress poorly on their own, so
+        // entries up to small_entry_size bytes are compressed with the writer's codec
+        // against a dictionary trained on all of them.
+        static constexpr std::size_t small_entry_size{4096};
+        static constexpr std::size_t min_dictionary_samples{8};
+        static constexpr std::size_t max_dictionary_size{16 * 1024};
+
+        AssetBundleWriter(ChunkCodec codec = {Codec::none});
+
+        void add(std::string_view name, AssetFile file);
+        void save(core::io::OutputStream& stream) const;
+
+        std::size_t size() const;
+
+    private:
+        struct PendingEntry
+        {
+            std::uint64_t name_hash;
+            AssetFile file;
+        };
+
+        ChunkCodec m_codec;
+        std::vector<PendingEntry> m_entries;
+    };
+
+    class AssetBundle
+    {
+    public:
+        AssetBundle(std::filesystem::path const& path);
+
+        std::span<BundleEntry const> entries() const;
+
+        std::optional<BundleEntry> find(std::array<char, 4> const& type,
+                                        std::uint64_t name_hash) const;
+        std::optional<BundleEntry> find(std::array<char, 4> const& type,
+                                        std::string_view name) const;
+
+        // Only entries stored as-is can be viewed in place. decompress() works for all
+        // entries and returns the serialised AssetFile.
+        AssetFileView view(BundleEntry const& entry) const;
+        std::vector<std::byte> decompress(BundleEntry const& entry) const;
+        void prefetch(BundleEntry const& entry) const;
+        // Faults in many entries in file order, merging entries less than a page apart
+        // into a single read.
+        void prefetch(std::span<BundleEntry const> entries) const;
+
+    private:
+        std::span<std::byte const> payload(BundleEntry const& entry) const;
+
+        MappedFile m_file;
+        BundleHeader m_header;
+        std::vector<BundleEntry> m_entries;
+        std::unique_ptr<CodecDictionary> m_dictionary;
+    };
+} // namespace assets
@@ -2,14 +2,87 @@
 
 #include <fmt/printf.h>
 
+#include <cstring>
+
 namespace assets
 {
+    namespace
+    {
+        void check_version(std::uint32_t version)
+        {
+            if (version != AssetFile::current_version)
+            {
+                std::string msg =
+                    fmt::format("error: incompatible version found, expected "
+                                "version {} but got version {}",
+                                AssetFile::current_version,
+                                version);
+                throw std::runtime_error{msg.c_str()};
+            }
+        }
+
+        // Mirrors the layout written by core::io::OutputStream: values are stored as raw
+        // bytes and buffers are prefixed by their size in bytes as a std::size_t.
+        class ByteReader
+        {
+        public:
+            ByteReader(std::span<std::byte const> bytes) :
+                m_bytes{bytes}
+            {}
+
+            std::span<std::byte const> read_bytes(std::size_t count)
+            {
+                if (count > m_bytes.size() - m_offset)
+                {
+                    throw std::runtime_error{"error: unexpected end of asset file"};
+                }
+
+                auto bytes = m_bytes.subspan(m_offset, count);
+                m_offset += count;
+                return bytes;
+            }
+
+            template<typename T>
+            T read_value()
+            {
+                T value;
+                std::memcpy(&value, read_bytes(sizeof(T)).data(), sizeof(T));
+                return value;
+            }
+
+            std::span<std::byte const> read_buffer()
+            {
+                return read_bytes(read_value<std::size_t>());
+            }
+
+        private:
+            std::span<std::byte const> m_bytes;
+            std::size_t m_offset{0};
+        };
+    } // namespace
+
+    AssetFileView AssetFileView::load(std::span<std::byte const> bytes)
+    {
+        ByteReader reader{bytes};
+
+        AssetFileView view;
+        view.type    = reader.read_value<std::array<char, 4>>();
+        view.version = reader.read_value<std::uint32_t>();
+        check_version(view.version);
+
+        view.metadata    = reader.read_buffer();
+        view.binary_blob = reader.read_buffer();
+        return view;
+    }
+
     std::size_t AssetFile::size() const
     {
         std::size_t size{0};
         size += 4;                     // type.
         size += sizeof(std::uint32_t); // version.
-        size += json.size();           // JSON metadata.
+        size += sizeof(std::size_t);   // Metadata size.
+        size += metadata.size();       // Metadata.
+        size += sizeof(std::size_t);   // Binary data size.
         size += binary_blob.size();    // Binary data.
         return size;
     }
@@ -18,25 +91,46 @@ namespace assets
     {
         stream.write_four_cc(type);
         stream.write_value(version);
-        stream.write_buffer(json);
+        stream.write_buffer(metadata);
         stream.write_buffer(binary_blob);
     }
 
+    std::vector<std::byte> AssetFile::to_bytes() const
+    {
+        std::vector<std::byte> bytes(size());
+        auto out   = bytes.data();
+        auto write = [&out](void const* data, std::size_t count) {
+            if (count != 0)
+            {
+                std::memcpy(out, data, count);
+            }
+            out += count;
+        };
+
+        std::size_t metadata_size = metadata.size();
+        std::size_t blob_size     = binary_blob.size();
+        write(type.data(), type.size());
+        write(&version, sizeof(version));
+        write(&metadata_size, sizeof(metadata_size));
+        write(metadata.data(), metadata_size);
+        write(&blob_size, sizeof(blob_size));
+        write(binary_blob.data(), blob_size);
+
+        return bytes;
+    }
+
     void AssetFile::load(core::io::InputStream& stream)
     {
         type    = stream.read_four_cc();
         version = stream.read_value<std::uint32_t>();
+        check_version(version);
 
-        if (version != current_version)
-        {
-            std::string msg = fmt::format("error: incompatible version found, expected "
-                                          "version {} but got version {}",
-                                          current_version,
-                                          version);
-            throw std::runtime_error{msg.c_str()};
-        }
-
-        json        = stream.read_buffer<std::string>();
+        metadata    = stream.read_buffer<std::vector<std::byte>>();
         binary_blob = stream.read_buffer<std::vector<std::byte>>();
     }
+
+    AssetFileView AssetFile::view() const
+    {
+        return {type, version, metadata, binary_blob};
+    }
 } // namespace assets
@@ -4,29 +4,43 @@
 #include <core/io/output_stream.hpp>
 
 #include <array>
+#include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace assets
 {
-    enum class CompressionMode
+    // Non-owning view over a serialised asset file. The metadata and the binary blob
+    // point straight into the source bytes (usually a MappedFile), so nothing is copied
+    // until the asset itself is unpacked.
+    struct AssetFileView
     {
-        none = 0,
-        lz4
+        static AssetFileView load(std::span<std::byte const> bytes);
+
+        std::array<char, 4> type;
+        std::uint32_t version;
+        std::span<std::byte const> metadata;
+        std::span<std::byte const> binary_blob;
     };
 
     struct AssetFile
     {
-        static constexpr auto current_version{1};
+        static constexpr auto current_version{11};
 
         std::size_t size() const;
 
         void save(core::io::OutputStream& stream) const;
         void load(core::io::InputStream& stream);
 
+        // The bytes save() writes, for files that are stored inside other containers.
+        std::vector<std::byte> to_bytes() const;
+
+        AssetFileView view() const;
+
         std::array<char, 4> type;
         std::uint32_t version;
-        std::string json;
+        std::vector<std::byte> metadata;
         std::vector<std::byte> binary_blob;
     };
 } // namespace assets
@@ -0,0 +1,54 @@
+#include "asset_json.hpp"
+#include "dependency_manifest.hpp"
+#include "material_asset.hpp"
+#include "mesh_asset.hpp"
+#include "prefab_asset.hpp"
+#include "texture_asset.hpp"
+
+#include <fmt/printf.h>
+
+namespace assets
+{
+    std::string dump_json(AssetFileView const& file)
+    {
+        static constexpr std::array<char, 4> mesh_type{'M', 'E', 'S', 'H'};
+        static constexpr std::array<char, 4> texture_type{'T', 'E', 'X', 'I'};
+        static constexpr std::array<char, 4> material_type{'M', 'A', 'T', 'X'};
+        static constexpr std::array<char, 4> prefab_type{'P', 'R', 'F', 'B'};
+
+        if (file.type == mesh_type)
+        {
+            MeshAsset mesh;
+            mesh.read(file);
+            return mesh.to_json();
+        }
+        else if (file.type == texture_type)
+        {
+            TextureAsset texture;
+            texture.read(file);
+            return texture.to_json();
+        }
+        else if (file.type == material_type)
+        {
+            MaterialAsset material;
+            material.read(file);
+            return material.to_json();
+        }
+        else if (file.type == prefab_type)
+        {
+            PrefabAsset prefab;
+            prefab.read(file);
+            return prefab.to_json();
+        }
+        else if (file.type == DependencyManifest::type)
+        {
+            DependencyManifest manifest;
+            manifest.read(file);
+            return manifest.to_json();
+        }
+
+        auto msg = fmt::format("error: unknown asset type {}",
+                               std::string_view{file.type.data(), file.type.size()});
+        throw std::runtime_error{msg.c_str()};
+    }
+} // namespace assets
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "asset_file.hpp"
+
+#include <string>
+
+namespace assets
+{
+    // Debug/export helper: decodes the binary metadata of any known asset type and
+    // returns it as a JSON document. Not used on the loading path.
+    std::string dump_json(AssetFileView const& file);
+} // namespace assets
@@ -0,0 +1,435 @@
+#include "asset_loader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace assets
+{
+    namespace
+    {
+        // I/O stage: map the source and fault its bytes in.
+        std::shared_ptr<void const> fetch(AssetSource const& source)
+        {
+            if (auto path = std::get_if<std::filesystem::path>(&source); path)
+            {
+                auto file = std::make_shared<MappedFile const>(*path);
+                file->prefetch(0, file->size());
+                return file;
+            }
+
+            auto& bundle_source = std::get<BundleSource>(source);
+            bundle_source.bundle->prefetch(bundle_source.entry);
+            return bundle_source.bundle;
+        }
+
+        void prefetch_sources(std::vector<AssetSource> const& sources)
+        {
+            std::vector<std::filesystem::path> paths;
+            std::unordered_map<AssetBundle const*, std::vector<BundleEntry>> entries;
+            for (auto const& source : sources)
+            {
+                if (auto path = std::get_if<std::filesystem::path>(&source); path)
+                {
+                    paths.push_back(*path);
+                }
+                else
+                {
+                    auto& bundle_source = std::get<BundleSource>(source);
+                    entries[bundle_source.bundle.get()].push_back(bundle_source.entry);
+                }
+            }
+
+            std::sort(paths.begin(), paths.end());
+            paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+            for (auto const& path : paths)
+            {
+                MappedFile file{path};
+                file.prefetch(0, file.size());
+            }
+
+            for (auto const& [bundle, bundle_entries] : entries)
+            {
+                bundle->prefetch(bundle_entries);
+            }
+        }
+
+        // Worker stage: parse the asset header out of the resident bytes. Compressed
+        // bundle entries are decompressed first, and the copy replaces the bundle as
+        // the storage.
+        AssetFileView parse(AssetSource const& source,
+                            std::shared_ptr<void const>& storage)
+        {
+            if (std::holds_alternative<std::filesystem::path>(source))
+            {
+                auto file = static_cast<MappedFile const*>(storage.get());
+                return AssetFileView::load(file->bytes());
+            }
+
+            auto& bundle_source = std::get<BundleSource>(source);
+            if (bundle_source.entry.codec.codec == Codec::none)
+            {
+                return bundle_source.bundle->view(bundle_source.entry);
+            }
+
+            auto bytes = std::make_shared<std::vector<std::byte> const>(
+                bundle_source.bundle->decompress(bundle_source.entry));
+            storage = bytes;
+            return AssetFileView::load(*bytes);
+        }
+    } // namespace
+
+    std::vector<AssetSource>
+    dependency_sources(std::shared_ptr<AssetBundle const> const& bundle,
+                       std::span<DependencyManifest::Dependency const> dependencies)
+    {
+        std::vector<AssetSource> sources;
+        sources.reserve(dependencies.size());
+        for (auto const& dependency : dependencies)
+        {
+            if (auto entry = bundle->find(dependency.type, dependency.name_hash); entry)
+            {
+                sources.push_back(BundleSource{bundle, *entry});
+            }
+        }
+
+        return sources;
+    }
+
+    bool AssetLoader::QueueKey::operator<(QueueKey const& other) const
+    {
+        // Highest priority first, first come first served within a priority.
+        if (priority != other.priority)
+        {
+            return priority > other.priority;
+        }
+
+        return sequence < other.sequence;
+    }
+
+    AssetLoader::AssetLoader(std::size_t num_io_threads, std::size_t num_worker_threads)
+    {
+        num_io_threads     = std::max<std::size_t>(num_io_threads, 1);
+        num_worker_threads = std::max<std::size_t>(num_worker_threads, 1);
+
+        for (std::size_t i{0}; i < num_io_threads; ++i)
+        {
+            m_io_threads.emplace_back([this]() {
+                io_loop();
+            });
+        }
+
+        for (std::size_t i{0}; i < num_worker_threads; ++i)
+        {
+            m_worker_threads.emplace_back([this]() {
+                worker_loop();
+            });
+        }
+    }
+
+    AssetLoader::~AssetLoader()
+    {
+        {
+            std::scoped_lock lock{m_mutex};
+            m_stop = true;
+        }
+
+        m_io_condition.notify_all();
+        m_work_condition.notify_all();
+
+        for (auto& thread : m_io_threads)
+        {
+            thread.join();
+        }
+
+        for (auto& thread : m_worker_threads)
+        {
+            thread.join();
+        }
+
+        // Anything still queued will never run, so let the callers know.
+        for (auto& [_, job] : m_jobs)
+        {
+            job.on_complete({LoadStatus::cancelled, {}, nullptr});
+        }
+    }
+
+    AssetLoader::Ticket AssetLoader::load(Request request)
+    {
+        Job job;
+        job.request = std::move(request);
+        return enqueue_ticket(std::move(job));
+    }
+
+    AssetLoader::Handle AssetLoader::load(Request request, Completion on_complete)
+    {
+        // It is called from a worker thread, or while cancelling, where throwing
+        // bad_function_call would take the whole process down.
+        if (!on_complete)
+        {
+            throw std::runtime_error{"error: asset load needs a completion callback"};
+        }
+
+        Job job;
+        job.request     = std::move(request);
+        job.on_complete = std::move(on_complete);
+        return enqueue(std::move(job));
+    }
+
+    AssetLoader::Ticket AssetLoader::prefetch(std::vector<AssetSource> sources,
+                                              int priority)
+    {
+        Job job;
+        job.request.priority = priority;
+        job.prefetch_only    = true;
+        job.batch            = std::move(sources);
+        return enqueue_ticket(std::move(job));
+    }
+
+    AssetLoader::Ticket AssetLoader::enqueue_ticket(Job job)
+    {
+        auto promise = std::make_shared<std::promise<LoadedAsset>>();
+        auto future  = promise->get_future();
+
+        job.on_complete = [promise](LoadResult result) {
+            switch (result.status)
+            {
+            case LoadStatus::loaded:
+                promise->set_value(std::move(result.asset));
+                break;
+
+            case LoadStatus::cancelled:
+                promise->set_exception(std::make_exception_ptr(
+                    std::runtime_error{"error: asset load was cancelled"}));
+                break;
+
+            case LoadStatus::failed:
+                promise->set_exception(result.error);
+                break;
+            }
+        };
+
+        auto handle = enqueue(std::move(job));
+        return {handle, std::move(future)};
+    }
+
+    AssetLoader::Handle AssetLoader::enqueue(Job job)
+    {
+        Handle handle;
+        {
+            std::scoped_lock lock{m_mutex};
+            handle = m_next_handle++;
+
+            job.state    = JobState::queued_io;
+            job.sequence = m_next_sequence++;
+
+            m_io_queue.insert(make_key(handle, job));
+            m_jobs.emplace(handle, std::move(job));
+        }
+
+        m_io_condition.notify_one();
+        return handle;
+    }
+
+    bool AssetLoader::cancel(Handle handle)
+    {
+        std::unique_lock lock{m_mutex};
+        auto it = m_jobs.find(handle);
+        if (it == m_jobs.end())
+        {
+            return false;
+        }
+
+        auto& job = it->second;
+        switch (job.state)
+        {
+        case JobState::queued_io:
+            m_io_queue.erase(make_key(handle, job));
+            break;
+
+        case JobState::queued_work:
+            m_work_queue.erase(make_key(handle, job));
+            break;
+
+        case JobState::in_io:
+        case JobState::in_work:
+            job.cancelled = true;
+            return true;
+        }
+
+        auto node = m_jobs.extract(it);
+        lock.unlock();
+
+        node.mapped().on_complete({LoadStatus::cancelled, {}, nullptr});
+        return true;
+    }
+
+    bool AssetLoader::reprioritise(Handle handle, int priority)
+    {
+        std::scoped_lock lock{m_mutex};
+        auto it = m_jobs.find(handle);
+        if (it == m_jobs.end())
+        {
+            return false;
+        }
+
+        auto& job = it->second;
+        auto* queue =
+            (job.state == JobState::queued_io)     ? &m_io_queue
+            : (job.state == JobState::queued_work) ? &m_work_queue
+                                                   : nullptr;
+
+        if (queue != nullptr)
+        {
+            queue->erase(make_key(handle, job));
+        }
+
+        job.request.priority = priority;
+
+        if (queue != nullptr)
+        {
+            queue->insert(make_key(handle, job));
+        }
+
+        return true;
+    }
+
+    AssetLoader::QueueKey AssetLoader::make_key(Handle handle, Job const& job) const
+    {
+        return {job.request.priority, job.sequence, handle};
+    }
+
+    void AssetLoader::io_loop()
+    {
+        for (;;)
+        {
+            Handle handle;
+            AssetSource source;
+            bool prefetch_only;
+            std::vector<AssetSource> batch;
+            {
+                std::unique_lock lock{m_mutex};
+                m_io_condition.wait(lock, [this]() {
+                    return m_stop || !m_io_queue.empty();
+                });
+
+                if (m_stop)
+                {
+                    return;
+                }
+
+                handle = m_io_queue.begin()->handle;
+                m_io_queue.erase(m_io_queue.begin());
+
+                auto& job     = m_jobs.at(handle);
+                job.state     = JobState::in_io;
+                source        = job.request.source;
+                prefetch_only = job.prefetch_only;
+                batch         = std::move(job.batch);
+            }
+
+            LoadResult result{LoadStatus::loaded, {}, nullptr};
+            try
+            {
+                if (prefetch_only)
+                {
+                    prefetch_sources(batch);
+                }
+                else
+                {
+                    result.asset.storage = fetch(source);
+                }
+            }
+            catch (...)
+            {
+                result.status = LoadStatus::failed;
+                result.error  = std::current_exception();
+            }
+
+            {
+                std::unique_lock lock{m_mutex};
+                auto& job = m_jobs.at(handle);
+                if (job.cancelled)
+                {
+                    result.status = LoadStatus::cancelled;
+                }
+                else if (result.status == LoadStatus::loaded && !prefetch_only)
+                {
+                    job.asset = std::move(result.asset);
+                    job.state = JobState::queued_work;
+                    m_work_queue.insert(make_key(handle, job));
+
+                    lock.unlock();
+                    m_work_condition.notify_one();
+                    continue;
+                }
+            }
+
+            finish(handle, std::move(result));
+        }
+    }
+
+    void AssetLoader::worker_loop()
+    {
+        for (;;)
+        {
+            Handle handle;
+            AssetSource source;
+            Processor process;
+            LoadResult result{LoadStatus::loaded, {}, nullptr};
+            {
+                std::unique_lock lock{m_mutex};
+                m_work_condition.wait(lock, [this]() {
+                    return m_stop || !m_work_queue.empty();
+                });
+
+                if (m_stop)
+                {
+                    return;
+                }
+
+                handle = m_work_queue.begin()->handle;
+                m_work_queue.erase(m_work_queue.begin());
+
+                auto& job    = m_jobs.at(handle);
+                job.state    = JobState::in_work;
+                source       = job.request.source;
+                process      = job.request.process;
+                result.asset = std::move(job.asset);
+            }
+
+            try
+            {
+                result.asset.file = parse(source, result.asset.storage);
+                if (process)
+                {
+                    process(result.asset.file);
+                }
+            }
+            catch (...)
+            {
+                result.status = LoadStatus::failed;
+                result.error  = std::current_exception();
+            }
+
+            {
+                std::scoped_lock lock{m_mutex};
+                if (m_jobs.at(handle).cancelled)
+                {
+                    result.status = LoadStatus::cancelled;
+                }
+            }
+
+            finish(handle, std::move(result));
+        }
+    }
+
+    void AssetLoader::finish(Handle handle, LoadResult result)
+    {
+        std::unique_lock lock{m_mutex};
+        auto node = m_jobs.extract(handle);
+        lock.unlock();
+
+        node.mapped().on_complete(std::move(result));
+    }
+} // namespace assets
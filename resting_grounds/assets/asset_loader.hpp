@@ -0,0 +1,152 @@
+#pragma once
+
+#include "asset_bundle.hpp"
+#include "dependency_manifest.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+
+namespace assets
+{
+    struct BundleSource
+    {
+        std::shared_ptr<AssetBundle const> bundle;
+        BundleEntry entry;
+    };
+
+    using AssetSource = std::variant<std::filesystem::path, BundleSource>;
+
+    // Sources for the dependencies of a manifest root, skipping any that the bundle
+    // doesn't contain.
+    std::vector<AssetSource>
+    dependency_sources(std::shared_ptr<AssetBundle const> const& bundle,
+                       std::span<DependencyManifest::Dependency const> dependencies);
+
+    struct LoadedAsset
+    {
+        // Owns the bytes that file points into: the mapping, or the decompressed copy of
+        // a compressed bundle entry.
+        std::shared_ptr<void const> storage;
+        AssetFileView file;
+    };
+
+    enum class LoadStatus
+    {
+        loaded,
+        cancelled,
+        failed
+    };
+
+    struct LoadResult
+    {
+        LoadStatus status;
+        LoadedAsset asset;
+        std::exception_ptr error;
+    };
+
+    // Two-stage asynchronous loader. The I/O stage maps the source and faults its bytes
+    // in, the worker stage parses the asset header and runs the request's processing
+    // step (typically read() and unpack()). Both stages pick the highest priority
+    // request first, so I/O for one asset overlaps with decompression of another.
+    class AssetLoader
+    {
+    public:
+        using Handle     = std::uint64_t;
+        using Processor  = std::function<void(AssetFileView const&)>;
+        using Completion = std::function<void(LoadResult)>;
+
+        struct Request
+        {
+            AssetSource source;
+            int priority{0};
+            Processor process;
+        };
+
+        struct Ticket
+        {
+            Handle handle;
+            std::future<LoadedAsset> future;
+        };
+
+        AssetLoader(std::size_t num_io_threads     = 2,
+                    std::size_t num_worker_threads = std::thread::hardware_concurrency());
+        ~AssetLoader();
+
+        AssetLoader(AssetLoader const&)            = delete;
+        AssetLoader& operator=(AssetLoader const&) = delete;
+
+        Ticket load(Request request);
+        // Throws if on_complete is empty.
+        Handle load(Request request, Completion on_complete);
+
+        // Faults every source in with a single I/O job, reading loose files in path order
+        // and the entries of each bundle in offset order with neighbours merged. The
+        // ticket completes with an empty asset once they are resident, so that the loads
+        // that follow don't wait on the disk.
+        Ticket prefetch(std::vector<AssetSource> sources, int priority = 0);
+
+        // Both return false if the request has already completed. Cancelling a request
+        // that is mid-stage takes effect once that stage finishes.
+        bool cancel(Handle handle);
+        bool reprioritise(Handle handle, int priority);
+
+    private:
+        enum class JobState
+        {
+            queued_io,
+            in_io,
+            queued_work,
+            in_work
+        };
+
+        struct Job
+        {
+            Request request;
+            Completion on_complete;
+            JobState state;
+            std::uint64_t sequence;
+            bool cancelled{false};
+            LoadedAsset asset;
+            // Prefetch jobs have no worker stage and carry their sources here instead.
+            bool prefetch_only{false};
+            std::vector<AssetSource> batch;
+        };
+
+        struct QueueKey
+        {
+            int priority;
+            std::uint64_t sequence;
+            Handle handle;
+
+            bool operator<(QueueKey const& other) const;
+        };
+
+        Ticket enqueue_ticket(Job job);
+        Handle enqueue(Job job);
+        QueueKey make_key(Handle handle, Job const& job) const;
+        void io_loop();
+        void worker_loop();
+        void finish(Handle handle, LoadResult result);
+
+        std::mutex m_mutex;
+        std::condition_variable m_io_condition;
+        std::condition_variable m_work_condition;
+        std::set<QueueKey> m_io_queue;
+        std::set<QueueKey> m_work_queue;
+        std::unordered_map<Handle, Job> m_jobs;
+        Handle m_next_handle{1};
+        std::uint64_t m_next_sequence{0};
+        bool m_stop{false};
+
+        std::vector<std::thread> m_io_threads;
+        std::vector<std::thread> m_worker_threads;
+    };
+} // namespace assets
@@ -0,0 +1,306 @@
+#include "bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ASSETS_BOUNDS_SSE
+#    include <immintrin.h>
+#endif
+
+namespace assets
+{
+    namespace
+    {
+        struct PositionStream
+        {
+            PositionStream(std::span<std::byte const> positions, std::size_t stride) :
+                data{positions.data()},
+                stride{stride}
+            {
+                if (stride < sizeof(Vector3D<float>))
+                {
+                    throw std::runtime_error{"error: position stride is too small"};
+                }
+
+                count = positions.size() / stride;
+
+                // The vector paths load 16 bytes per position, so they stop at the last
+                // element whose load stays inside the buffer and leave the rest to the
+                // scalar tail.
+                if (positions.size() >= 16)
+                {
+                    simd_count = std::min(count, (positions.size() - 16) / stride + 1);
+                }
+            }
+
+            Vector3D<float> operator[](std::size_t i) const
+            {
+                Vector3D<float> position;
+                std::memcpy(position.data(), data + i * stride, sizeof(position));
+                return position;
+            }
+
+            std::byte const* data;
+            std::size_t stride;
+            std::size_t count{0};
+            std::size_t simd_count{0};
+        };
+
+        float distance2(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            float dx = a[0] - b[0];
+            float dy = a[1] - b[1];
+            float dz = a[2] - b[2];
+            return dx * dx + dy * dy + dz * dz;
+        }
+
+#if defined(ASSETS_BOUNDS_SSE)
+        // The fourth lane holds whatever follows the position and is never used.
+        __m128 load_position(PositionStream const& stream, std::size_t i)
+        {
+            auto ptr = stream.data + i * stream.stride;
+            return _mm_loadu_ps(reinterpret_cast<float const*>(ptr));
+        }
+#endif
+
+#if defined(__AVX__)
+        __m256 load_positions(PositionStream const& stream, std::size_t i)
+        {
+            return _mm256_insertf128_ps(
+                _mm256_castps128_ps256(load_position(stream, i)),
+                load_position(stream, i + 1),
+                1);
+        }
+#endif
+
+        BoundingBox box_kernel(PositionStream const& stream)
+        {
+            BoundingBox box;
+            box.min.fill(std::numeric_limits<float>::max());
+            box.max.fill(std::numeric_limits<float>::lowest());
+
+            std::size_t i{0};
+#if defined(ASSETS_BOUNDS_SSE)
+            __m128 lo = _mm_set1_ps(std::numeric_limits<float>::max());
+            __m128 hi = _mm_set1_ps(std::numeric_limits<float>::lowest());
+
+#    if defined(__AVX__)
+            {
+                // Two positions per register and four independent accumulators so the
+                // min/max latency overlaps with the loads.
+                auto lo0 = _mm256_set1_ps(std::numeric_limits<float>::max());
+                auto hi0 = _mm256_set1_ps(std::numeric_limits<float>::lowest());
+                auto lo1 = lo0;
+                auto hi1 = hi0;
+                auto lo2 = lo0;
+                auto hi2 = hi0;
+                auto lo3 = lo0;
+                auto hi3 = hi0;
+
+                for (; i + 8 <= stream.simd_count; i += 8)
+                {
+                    auto p0 = load_positions(stream, i);
+                    auto p1 = load_positions(stream, i + 2);
+                    auto p2 = load_positions(stream, i + 4);
+                    auto p3 = load_positions(stream, i + 6);
+
+                    lo0 = _mm256_min_ps(lo0, p0);
+                    hi0 = _mm256_max_ps(hi0, p0);
+                    lo1 = _mm256_min_ps(lo1, p1);
+                    hi1 = _mm256_max_ps(hi1, p1);
+                    lo2 = _mm256_min_ps(lo2, p2);
+                    hi2 = _mm256_max_ps(hi2, p2);
+                    lo3 = _mm256_min_ps(lo3, p3);
+                    hi3 = _mm256_max_ps(hi3, p3);
+                }
+
+                auto lo_all =
+                    _mm256_min_ps(_mm256_min_ps(lo0, lo1), _mm256_min_ps(lo2, lo3));
+                auto hi_all =
+                    _mm256_max_ps(_mm256_max_ps(hi0, hi1), _mm256_max_ps(hi2, hi3));
+
+                lo = _mm_min_ps(_mm256_castps256_ps128(lo_all),
+                                _mm256_extractf128_ps(lo_all, 1));
+                hi = _mm_max_ps(_mm256_castps256_ps128(hi_all),
+                                _mm256_extractf128_ps(hi_all, 1));
+            }
+#    endif
+
+            for (; i < stream.simd_count; ++i)
+            {
+                auto p = load_position(stream, i);
+                lo     = _mm_min_ps(lo, p);
+                hi     = _mm_max_ps(hi, p);
+            }
+
+            alignas(16) std::array<float, 4> lanes;
+            _mm_store_ps(lanes.data(), lo);
+            std::copy_n(lanes.begin(), 3, box.min.begin());
+            _mm_store_ps(lanes.data(), hi);
+            std::copy_n(lanes.begin(), 3, box.max.begin());
+#endif
+
+            for (; i < stream.count; ++i)
+            {
+                auto p = stream[i];
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    box.min[k] = std::min(box.min[k], p[k]);
+                    box.max[k] = std::max(box.max[k], p[k]);
+                }
+            }
+
+            return box;
+        }
+
+        // Calls visit(i) for every point that may lie farther than sqrt(limit) from
+        // centre. The visitor does the exact test itself and is free to move the centre
+        // or raise the limit, which later batches pick up.
+        template<typename Visit>
+        void visit_outliers(PositionStream const& stream,
+                            [[maybe_unused]] Vector3D<float> const& centre,
+                            [[maybe_unused]] float const& limit,
+                            Visit&& visit)
+        {
+            std::size_t i{0};
+#if defined(ASSETS_BOUNDS_SSE)
+            for (; i + 4 <= stream.simd_count; i += 4)
+            {
+                auto x = load_position(stream, i);
+                auto y = load_position(stream, i + 1);
+                auto z = load_position(stream, i + 2);
+                auto w = load_position(stream, i + 3);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                x = _mm_sub_ps(x, _mm_set1_ps(centre[0]));
+                y = _mm_sub_ps(y, _mm_set1_ps(centre[1]));
+                z = _mm_sub_ps(z, _mm_set1_ps(centre[2]));
+
+                auto d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+                                     _mm_mul_ps(z, z));
+                if (_mm_movemask_ps(_mm_cmpgt_ps(d2, _mm_set1_ps(limit))) != 0)
+                {
+                    for (std::size_t j{i}; j < i + 4; ++j)
+                    {
+                        visit(j);
+                    }
+                }
+            }
+#endif
+
+            for (; i < stream.count; ++i)
+            {
+                visit(i);
+            }
+        }
+
+        std::size_t farthest_from(PositionStream const& stream,
+                                  Vector3D<float> const& point,
+                                  float& max_distance2)
+        {
+            std::size_t index{0};
+            max_distance2 = -1.0f;
+            visit_outliers(stream, point, max_distance2, [&](std::size_t i) {
+                float d2 = distance2(stream[i], point);
+                if (d2 > max_distance2)
+                {
+                    max_distance2 = d2;
+                    index         = i;
+                }
+            });
+
+            return index;
+        }
+
+        Vector3D<float> box_centre(BoundingBox const& box)
+        {
+            return {(box.min[0] + box.max[0]) * 0.5f,
+                    (box.min[1] + box.max[1]) * 0.5f,
+                    (box.min[2] + box.max[2]) * 0.5f};
+        }
+    } // namespace
+
+    BoundingBox compute_bounding_box(std::span<std::byte const> positions,
+                                     std::size_t stride)
+    {
+        PositionStream stream{positions, stride};
+        if (stream.count == 0)
+        {
+            return {};
+        }
+
+        return box_kernel(stream);
+    }
+
+    BoundingSphere compute_bounding_sphere(std::span<std::byte const> positions,
+                                           std::size_t stride)
+    {
+        return compute_bounding_sphere(positions,
+                                       stride,
+                                       compute_bounding_box(positions, stride));
+    }
+
+    BoundingSphere compute_bounding_sphere(std::span<std::byte const> positions,
+                                           std::size_t stride,
+                                           BoundingBox const& box)
+    {
+        PositionStream stream{positions, stride};
+        if (stream.count == 0)
+        {
+            return {};
+        }
+
+        // The farthest point from the box centre gives the fallback sphere, and the
+        // point farthest from that one gives Ritter's initial diameter.
+        auto centre = box_centre(box);
+        float centre_distance2{0.0f};
+        auto a = stream[farthest_from(stream, centre, centre_distance2)];
+
+        float diameter2{0.0f};
+        auto b = stream[farthest_from(stream, a, diameter2)];
+
+        BoundingSphere sphere;
+        for (std::size_t k{0}; k < 3; ++k)
+        {
+            sphere.centre[k] = (a[k] + b[k]) * 0.5f;
+        }
+        sphere.radius = std::sqrt(diameter2) * 0.5f;
+
+        // Grow the sphere just enough to reach every point left outside it.
+        float radius2 = sphere.radius * sphere.radius;
+        visit_outliers(stream, sphere.centre, radius2, [&](std::size_t i) {
+            auto p   = stream[i];
+            float d2 = distance2(p, sphere.centre);
+            if (d2 <= radius2)
+            {
+                return;
+            }
+
+            float d      = std::sqrt(d2);
+            float radius = (sphere.radius + d) * 0.5f;
+            float t      = (radius - sphere.radius) / d;
+            for (std::size_t k{0}; k < 3; ++k)
+            {
+                sphere.centre[k] += (p[k] - sphere.centre[k]) * t;
+            }
+
+            sphere.radius = radius;
+            radius2       = radius * radius;
+        });
+
+        // Moving the centre rounds, which can leave earlier points a few ulps outside.
+        sphere.radius *= 1.0f + 8.0f * std::numeric_limits<float>::epsilon();
+
+        float centre_radius = std::sqrt(centre_distance2);
+        if (centre_radius < sphere.radius)
+        {
+            return {centre, centre_radius};
+        }
+
+        return sphere;
+    }
+} // namespace assets
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <span>
+
+namespace assets
+{
+    struct BoundingBox
+    {
+        Vector3D<float> min;
+        Vector3D<float> max;
+    };
+
+    struct BoundingSphere
+    {
+        Vector3D<float> centre;
+        float radius;
+    };
+
+    // Both functions read a stream of elements that are stride bytes apart and start
+    // with three packed floats (e.g. an interleaved vertex buffer whose first attribute
+    // is the position). Neither requires the data to be aligned.
+    BoundingBox compute_bounding_box(std::span<std::byte const> positions,
+                                     std::size_t stride);
+
+    // Ritter's sphere seeded from the box centre. The result is never larger than the
+    // sphere centred on the box that encloses every point.
+    BoundingSphere compute_bounding_sphere(std::span<std::byte const> positions,
+                                           std::size_t stride);
+    BoundingSphere compute_bounding_sphere(std::span<std::byte const> positions,
+                                           std::size_t stride,
+                                           BoundingBox const& box);
+} // namespace assets
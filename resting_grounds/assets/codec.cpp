@@ -0,0 +1,532 @@
+#include "codec.hpp"
+
+#include <core/memory_buffer.hpp>
+
+#include <fmt/printf.h>
+#include <lz4.h>
+#include <lz4hc.h>
+#include <zdict.h>
+#include <zstd.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+namespace assets
+{
+    namespace
+    {
+        // ZDICT refuses to produce anything smaller.
+        static constexpr std::size_t min_dictionary_size{256};
+
+        std::size_t store_bound(std::size_t size)
+        {
+            return size;
+        }
+
+        std::size_t store_compress(std::span<std::byte const> source,
+                                   std::span<std::byte> destination,
+                                   int)
+        {
+            std::memcpy(destination.data(), source.data(), source.size());
+            return source.size();
+        }
+
+        std::size_t store_decompress(std::span<std::byte const> source,
+                                     std::span<std::byte> destination)
+        {
+            if (source.size() > destination.size())
+            {
+                throw std::runtime_error{"error: failed de-compressing buffer"};
+            }
+
+            std::memcpy(destination.data(), source.data(), source.size());
+            return source.size();
+        }
+
+        void check_lz4_size(std::size_t size)
+        {
+            if (size > LZ4_MAX_INPUT_SIZE)
+            {
+                throw std::runtime_error{"error: buffer is too large for LZ4"};
+            }
+        }
+
+        std::size_t lz4_bound(std::size_t size)
+        {
+            check_lz4_size(size);
+            return static_cast<std::size_t>(LZ4_compressBound(static_cast<int>(size)));
+        }
+
+        int lz4_capacity(std::span<std::byte> destination)
+        {
+            auto capacity = std::min<std::size_t>(destination.size(),
+                                                  std::numeric_limits<int>::max());
+            return static_cast<int>(capacity);
+        }
+
+        std::size_t lz4_compress(std::span<std::byte const> source,
+                                 std::span<std::byte> destination,
+                                 int)
+        {
+            check_lz4_size(source.size());
+            int size = LZ4_compress_default(core::to_const_data_ptr(source),
+                                            core::to_data_ptr(destination),
+                                            static_cast<int>(source.size()),
+                                            lz4_capacity(destination));
+            if (size <= 0)
+            {
+                throw std::runtime_error{"error: failed compressing buffer"};
+            }
+
+            return static_cast<std::size_t>(size);
+        }
+
+        std::size_t lz4hc_compress(std::span<std::byte const> source,
+                                   std::span<std::byte> destination,
+                                   int level)
+        {
+            check_lz4_size(source.size());
+            int size = LZ4_compress_HC(core::to_const_data_ptr(source),
+                                       core::to_data_ptr(destination),
+                                       static_cast<int>(source.size()),
+                                       lz4_capacity(destination),
+                                       level);
+            if (size <= 0)
+            {
+                throw std::runtime_error{"error: failed compressing buffer"};
+            }
+
+            return static_cast<std::size_t>(size);
+        }
+
+        // LZ4HC writes plain LZ4 blocks, so both share the decoder.
+        std::size_t lz4_decompress(std::span<std::byte const> source,
+                                   std::span<std::byte> destination)
+        {
+            check_lz4_size(source.size());
+            int size = LZ4_decompress_safe(core::to_const_data_ptr(source),
+                                           core::to_data_ptr(destination),
+                                           static_cast<int>(source.size()),
+                                           lz4_capacity(destination));
+            if (size < 0)
+            {
+                throw std::runtime_error{"error: failed de-compressing buffer"};
+            }
+
+            return static_cast<std::size_t>(size);
+        }
+
+        // Contexts are expensive to create relative to decoding a small chunk, so each
+        // thread keeps one around.
+        ZSTD_CCtx* zstd_compress_context()
+        {
+            thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context{
+                ZSTD_createCCtx(),
+                &ZSTD_freeCCtx};
+            return context.get();
+        }
+
+        ZSTD_DCtx* zstd_decompress_context()
+        {
+            thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context{
+                ZSTD_createDCtx(),
+                &ZSTD_freeDCtx};
+            return context.get();
+        }
+
+        std::size_t zstd_bound(std::size_t size)
+        {
+            return ZSTD_compressBound(size);
+        }
+
+        std::size_t zstd_compress(std::span<std::byte const> source,
+                                  std::span<std::byte> destination,
+                                  int level)
+        {
+            auto size = ZSTD_compressCCtx(zstd_compress_context(),
+                                          destination.data(),
+                                          destination.size(),
+                                          source.data(),
+                                          source.size(),
+                                          level);
+            if (ZSTD_isError(size))
+            {
+                auto msg = fmt::format("error: failed compressing buffer: {}",
+                                       ZSTD_getErrorName(size));
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            return size;
+        }
+
+        std::size_t zstd_decompress(std::span<std::byte const> source,
+                                    std::span<std::byte> destination)
+        {
+            auto size = ZSTD_decompressDCtx(zstd_decompress_context(),
+                                            destination.data(),
+                                            destination.size(),
+                                            source.data(),
+                                            source.size());
+            if (ZSTD_isError(size))
+            {
+                throw std::runtime_error{"error: failed de-compressing buffer"};
+            }
+
+            return size;
+        }
+    } // namespace
+
+    std::span<CodecInfo const> codecs()
+    {
+        // Indexed by Codec.
+        static std::array<CodecInfo, 4> const registry{{
+            {Codec::none, "none", 0, 0, 0, store_bound, store_compress, store_decompress},
+            {Codec::lz4, "lz4", 0, 0, 0, lz4_bound, lz4_compress, lz4_decompress},
+            {Codec::lz4hc,
+             "lz4hc",
+             LZ4HC_CLEVEL_MIN,
+             LZ4HC_CLEVEL_MAX,
+             LZ4HC_CLEVEL_DEFAULT,
+             lz4_bound,
+             lz4hc_compress,
+             lz4_decompress},
+            {Codec::zstd,
+             "zstd",
+             std::max(ZSTD_minCLevel(), int{std::numeric_limits<std::int16_t>::min()}),
+             ZSTD_maxCLevel(),
+             ZSTD_CLEVEL_DEFAULT,
+             zstd_bound,
+             zstd_compress,
+             zstd_decompress},
+        }};
+
+        return registry;
+    }
+
+    CodecInfo const& codec_info(Codec codec)
+    {
+        auto registry = codecs();
+        auto index    = static_cast<std::size_t>(codec);
+        if (index >= registry.size())
+        {
+            auto msg = fmt::format("error: unknown codec {}", index);
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        return registry[index];
+    }
+
+    void validate_codec(ChunkCodec codec)
+    {
+        auto const& info = codec_info(codec.codec);
+        if (codec.level != 0
+            && (codec.level < info.min_level || codec.level > info.max_level))
+        {
+            auto msg = fmt::format("error: invalid level {} for codec {}",
+                                   codec.level,
+                                   info.name);
+            throw std::runtime_error{msg.c_str()};
+        }
+    }
+
+    ChunkCodec parse_codec(std::string_view text)
+    {
+        auto separator = text.find(':');
+        auto name      = text.substr(0, separator);
+
+        for (auto const& info : codecs())
+        {
+            if (info.name != name)
+            {
+                continue;
+            }
+
+            ChunkCodec codec{info.codec, 0};
+            if (separator == std::string_view::npos)
+            {
+                return codec;
+            }
+
+            auto level_text = text.substr(separator + 1);
+            if (info.min_level == info.max_level)
+            {
+                auto msg =
+                    fmt::format("error: codec {} does not take a level", info.name);
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            int level{0};
+            auto [end, ec] = std::from_chars(level_text.data(),
+                                             level_text.data() + level_text.size(),
+                                             level);
+            if (ec != std::errc{} || end != level_text.data() + level_text.size()
+                || level == 0 || level < info.min_level || level > info.max_level)
+            {
+                auto msg = fmt::format("error: invalid level '{}' for codec {}, "
+                                       "expected a non-zero level in [{}, {}]",
+                                       level_text,
+                                       info.name,
+                                       info.min_level,
+                                       info.max_level);
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            codec.level = static_cast<std::int16_t>(level);
+            return codec;
+        }
+
+        auto msg = fmt::format("error: unknown codec '{}'", name);
+        throw std::runtime_error{msg.c_str()};
+    }
+
+    std::string codec_name(ChunkCodec codec)
+    {
+        auto const& info = codec_info(codec.codec);
+        if (codec.level == 0)
+        {
+            return std::string{info.name};
+        }
+
+        return fmt::format("{}:{}", info.name, codec.level);
+    }
+
+    ChunkCodec compress_chunk(ChunkCodec codec,
+                              std::span<std::byte const> source,
+                              std::vector<std::byte>& destination,
+                              float max_ratio)
+    {
+        auto const& info = codec_info(codec.codec);
+        auto level       = codec.level == 0 ? info.default_level : codec.level;
+
+        std::size_t offset = destination.size();
+        destination.resize(offset + info.compress_bound(source.size()));
+        auto size = info.compress(source, std::span{destination}.subspan(offset), level);
+
+        if (codec.codec != Codec::none
+            && static_cast<float>(size) >= static_cast<float>(source.size()) * max_ratio)
+        {
+            destination.resize(offset);
+            destination.insert(destination.end(), source.begin(), source.end());
+            return {Codec::none, 0};
+        }
+
+        destination.resize(offset + size);
+        return {codec.codec, static_cast<std::int16_t>(level)};
+    }
+
+    std::size_t decompress_chunk(Codec codec,
+                                 std::span<std::byte const> source,
+                                 std::span<std::byte> destination)
+    {
+        return codec_info(codec).decompress(source, destination);
+    }
+
+    std::vector<std::byte>
+    CodecDictionary::train(std::span<std::span<std::byte const> const> samples,
+                           std::size_t max_size)
+    {
+        std::vector<std::byte> buffer;
+        std::vector<std::size_t> sizes;
+        sizes.reserve(samples.size());
+        for (auto sample : samples)
+        {
+            buffer.insert(buffer.end(), sample.begin(), sample.end());
+            sizes.push_back(sample.size());
+        }
+
+        // A dictionary much larger than a fraction of what it was trained on mostly
+        // holds noise.
+        auto capacity = std::min(max_size, buffer.size() / 4);
+        if (capacity < min_dictionary_size)
+        {
+            return {};
+        }
+
+        std::vector<std::byte> dictionary(capacity);
+        auto size = ZDICT_trainFromBuffer(dictionary.data(),
+                                          dictionary.size(),
+                                          buffer.data(),
+                                          sizes.data(),
+                                          static_cast<unsigned>(sizes.size()));
+        if (ZDICT_isError(size))
+        {
+            return {};
+        }
+
+        dictionary.resize(size);
+        return dictionary;
+    }
+
+    CodecDictionary::CodecDictionary(ChunkCodec codec,
+                                     std::span<std::byte const> dictionary) :
+        m_codec{codec},
+        m_dictionary{dictionary.begin(), dictionary.end()}
+    {
+        auto const& info = codec_info(codec.codec);
+        if (m_codec.level == 0)
+        {
+            m_codec.level = static_cast<std::int16_t>(info.default_level);
+        }
+
+        if (codec.codec == Codec::zstd)
+        {
+            m_zstd_dictionary =
+                ZSTD_createDDict(m_dictionary.data(), m_dictionary.size());
+            if (m_zstd_dictionary == nullptr)
+            {
+                throw std::runtime_error{"error: invalid compression dictionary"};
+            }
+        }
+    }
+
+    CodecDictionary::~CodecDictionary()
+    {
+        ZSTD_freeDDict(m_zstd_dictionary);
+    }
+
+    ChunkCodec CodecDictionary::codec() const
+    {
+        return m_codec;
+    }
+
+    std::size_t CodecDictionary::compress(std::span<std::byte const> source,
+                                          std::vector<std::byte>& destination) const
+    {
+        auto const& info = codec_info(m_codec.codec);
+
+        std::size_t offset = destination.size();
+        destination.resize(offset + info.compress_bound(source.size()));
+        auto output = std::span{destination}.subspan(offset);
+
+        std::size_t size{0};
+        switch (m_codec.codec)
+        {
+        case Codec::none:
+            size = info.compress(source, output, 0);
+            break;
+
+        case Codec::lz4:
+        {
+            LZ4_stream_t stream;
+            LZ4_initStream(&stream, sizeof(stream));
+            LZ4_loadDict(&stream,
+                         core::to_const_data_ptr(m_dictionary),
+                         static_cast<int>(m_dictionary.size()));
+
+            auto result = LZ4_compress_fast_continue(&stream,
+                                                     core::to_const_data_ptr(source),
+                                                     core::to_data_ptr(output),
+                                                     static_cast<int>(source.size()),
+                                                     lz4_capacity(output),
+                                                     1);
+
+            size = result > 0 ? static_cast<std::size_t>(result) : 0;
+            break;
+        }
+
+        case Codec::lz4hc:
+        {
+            std::unique_ptr<LZ4_streamHC_t, decltype(&LZ4_freeStreamHC)> stream{
+                LZ4_createStreamHC(),
+                &LZ4_freeStreamHC};
+            LZ4_resetStreamHC_fast(stream.get(), m_codec.level);
+            LZ4_loadDictHC(stream.get(),
+                           core::to_const_data_ptr(m_dictionary),
+                           static_cast<int>(m_dictionary.size()));
+
+            auto result = LZ4_compress_HC_continue(stream.get(),
+                                                   core::to_const_data_ptr(source),
+                                                   core::to_data_ptr(output),
+                                                   static_cast<int>(source.size()),
+                                                   lz4_capacity(output));
+
+            size = result > 0 ? static_cast<std::size_t>(result) : 0;
+            break;
+        }
+
+        case Codec::zstd:
+        {
+            auto result = ZSTD_compress_usingDict(zstd_compress_context(),
+                                                  output.data(),
+                                                  output.size(),
+                                                  source.data(),
+                                                  source.size(),
+                                                  m_dictionary.data(),
+                                                  m_dictionary.size(),
+                                                  m_codec.level);
+
+            size = ZSTD_isError(result) ? 0 : result;
+            break;
+        }
+        }
+
+        if (size == 0 && !source.empty())
+        {
+            throw std::runtime_error{"error: failed compressing buffer"};
+        }
+
+        destination.resize(offset + size);
+        return size;
+    }
+
+    std::size_t CodecDictionary::decompress(std::span<std::byte const> source,
+                                            std::span<std::byte> destination) const
+    {
+        switch (m_codec.codec)
+        {
+        case Codec::none:
+            return decompress_chunk(Codec::none, source, destination);
+
+        case Codec::lz4:
+        case Codec::lz4hc:
+        {
+            check_lz4_size(source.size());
+            int size =
+                LZ4_decompress_safe_usingDict(core::to_const_data_ptr(source),
+                                              core::to_data_ptr(destination),
+                                              static_cast<int>(source.size()),
+                                              lz4_capacity(destination),
+                                              core::to_const_data_ptr(m_dictionary),
+                                              static_cast<int>(m_dictionary.size()));
+            if (size < 0)
+            {
+                throw std::runtime_error{"error: failed de-compressing buffer"};
+            }
+
+            return static_cast<std::size_t>(size);
+        }
+
+        case Codec::zstd:
+        {
+            auto size = ZSTD_decompress_usingDDict(zstd_decompress_context(),
+                                                   destination.data(),
+                                                   destination.size(),
+                                                   source.data(),
+                                                   source.size(),
+                                                   m_zstd_dictionary);
+            if (ZSTD_isError(size))
+            {
+                throw std::runtime_error{"error: failed de-compressing buffer"};
+            }
+
+            return size;
+        }
+        }
+
+        throw std::runtime_error{"error: unknown codec"};
+    }
+
+    void decompress_exact(Codec codec,
+                          std::span<std::byte const> source,
+                          std::span<std::byte> destination)
+    {
+        if (decompress_chunk(codec, source, destination) != destination.size())
+        {
+            throw std::runtime_error{"error: failed de-compressing buffer"};
+        }
+    }
+} // namespace assets
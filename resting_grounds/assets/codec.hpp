@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Forward declared so the zstd headers stay out of the interface.
+struct ZSTD_DDict_s;
+
+namespace assets
+{
+    // General-purpose compressors shared by every asset type. LZ4 and LZ4HC produce the
+    // same format and decode at the same speed; LZ4HC and zstd trade packing time for
+    // smaller chunks.
+    enum class Codec : std::uint16_t
+    {
+        none = 0,
+        lz4,
+        lz4hc,
+        zstd
+    };
+
+    // Codec and level a chunk was compressed with. It is stored with every chunk, so
+    // chunks that don't compress can fall back to none without affecting the rest.
+    struct ChunkCodec
+    {
+        Codec codec{Codec::lz4};
+        // 0 selects the codec's default level.
+        std::int16_t level{0};
+    };
+
+    static_assert(sizeof(ChunkCodec) == 4);
+
+    struct CodecInfo
+    {
+        Codec codec;
+        std::string_view name;
+        int min_level;
+        int max_level;
+        int default_level;
+
+        std::size_t (*compress_bound)(std::size_t size);
+        // Both return the number of bytes written to the destination and throw if the
+        // data cannot be processed.
+        std::size_t (*compress)(std::span<std::byte const> source,
+                                std::span<std::byte> destination,
+                                int level);
+        std::size_t (*decompress)(std::span<std::byte const> source,
+                                  std::span<std::byte> destination);
+    };
+
+    std::span<CodecInfo const> codecs();
+    CodecInfo const& codec_info(Codec codec);
+
+    // Throws if a codec read back from a file is not in the registry.
+    void validate_codec(ChunkCodec codec);
+
+    // Parses "name" or "name:level", e.g. "lz4", "lz4hc:12" or "zstd:19".
+    ChunkCodec parse_codec(std::string_view text);
+    std::string codec_name(ChunkCodec codec);
+
+    // Compresses source and appends it to destination. The chunk is stored as-is when
+    // compression doesn't bring it below max_ratio of its size. Returns the codec the
+    // chunk ended up with.
+    ChunkCodec compress_chunk(ChunkCodec codec,
+                              std::span<std::byte const> source,
+                              std::vector<std::byte>& destination,
+                              float max_ratio = 1.0f);
+
+    // Returns the number of bytes written to the destination.
+    std::size_t decompress_chunk(Codec codec,
+                                 std::span<std::byte const> source,
+                                 std::span<std::byte> destination);
+    // Throws unless the chunk decompresses to exactly the size of the destination.
+    void decompress_exact(Codec codec,
+                          std::span<std::byte const> source,
+                          std::span<std::byte> destination);
+
+    // Shared history for many small chunks, so each one can refer back to content common
+    // to all of them instead of starting out empty. zstd digests the dictionary once
+    // when it is loaded, LZ4 and LZ4HC use it as a prefix.
+    class CodecDictionary
+    {
+    public:
+        // Returns an empty dictionary if the samples are too few or too small to train
+        // on.
+        static std::vector<std::byte>
+        train(std::span<std::span<std::byte const> const> samples, std::size_t max_size);
+
+        CodecDictionary(ChunkCodec codec, std::span<std::byte const> dictionary);
+        ~CodecDictionary();
+
+        CodecDictionary(CodecDictionary const&)            = delete;
+        CodecDictionary& operator=(CodecDictionary const&) = delete;
+
+        ChunkCodec codec() const;
+
+        // Appends the compressed source to destination and returns its size.
+        std::size_t compress(std::span<std::byte const> source,
+                             std::vector<std::byte>& destination) const;
+        // Returns the number of bytes written to the destination.
+        std::size_t decompress(std::span<std::byte const> source,
+                               std::span<std::byte> destination) const;
+
+    private:
+        ChunkCodec m_codec;
+        std::vector<std::byte> m_dictionary;
+        ZSTD_DDict_s* m_zstd_dictionary{nullptr};
+    };
+} // namespace assets
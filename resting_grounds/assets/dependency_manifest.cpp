@@ -0,0 +1,154 @@
+#include "dependency_manifest.hpp"
+#include "asset_bundle.hpp"
+#include "metadata.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <tuple>
+
+namespace assets
+{
+    namespace
+    {
+        struct ManifestMetadata
+        {
+            MetadataArray<DependencyManifest::Root> roots;
+            MetadataArray<DependencyManifest::Dependency> dependencies;
+        };
+
+        static_assert(sizeof(DependencyManifest::Root) == 24);
+        static_assert(sizeof(DependencyManifest::Dependency) == 24);
+        static_assert(sizeof(ManifestMetadata) == 16);
+
+        bool root_less(DependencyManifest::Root const& root,
+                       std::tuple<std::uint64_t, std::array<char, 4>> const& key)
+        {
+            return std::tie(root.name_hash, root.type) < key;
+        }
+
+        std::string four_cc(std::array<char, 4> const& type)
+        {
+            return {type.data(), type.size()};
+        }
+    } // namespace
+
+    void DependencyManifest::read(AssetFile const& file)
+    {
+        read(file.view());
+    }
+
+    void DependencyManifest::read(AssetFileView const& file)
+    {
+        MetadataReader reader{file.metadata};
+        auto metadata = reader.header<ManifestMetadata>();
+
+        auto root_entries       = reader.array(metadata.roots);
+        auto dependency_entries = reader.array(metadata.dependencies);
+        for (std::size_t i{0}; i < root_entries.size(); ++i)
+        {
+            auto const& root = root_entries[i];
+            if (std::uint64_t{root.first} + root.count > dependency_entries.size())
+            {
+                throw std::runtime_error{"error: manifest dependencies are out of range"};
+            }
+
+            if (i > 0
+                && !root_less(root_entries[i - 1], std::tie(root.name_hash, root.type)))
+            {
+                throw std::runtime_error{"error: manifest roots are not sorted"};
+            }
+        }
+
+        roots.assign(root_entries.begin(), root_entries.end());
+        dependencies.assign(dependency_entries.begin(), dependency_entries.end());
+    }
+
+    AssetFile DependencyManifest::pack() const
+    {
+        MetadataWriter<ManifestMetadata> writer;
+
+        ManifestMetadata metadata;
+        metadata.roots        = writer.add_array<Root>(roots);
+        metadata.dependencies = writer.add_array<Dependency>(dependencies);
+
+        AssetFile file;
+        file.type     = type;
+        file.version  = AssetFile::current_version;
+        file.metadata = writer.finish(metadata);
+
+        return file;
+    }
+
+    std::string DependencyManifest::to_json() const
+    {
+        std::vector<nlohmann::json> root_list;
+        for (auto const& root : roots)
+        {
+            std::vector<nlohmann::json> dependency_list;
+            for (auto const& dependency : find(root.type, root.name_hash))
+            {
+                nlohmann::json entry;
+                entry["type"]      = four_cc(dependency.type);
+                entry["name_hash"] = dependency.name_hash;
+                entry["size"]      = dependency.size;
+                dependency_list.push_back(entry);
+            }
+
+            nlohmann::json entry;
+            entry["type"]         = four_cc(root.type);
+            entry["name_hash"]    = root.name_hash;
+            entry["dependencies"] = dependency_list;
+            root_list.push_back(entry);
+        }
+
+        nlohmann::json metadata;
+        metadata["roots"] = root_list;
+
+        return metadata.dump(4);
+    }
+
+    void DependencyManifest::add_root(std::array<char, 4> const& root_type,
+                                      std::uint64_t name_hash,
+                                      std::span<Dependency const> root_dependencies)
+    {
+        auto key = std::make_tuple(name_hash, root_type);
+        auto it  = std::lower_bound(roots.begin(), roots.end(), key, root_less);
+        if (it != roots.end() && it->name_hash == name_hash && it->type == root_type)
+        {
+            throw std::runtime_error{"error: manifest root was added twice"};
+        }
+
+        Root root;
+        root.name_hash = name_hash;
+        root.type      = root_type;
+        root.first     = static_cast<std::uint32_t>(dependencies.size());
+        root.count     = static_cast<std::uint32_t>(root_dependencies.size());
+        roots.insert(it, root);
+
+        dependencies.insert(dependencies.end(),
+                            root_dependencies.begin(),
+                            root_dependencies.end());
+    }
+
+    std::span<DependencyManifest::Dependency const>
+    DependencyManifest::find(std::array<char, 4> const& root_type,
+                             std::uint64_t name_hash) const
+    {
+        auto key = std::make_tuple(name_hash, root_type);
+        auto it  = std::lower_bound(roots.begin(), roots.end(), key, root_less);
+        if (it == roots.end() || it->name_hash != name_hash || it->type != root_type)
+        {
+            return {};
+        }
+
+        return std::span{dependencies}.subspan(it->first, it->count);
+    }
+
+    std::span<DependencyManifest::Dependency const>
+    DependencyManifest::find(std::array<char, 4> const& root_type,
+                             std::string_view name) const
+    {
+        return find(root_type, hash_name(name));
+    }
+} // namespace assets
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "asset_file.hpp"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace assets
+{
+    // Transitive closure of the meshes, materials and textures each prefab and material
+    // of a bundle needs, so that a loader can fetch them in one batch instead of
+    // discovering them a read at a time. Assets are named by the hash of their name in
+    // the bundle.
+    struct DependencyManifest
+    {
+        static constexpr std::array<char, 4> type{'D', 'E', 'P', 'S'};
+        // Name of the manifest entry in bundles that have one.
+        static constexpr std::string_view bundle_entry_name{"dependencies.manifest"};
+
+        struct Dependency
+        {
+            std::uint64_t name_hash;
+            // Size of the serialised asset, before any bundle compression.
+            std::uint64_t size;
+            std::array<char, 4> type;
+            std::uint32_t reserved{0};
+        };
+
+        // Root assets own the dependencies [first, first + count).
+        struct Root
+        {
+            std::uint64_t name_hash;
+            std::array<char, 4> type;
+            std::uint32_t first;
+            std::uint32_t count;
+            std::uint32_t reserved{0};
+        };
+
+        void read(AssetFile const& file);
+        void read(AssetFileView const& file);
+        AssetFile pack() const;
+
+        std::string to_json() const;
+
+        void add_root(std::array<char, 4> const& root_type,
+                      std::uint64_t name_hash,
+                      std::span<Dependency const> root_dependencies);
+
+        // Empty for assets that aren't roots of the manifest.
+        std::span<Dependency const> find(std::array<char, 4> const& root_type,
+                                         std::uint64_t name_hash) const;
+        std::span<Dependency const> find(std::array<char, 4> const& root_type,
+                                         std::string_view name) const;
+
+        // Sorted by (name_hash, type).
+        std::vector<Root> roots;
+        std::vector<Dependency> dependencies;
+    };
+} // namespace assets
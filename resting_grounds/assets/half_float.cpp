@@ -0,0 +1,361 @@
+#include "half_float.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ASSETS_HALF_FLOAT_SSE
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+#        define ASSETS_TARGET_F16C
+#    else
+#        define ASSETS_TARGET_F16C __attribute__((target("f16c")))
+#    endif
+#endif
+
+namespace assets
+{
+    namespace
+    {
+        // Halves and both packed RGB formats have a 5-bit exponent biased by 15.
+        static constexpr std::uint32_t small_float_bias{15};
+
+        // Converts to an unsigned float with a 5-bit exponent, rounding to nearest even
+        // the same way as float_to_half().
+        std::uint32_t float_to_small_float(float value, std::uint32_t mantissa_bits)
+        {
+            if (!(value > 0.0f))
+            {
+                return 0;
+            }
+
+            auto bits      = std::bit_cast<std::uint32_t>(value);
+            auto shift     = 23 - mantissa_bits;
+            auto mantissas = (1u << mantissa_bits) - 1;
+
+            // Anything from halfway past the largest finite value would round up to
+            // infinity, which the packed formats clamp instead.
+            auto exponent = (30 - small_float_bias + 127) << 23;
+            if (bits >= (exponent | (mantissas << shift) | (1u << (shift - 1))))
+            {
+                return (30u << mantissa_bits) | mantissas;
+            }
+
+            // Subnormals: the added power of two has the same ulp as the small float.
+            if (bits < ((1 - small_float_bias + 127) << 23))
+            {
+                auto magic = std::bit_cast<float>((136u - mantissa_bits) << 23);
+                return std::bit_cast<std::uint32_t>(value + magic)
+                       - std::bit_cast<std::uint32_t>(magic);
+            }
+
+            std::uint32_t odd = (bits >> shift) & 1;
+            bits += 0xc8000000 + (1u << (shift - 1)) - 1 + odd;
+            return bits >> shift;
+        }
+
+        float small_float_to_float(std::uint32_t value, std::uint32_t mantissa_bits)
+        {
+            auto exponent = value >> mantissa_bits;
+            auto mantissa = value & ((1u << mantissa_bits) - 1);
+            if (exponent == 0)
+            {
+                return std::ldexp(static_cast<float>(mantissa),
+                                  1 - static_cast<int>(small_float_bias + mantissa_bits));
+            }
+
+            auto shifted = mantissa << (23 - mantissa_bits);
+            if (exponent == 0x1f)
+            {
+                return std::bit_cast<float>(0x7f800000 | shifted);
+            }
+
+            return std::bit_cast<float>(((exponent + 112) << 23) | shifted);
+        }
+
+        // rgb9e5 stores mantissas without an implicit leading one, so the largest value
+        // is 511/512 * 2^16.
+        static constexpr std::uint32_t rgb9e5_mantissa_bits{9};
+        static constexpr float rgb9e5_max{65408.0f};
+
+        // 2^(bias + mantissa bits - exponent), which turns a value into its mantissa.
+        float rgb9e5_scale(int exponent)
+        {
+            return std::bit_cast<float>(static_cast<std::uint32_t>(151 - exponent) << 23);
+        }
+
+#if defined(ASSETS_HALF_FLOAT_SSE)
+        bool has_f16c()
+        {
+            static bool const supported = []() {
+#    if defined(_MSC_VER) && !defined(__clang__)
+                // F16C is VEX encoded, so the OS also has to save the AVX registers.
+                int info[4];
+                __cpuid(info, 1);
+                bool f16c    = (info[2] & (1 << 29)) != 0;
+                bool osxsave = (info[2] & (1 << 27)) != 0;
+                return f16c && osxsave && (_xgetbv(0) & 6) == 6;
+#    else
+                return __builtin_cpu_supports("f16c") != 0;
+#    endif
+            }();
+
+            return supported;
+        }
+
+        ASSETS_TARGET_F16C std::size_t float_to_half_f16c(float const* source,
+                                                          std::uint16_t* destination,
+                                                          std::size_t count)
+        {
+            std::size_t i{0};
+            for (; i + 4 <= count; i += 4)
+            {
+                auto floats = _mm_loadu_ps(source + i);
+                auto halves = _mm_cvtps_ph(floats, _MM_FROUND_TO_NEAREST_INT);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i), halves);
+            }
+
+            return i;
+        }
+
+        ASSETS_TARGET_F16C std::size_t half_to_float_f16c(std::uint16_t const* source,
+                                                          float* destination,
+                                                          std::size_t count)
+        {
+            std::size_t i{0};
+            for (; i + 4 <= count; i += 4)
+            {
+                auto halves =
+                    _mm_loadl_epi64(reinterpret_cast<__m128i const*>(source + i));
+                _mm_storeu_ps(destination + i, _mm_cvtph_ps(halves));
+            }
+
+            return i;
+        }
+
+        // Four texels at a time, following float_to_rgb9e5() step by step.
+        std::size_t rgba_to_rgb9e5_sse(float const* rgba,
+                                       std::uint32_t* destination,
+                                       std::size_t count)
+        {
+            auto const zero    = _mm_setzero_ps();
+            auto const largest = _mm_set1_ps(rgb9e5_max);
+            auto const half    = _mm_set1_ps(0.5f);
+
+            auto scale = [](__m128i exponent) {
+                return _mm_castsi128_ps(
+                    _mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(151), exponent), 23));
+            };
+
+            auto round = [&half](__m128 value, __m128 factor) {
+                return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, factor), half));
+            };
+
+            std::size_t i{0};
+            for (; i + 4 <= count; i += 4)
+            {
+                auto r = _mm_loadu_ps(rgba + i * 4);
+                auto g = _mm_loadu_ps(rgba + i * 4 + 4);
+                auto b = _mm_loadu_ps(rgba + i * 4 + 8);
+                auto a = _mm_loadu_ps(rgba + i * 4 + 12);
+                _MM_TRANSPOSE4_PS(r, g, b, a);
+
+                // max(x, 0) returns 0 for NaNs.
+                r = _mm_min_ps(_mm_max_ps(r, zero), largest);
+                g = _mm_min_ps(_mm_max_ps(g, zero), largest);
+                b = _mm_min_ps(_mm_max_ps(b, zero), largest);
+
+                auto maximum  = _mm_max_ps(_mm_max_ps(r, g), b);
+                auto exponent = _mm_sub_epi32(
+                    _mm_srli_epi32(_mm_castps_si128(maximum), 23), _mm_set1_epi32(127));
+                auto above = _mm_cmpgt_epi32(exponent, _mm_set1_epi32(-16));
+                exponent   = _mm_or_si128(_mm_and_si128(above, exponent),
+                                        _mm_andnot_si128(above, _mm_set1_epi32(-16)));
+                exponent   = _mm_add_epi32(exponent, _mm_set1_epi32(16));
+
+                auto carry = _mm_cmpeq_epi32(round(maximum, scale(exponent)),
+                                             _mm_set1_epi32(512));
+                exponent   = _mm_sub_epi32(exponent, carry);
+
+                auto factor = scale(exponent);
+                auto packed = _mm_or_si128(
+                    _mm_or_si128(round(r, factor), _mm_slli_epi32(round(g, factor), 9)),
+                    _mm_or_si128(_mm_slli_epi32(round(b, factor), 18),
+                                 _mm_slli_epi32(exponent, 27)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), packed);
+            }
+
+            return i;
+        }
+#endif
+    } // namespace
+
+    std::uint16_t float_to_half(float value)
+    {
+        auto bits          = std::bit_cast<std::uint32_t>(value);
+        std::uint32_t sign = (bits >> 16) & 0x8000;
+        std::uint32_t abs  = bits & 0x7fffffff;
+
+        // Infinity and NaN, keeping NaNs quiet.
+        if (abs >= 0x7f800000)
+        {
+            std::uint32_t quiet = (abs > 0x7f800000) ? 0x200 : 0;
+            return static_cast<std::uint16_t>(sign | 0x7c00 | quiet);
+        }
+
+        // Anything from 65520 up rounds past the largest half.
+        if (abs >= 0x477ff000)
+        {
+            return static_cast<std::uint16_t>(sign | 0x7c00);
+        }
+
+        // Subnormal halves: adding 0.5 lines the mantissa up with the half's ulp, so
+        // the FPU does the rounding.
+        if (abs < 0x38800000)
+        {
+            auto shifted = std::bit_cast<float>(abs) + 0.5f;
+            return static_cast<std::uint16_t>(
+                sign | (std::bit_cast<std::uint32_t>(shifted) - 0x3f000000));
+        }
+
+        // Normal halves: rebias the exponent and round the mantissa to nearest even.
+        std::uint32_t odd = (abs >> 13) & 1;
+        abs += 0xc8000fff + odd;
+        return static_cast<std::uint16_t>(sign | (abs >> 13));
+    }
+
+    float half_to_float(std::uint16_t value)
+    {
+        std::uint32_t sign     = static_cast<std::uint32_t>(value & 0x8000) << 16;
+        std::uint32_t exponent = (value >> 10) & 0x1f;
+        std::uint32_t mantissa = value & 0x3ff;
+
+        if (exponent == 0)
+        {
+            // Zero or subnormal, which is exactly mantissa * 2^-24.
+            float magnitude = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+            return std::bit_cast<float>(sign | std::bit_cast<std::uint32_t>(magnitude));
+        }
+
+        if (exponent == 0x1f)
+        {
+            return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+        }
+
+        return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+    }
+
+    void float_to_half(std::span<float const> source,
+                       std::span<std::uint16_t> destination)
+    {
+        auto count = std::min(source.size(), destination.size());
+
+        std::size_t i{0};
+#if defined(ASSETS_HALF_FLOAT_SSE)
+        if (has_f16c())
+        {
+            i = float_to_half_f16c(source.data(), destination.data(), count);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            destination[i] = float_to_half(source[i]);
+        }
+    }
+
+    void half_to_float(std::span<std::uint16_t const> source,
+                       std::span<float> destination)
+    {
+        auto count = std::min(source.size(), destination.size());
+
+        std::size_t i{0};
+#if defined(ASSETS_HALF_FLOAT_SSE)
+        if (has_f16c())
+        {
+            i = half_to_float_f16c(source.data(), destination.data(), count);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            destination[i] = half_to_float(source[i]);
+        }
+    }
+
+    std::uint32_t float_to_r11g11b10f(float r, float g, float b)
+    {
+        return float_to_small_float(r, 6) | (float_to_small_float(g, 6) << 11)
+               | (float_to_small_float(b, 5) << 22);
+    }
+
+    std::array<float, 3> r11g11b10f_to_float(std::uint32_t value)
+    {
+        return {small_float_to_float(value & 0x7ff, 6),
+                small_float_to_float((value >> 11) & 0x7ff, 6),
+                small_float_to_float(value >> 22, 5)};
+    }
+
+    std::uint32_t float_to_rgb9e5(float r, float g, float b)
+    {
+        auto clamp = [](float value) {
+            return (value > 0.0f) ? std::min(value, rgb9e5_max) : 0.0f;
+        };
+
+        r = clamp(r);
+        g = clamp(g);
+        b = clamp(b);
+
+        // One more than floor(log2()) of the largest channel, read from its exponent
+        // bits, so that its mantissa fits in 9 bits. Rounding up to 512 needs one more.
+        auto maximum = std::max({r, g, b});
+        auto bits    = std::bit_cast<std::uint32_t>(maximum);
+        auto exponent = std::max(-16, static_cast<int>((bits >> 23) & 0xff) - 127) + 16;
+        if (static_cast<std::uint32_t>(maximum * rgb9e5_scale(exponent) + 0.5f) == 512)
+        {
+            ++exponent;
+        }
+
+        auto scale = rgb9e5_scale(exponent);
+        return static_cast<std::uint32_t>(r * scale + 0.5f)
+               | (static_cast<std::uint32_t>(g * scale + 0.5f) << 9)
+               | (static_cast<std::uint32_t>(b * scale + 0.5f) << 18)
+               | (static_cast<std::uint32_t>(exponent) << 27);
+    }
+
+    std::array<float, 3> rgb9e5_to_float(std::uint32_t value)
+    {
+        auto exponent = value >> 27;
+        auto scale    = std::bit_cast<float>((103 + exponent) << 23);
+        auto mask     = (1u << rgb9e5_mantissa_bits) - 1;
+        return {static_cast<float>(value & mask) * scale,
+                static_cast<float>((value >> 9) & mask) * scale,
+                static_cast<float>((value >> 18) & mask) * scale};
+    }
+
+    void rgba_to_r11g11b10f(std::span<float const> rgba,
+                            std::span<std::uint32_t> destination)
+    {
+        auto count = std::min(rgba.size() / 4, destination.size());
+        for (std::size_t i{0}; i < count; ++i)
+        {
+            destination[i] =
+                float_to_r11g11b10f(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+        }
+    }
+
+    void rgba_to_rgb9e5(std::span<float const> rgba, std::span<std::uint32_t> destination)
+    {
+        auto count = std::min(rgba.size() / 4, destination.size());
+
+        std::size_t i{0};
+#if defined(ASSETS_HALF_FLOAT_SSE)
+        i = rgba_to_rgb9e5_sse(rgba.data(), destination.data(), count);
+#endif
+        for (; i < count; ++i)
+        {
+            destination[i] =
+                float_to_rgb9e5(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2]);
+        }
+    }
+} // namespace assets
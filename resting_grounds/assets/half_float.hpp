@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace assets
+{
+    // IEEE 754 binary16 conversions. Rounding is to nearest even, values too large for
+    // a half become infinity, and NaNs stay NaNs.
+    std::uint16_t float_to_half(float value);
+    float half_to_float(std::uint16_t value);
+
+    // Batch versions of the above, which use F16C when the CPU has it. Results match the
+    // scalar conversions apart from NaN payloads.
+    void float_to_half(std::span<float const> source,
+                       std::span<std::uint16_t> destination);
+    void half_to_float(std::span<std::uint16_t const> source,
+                       std::span<float> destination);
+
+    // Unsigned RGB formats with the 5-bit exponent of halves, either per channel with
+    // 6, 6 and 5 bits of mantissa or shared between 9-bit mantissas. Negative values and
+    // NaNs become 0 and values too large are clamped to the largest finite value.
+    std::uint32_t float_to_r11g11b10f(float r, float g, float b);
+    std::array<float, 3> r11g11b10f_to_float(std::uint32_t value);
+    std::uint32_t float_to_rgb9e5(float r, float g, float b);
+    std::array<float, 3> rgb9e5_to_float(std::uint32_t value);
+
+    // Pack RGBA texels, dropping alpha. The shared exponents are found with SSE2.
+    void rgba_to_r11g11b10f(std::span<float const> rgba,
+                            std::span<std::uint32_t> destination);
+    void rgba_to_rgb9e5(std::span<float const> rgba,
+                        std::span<std::uint32_t> destination);
+} // namespace assets
@@ -0,0 +1,230 @@
+#include "mapped_file.hpp"
+
+#include <fmt/printf.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#    define WIN32_LEAN_AND_MEAN
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace assets
+{
+#if defined(_WIN32)
+    MappedFile::MappedFile(std::filesystem::path const& path)
+    {
+        HANDLE file = CreateFileW(path.c_str(),
+                                  GENERIC_READ,
+                                  FILE_SHARE_READ,
+                                  nullptr,
+                                  OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                                  nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            auto msg = fmt::format("error: unable to open file {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+        m_file = file;
+
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size))
+        {
+            close();
+            auto msg = fmt::format("error: unable to query size of {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        m_size = static_cast<std::size_t>(file_size.QuadPart);
+        if (m_size == 0)
+        {
+            return;
+        }
+
+        m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+        {
+            close();
+            auto msg = fmt::format("error: unable to map file {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        m_data = static_cast<std::byte const*>(
+            MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data == nullptr)
+        {
+            close();
+            auto msg = fmt::format("error: unable to map file {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+    }
+
+    void MappedFile::close()
+    {
+        if (m_data != nullptr)
+        {
+            UnmapViewOfFile(m_data);
+        }
+
+        if (m_mapping != nullptr)
+        {
+            CloseHandle(m_mapping);
+        }
+
+        if (m_file != nullptr)
+        {
+            CloseHandle(m_file);
+        }
+
+        m_data    = nullptr;
+        m_mapping = nullptr;
+        m_file    = nullptr;
+        m_size    = 0;
+    }
+#else
+    MappedFile::MappedFile(std::filesystem::path const& path)
+    {
+        m_file = ::open(path.c_str(), O_RDONLY);
+        if (m_file < 0)
+        {
+            auto msg = fmt::format("error: unable to open file {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        struct stat info;
+        if (::fstat(m_file, &info) != 0)
+        {
+            close();
+            auto msg = fmt::format("error: unable to query size of {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        m_size = static_cast<std::size_t>(info.st_size);
+        if (m_size == 0)
+        {
+            return;
+        }
+
+        void* ptr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        if (ptr == MAP_FAILED)
+        {
+            close();
+            auto msg = fmt::format("error: unable to map file {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        m_data = static_cast<std::byte const*>(ptr);
+    }
+
+    void MappedFile::close()
+    {
+        if (m_data != nullptr)
+        {
+            ::munmap(const_cast<std::byte*>(m_data), m_size);
+        }
+
+        if (m_file >= 0)
+        {
+            ::close(m_file);
+        }
+
+        m_data = nullptr;
+        m_file = -1;
+        m_size = 0;
+    }
+#endif
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept :
+        m_data{std::exchange(other.m_data, nullptr)},
+        m_size{std::exchange(other.m_size, 0)},
+#if defined(_WIN32)
+        m_file{std::exchange(other.m_file, nullptr)},
+        m_mapping{std::exchange(other.m_mapping, nullptr)}
+#else
+        m_file{std::exchange(other.m_file, -1)}
+#endif
+    {}
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            m_data = std::exchange(other.m_data, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+#if defined(_WIN32)
+            m_file    = std::exchange(other.m_file, nullptr);
+            m_mapping = std::exchange(other.m_mapping, nullptr);
+#else
+            m_file = std::exchange(other.m_file, -1);
+#endif
+        }
+
+        return *this;
+    }
+
+    std::span<std::byte const> MappedFile::bytes() const
+    {
+        return {m_data, m_size};
+    }
+
+    std::size_t MappedFile::size() const
+    {
+        return m_size;
+    }
+
+    bool MappedFile::is_open() const
+    {
+#if defined(_WIN32)
+        return m_file != nullptr;
+#else
+        return m_file >= 0;
+#endif
+    }
+
+    void MappedFile::prefetch(std::size_t offset, std::size_t size) const
+    {
+        if (offset >= m_size || size == 0)
+        {
+            return;
+        }
+
+        size = std::min(size, m_size - offset);
+
+#if !defined(_WIN32)
+        static auto const page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        auto start = offset / page_size * page_size;
+        ::madvise(const_cast<std::byte*>(m_data) + start,
+                  offset + size - start,
+                  MADV_WILLNEED);
+#endif
+
+        // Touch one byte per page so the range is resident once this returns.
+        static constexpr std::size_t touch_stride{4096};
+        std::uint8_t sum{0};
+        for (auto i = offset; i < offset + size; i += touch_stride)
+        {
+            sum ^= static_cast<std::uint8_t>(m_data[i]);
+        }
+        sum ^= static_cast<std::uint8_t>(m_data[offset + size - 1]);
+
+        [[maybe_unused]] volatile std::uint8_t sink = sum;
+    }
+} // namespace assets
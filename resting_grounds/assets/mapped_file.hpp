@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace assets
+{
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(std::filesystem::path const& path);
+        ~MappedFile();
+
+        MappedFile(MappedFile const&)            = delete;
+        MappedFile& operator=(MappedFile const&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        std::span<std::byte const> bytes() const;
+        std::size_t size() const;
+        bool is_open() const;
+
+        // Faults the given range into memory so later accesses don't block on I/O.
+        void prefetch(std::size_t offset, std::size_t size) const;
+
+    private:
+        void close();
+
+        std::byte const* m_data{nullptr};
+        std::size_t m_size{0};
+#if defined(_WIN32)
+        void* m_file{nullptr};
+        void* m_mapping{nullptr};
+#else
+        int m_file{-1};
+#endif
+    };
+} // namespace assets
@@ -1,59 +1,238 @@
 #include "material_asset.hpp"
+#include "metadata.hpp"
 
 #include <fmt/printf.h>
 #include <magic_enum.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+
 namespace assets
 {
+    namespace
+    {
+        struct StringPair
+        {
+            StringId key;
+            StringId value;
+        };
+
+        struct MaterialMetadata
+        {
+            MetadataStringTable strings;
+            StringId base_effect;
+            TransparencyMode transparency;
+            MetadataArray<StringPair> textures;
+            MetadataArray<StringPair> custom_properties;
+            BlockLayout parameter_layout;
+            MetadataArray<MaterialParameter> parameters;
+        };
+
+        static_assert(sizeof(MaterialParameter) == 20);
+        static_assert(sizeof(MaterialMetadata) == 52);
+
+        template<typename Header>
+        MetadataArray<StringPair>
+        add_string_map(MetadataWriter<Header>& writer,
+                       std::unordered_map<StringId, StringId> const& map)
+        {
+            std::vector<StringPair> pairs;
+            pairs.reserve(map.size());
+            for (auto [key, value] : map)
+            {
+                pairs.push_back({key, value});
+            }
+
+            return writer.template add_array<StringPair>(pairs);
+        }
+
+        void read_string_map(MetadataReader const& reader,
+                             StringTable const& strings,
+                             MetadataArray<StringPair> array,
+                             std::unordered_map<StringId, StringId>& map)
+        {
+            for (auto& pair : reader.array(array))
+            {
+                if (!strings.contains(pair.key) || !strings.contains(pair.value))
+                {
+                    throw std::runtime_error{"error: material string is out of range"};
+                }
+
+                map.insert({pair.key, pair.value});
+            }
+        }
+
+        nlohmann::json string_map_json(StringTable const& strings,
+                                       std::unordered_map<StringId, StringId> const& map)
+        {
+            nlohmann::json json = nlohmann::json::object();
+            for (auto [key, value] : map)
+            {
+                json[std::string{strings[key]}] = strings[value];
+            }
+
+            return json;
+        }
+    } // namespace
+
+    std::uint32_t parameter_size(ParameterType type)
+    {
+        switch (type)
+        {
+        case ParameterType::float1:
+        case ParameterType::int1:
+        case ParameterType::uint1:
+            return 4;
+
+        case ParameterType::float2:
+        case ParameterType::int2:
+        case ParameterType::uint2:
+            return 8;
+
+        case ParameterType::float3:
+        case ParameterType::int3:
+        case ParameterType::uint3:
+            return 12;
+
+        case ParameterType::float4:
+        case ParameterType::int4:
+        case ParameterType::uint4:
+            return 16;
+
+        case ParameterType::float4x4:
+            return 64;
+        }
+
+        auto msg = fmt::format("error: unknown parameter type {}",
+                               magic_enum::enum_integer(type));
+        throw std::runtime_error{msg.c_str()};
+    }
+
     void MaterialAsset::read(AssetFile const& file)
     {
-        auto material_metadata = nlohmann::json::parse(file.json);
-        base_effect            = material_metadata["base_effect"];
+        read(file.view());
+    }
+
+    void MaterialAsset::read(AssetFileView const& file)
+    {
+        MetadataReader reader{file.metadata};
+        auto material_metadata = reader.header<MaterialMetadata>();
 
-        for (auto& [key, value] : material_metadata["textures"].items())
+        strings = read_string_table(reader, material_metadata.strings);
+        if (!strings.contains(material_metadata.base_effect))
         {
-            textures.insert({key, value});
+            throw std::runtime_error{"error: material string is out of range"};
         }
 
-        for (auto& [key, value] : material_metadata["custom_properties"].items())
+        base_effect = material_metadata.base_effect;
+        read_string_map(reader, strings, material_metadata.textures, textures);
+        read_string_map(reader,
+                        strings,
+                        material_metadata.custom_properties,
+                        custom_properties);
+
+        if (!magic_enum::enum_contains(material_metadata.transparency))
         {
-            custom_properties.insert({key, value});
+            auto msg =
+                fmt::format("error: failed to parse transparency mode, recieved {}",
+                            magic_enum::enum_integer(material_metadata.transparency));
+            throw std::runtime_error{msg.c_str()};
         }
+        transparency = material_metadata.transparency;
 
-        transparency = TransparencyMode::opaque;
+        if (!magic_enum::enum_contains(material_metadata.parameter_layout))
+        {
+            throw std::runtime_error{"error: unknown material parameter layout"};
+        }
+        parameter_layout = material_metadata.parameter_layout;
 
-        if (auto it = material_metadata.find("transparency");
-            it != material_metadata.end())
+        auto entries = reader.array(material_metadata.parameters);
+        for (auto& parameter : entries)
         {
-            std::string val = (*it);
-            if (auto res = magic_enum::enum_cast<TransparencyMode>(val); res)
+            if (!strings.contains(parameter.name)
+                || !magic_enum::enum_contains(parameter.type) || parameter.count == 0)
             {
-                transparency = *res;
+                throw std::runtime_error{"error: invalid material parameter"};
             }
-            else
+
+            // Checked in 64 bits so that a large count or stride can't wrap around.
+            auto end = std::uint64_t{parameter.offset}
+                       + std::uint64_t{parameter.count - 1} * parameter.stride
+                       + parameter_size(parameter.type);
+            if (end > file.binary_blob.size())
             {
-                auto msg =
-                    fmt::format("error: failed to parse transparency mode, recieved {}",
-                                val);
+                auto msg = fmt::format("error: material parameter {} is out of range",
+                                       strings[parameter.name]);
                 throw std::runtime_error{msg.c_str()};
             }
         }
+
+        parameters.assign(entries.begin(), entries.end());
+        parameter_block.assign(file.binary_blob.begin(), file.binary_blob.end());
+    }
+
+    MaterialParameter const* MaterialAsset::find_parameter(std::string_view name) const
+    {
+        auto id = strings.find(name);
+        if (!id)
+        {
+            return nullptr;
+        }
+
+        auto it = std::find_if(parameters.begin(),
+                               parameters.end(),
+                               [&](MaterialParameter const& p) { return p.name == *id; });
+        return it == parameters.end() ? nullptr : &*it;
     }
 
     AssetFile MaterialAsset::pack() const
     {
-        nlohmann::json material_metadata;
-        material_metadata["base_effect"]       = base_effect;
-        material_metadata["textures"]          = textures;
-        material_metadata["custom_properties"] = custom_properties;
-        material_metadata["transparency"]      = magic_enum::enum_name(transparency);
+        MetadataWriter<MaterialMetadata> writer;
+
+        MaterialMetadata material_metadata;
+        material_metadata.strings           = add_string_table(writer, strings);
+        material_metadata.base_effect       = base_effect;
+        material_metadata.textures          = add_string_map(writer, textures);
+        material_metadata.custom_properties = add_string_map(writer, custom_properties);
+        material_metadata.transparency      = transparency;
+        material_metadata.parameter_layout  = parameter_layout;
+        material_metadata.parameters =
+            writer.add_array<MaterialParameter>(parameters);
 
         AssetFile file;
-        file.type    = {'M', 'A', 'T', 'X'};
-        file.version = AssetFile::current_version;
-        file.json    = material_metadata.dump();
+        file.type        = {'M', 'A', 'T', 'X'};
+        file.version     = AssetFile::current_version;
+        file.metadata    = writer.finish(material_metadata);
+        file.binary_blob = parameter_block;
 
         return file;
     }
+
+    std::string MaterialAsset::to_json() const
+    {
+        nlohmann::json material_metadata;
+        material_metadata["base_effect"]       = strings[base_effect];
+        material_metadata["textures"]          = string_map_json(strings, textures);
+        material_metadata["custom_properties"] =
+            string_map_json(strings, custom_properties);
+        material_metadata["transparency"]      = magic_enum::enum_name(transparency);
+
+        std::vector<nlohmann::json> parameter_list;
+        for (auto& parameter : parameters)
+        {
+            nlohmann::json entry;
+            entry["name"]   = strings[parameter.name];
+            entry["type"]   = magic_enum::enum_name(parameter.type);
+            entry["offset"] = parameter.offset;
+            entry["count"]  = parameter.count;
+            entry["stride"] = parameter.stride;
+            parameter_list.push_back(entry);
+        }
+
+        material_metadata["parameter_layout"] = magic_enum::enum_name(parameter_layout);
+        material_metadata["parameters"]       = parameter_list;
+        material_metadata["parameter_block_size"] = parameter_block.size();
+
+        return material_metadata.dump(4);
+    }
 } // namespace assets
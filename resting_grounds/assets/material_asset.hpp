@@ -1,26 +1,81 @@
 #pragma once
 
 #include "asset_file.hpp"
+#include "string_table.hpp"
 
 #include <unordered_map>
+#include <vector>
 
 namespace assets
 {
-    enum class TransparencyMode
+    enum class TransparencyMode : std::uint32_t
     {
         opaque,
         transparent,
     };
 
+    // GLSL types a material parameter can have.
+    enum class ParameterType : std::uint32_t
+    {
+        float1,
+        float2,
+        float3,
+        float4,
+        int1,
+        int2,
+        int3,
+        int4,
+        uint1,
+        uint2,
+        uint3,
+        uint4,
+        float4x4
+    };
+
+    // Packing rules of a parameter block, named after the GLSL layout qualifiers.
+    enum class BlockLayout : std::uint32_t
+    {
+        std140,
+        std430
+    };
+
+    // Reflection entry for a parameter, whose count elements start at offset in the
+    // parameter block and are stride bytes apart.
+    struct MaterialParameter
+    {
+        StringId name;
+        ParameterType type;
+        std::uint32_t offset;
+        std::uint32_t count;
+        std::uint32_t stride;
+    };
+
+    // Size in bytes of a single element of the type. Matrices are column-major.
+    std::uint32_t parameter_size(ParameterType type);
+
     struct MaterialAsset
     {
         void read(AssetFile const& file);
+        void read(AssetFileView const& file);
         AssetFile pack() const;
 
-        std::string base_effect;
-        std::unordered_map<std::string, std::string> textures;
-        std::unordered_map<std::string, std::string> custom_properties;
+        std::string to_json() const;
+
+        MaterialParameter const* find_parameter(std::string_view name) const;
+
+        // Every string below is an ID in strings.
+        StringTable strings;
+        StringId base_effect;
+        std::unordered_map<StringId, StringId> textures;
+        std::unordered_map<StringId, StringId> custom_properties;
         TransparencyMode transparency;
+
+        // Custom properties compiled by kass against the schema of the base effect, ready
+        // to be copied into a uniform or storage buffer as they are. Properties missing
+        // from the schema stay in custom_properties.
+        BlockLayout parameter_layout{BlockLayout::std140};
+        std::vector<MaterialParameter> parameters;
+        std::vector<std::byte> parameter_block;
     };
 
 } // namespace assets
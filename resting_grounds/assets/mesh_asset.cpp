@@ -1,184 +1,519 @@
 #include "mesh_asset.hpp"
+#include "mesh_codec.hpp"
+#include "metadata.hpp"
 
 #include <core/memory_buffer.hpp>
 
 #include <fmt/printf.h>
-#include <lz4.h>
 #include <magic_enum.hpp>
 #include <nlohmann/json.hpp>
 
-#include <limits>
+#include <cstddef>
+#include <tuple>
 
 namespace assets
 {
-    void MeshAsset::read(AssetFile const& file)
+    namespace
     {
-        auto metadata = nlohmann::json::parse(file.json);
+        struct LodRecord
+        {
+            std::uint64_t vertex_buffer_size;
+            std::uint64_t index_buffer_size;
+            std::uint64_t compressed_size;
+            float error;
+            ChunkCodec codec;
+        };
+
+        struct MeshMetadata
+        {
+            std::uint64_t vertex_buffer_size;
+            std::uint64_t index_buffer_size;
+            std::uint64_t vertex_compressed_size;
+            std::uint64_t index_compressed_size;
+            std::uint64_t meshlet_compressed_size;
+            MeshAsset::Bounds bounds;
+            VertexFormat vertex_format;
+            MeshFilter filter;
+            ChunkCodec codec;
+            ChunkCodec vertex_codec;
+            ChunkCodec index_codec;
+            ChunkCodec meshlet_codec;
+            std::uint32_t index_size;
+            std::uint32_t meshlet_count;
+            std::uint32_t meshlet_vertex_count;
+            std::uint32_t meshlet_triangle_count;
+            MetadataString original_file;
+            MetadataArray<LodRecord> lods;
+        };
+
+        static_assert(sizeof(MeshMetadata) == 136);
+        static_assert(sizeof(MeshAsset::Meshlet) == 48);
+
+        // The meshlet chunk holds the descriptors, then the vertex list, then the
+        // triangle list, back to back.
+        std::size_t meshlet_chunk_size(std::size_t meshlet_count,
+                                       std::size_t vertex_count,
+                                       std::size_t triangle_count)
+        {
+            return meshlet_count * sizeof(MeshAsset::Meshlet)
+                   + vertex_count * sizeof(std::uint32_t) + triangle_count * 3;
+        }
 
-        vertex_buffer_size = metadata["vertex_buffer_size"];
-        index_buffer_size  = metadata["index_buffer_size"];
-        index_size         = static_cast<std::uint8_t>(metadata["index_size"]);
-        original_file      = metadata["original_file"];
+        // Undoes the chunk codec and then the mesh filter, if any. The filters work
+        // straight off the source when there is nothing else to undo.
+        void unpack_vertex_stream(MeshFilter filter,
+                                  Codec codec,
+                                  std::span<std::byte const> source,
+                                  std::span<std::byte> destination,
+                                  VertexFormat vertex_format)
+        {
+            if (filter == MeshFilter::none)
+            {
+                decompress_exact(codec, source, destination);
+                return;
+            }
+
+            if (codec == Codec::none)
+            {
+                decode_vertex_buffer(source, destination, vertex_size(vertex_format));
+                return;
+            }
+
+            std::vector<std::byte> filtered(destination.size());
+            decompress_exact(codec, source, filtered);
+            decode_vertex_buffer(filtered, destination, vertex_size(vertex_format));
+        }
 
-        std::string mode = metadata["compression_mode"];
-        if (auto res = magic_enum::enum_cast<CompressionMode>(mode); res)
+        void unpack_index_stream(MeshFilter filter,
+                                 Codec codec,
+                                 std::span<std::byte const> source,
+                                 std::span<std::byte> destination,
+                                 std::size_t index_size)
         {
-            compression_mode = *res;
+            if (filter == MeshFilter::none)
+            {
+                decompress_exact(codec, source, destination);
+                return;
+            }
+
+            std::vector<std::byte> encoded;
+            if (codec != Codec::none)
+            {
+                encoded.resize(
+                    encoded_index_buffer_bound(destination.size() / index_size));
+                encoded.resize(decompress_chunk(codec, source, encoded));
+                source = encoded;
+            }
+
+            if (decode_index_buffer(source, destination, index_size) != source.size())
+            {
+                throw std::runtime_error{"error: failed de-compressing mesh buffer"};
+            }
         }
-        else
+    } // namespace
+
+    void MeshAsset::read(AssetFile const& file)
+    {
+        read(file.view());
+    }
+
+    void MeshAsset::read(AssetFileView const& file)
+    {
+        MetadataReader reader{file.metadata};
+        auto metadata = reader.header<MeshMetadata>();
+
+        vertex_buffer_size      = metadata.vertex_buffer_size;
+        index_buffer_size       = metadata.index_buffer_size;
+        vertex_compressed_size  = metadata.vertex_compressed_size;
+        index_compressed_size   = metadata.index_compressed_size;
+        meshlet_compressed_size = metadata.meshlet_compressed_size;
+        meshlet_count           = metadata.meshlet_count;
+        meshlet_vertex_count    = metadata.meshlet_vertex_count;
+        meshlet_triangle_count  = metadata.meshlet_triangle_count;
+        bounds                  = metadata.bounds;
+        original_file           = reader.string(metadata.original_file);
+
+        // The index filters divide by the index size, so anything else is rejected here.
+        if (metadata.index_size != sizeof(std::uint16_t)
+            && metadata.index_size != sizeof(std::uint32_t))
         {
-            auto msg =
-                fmt::format("error: failed parsing compression mode, got {}", mode);
+            auto msg = fmt::format("error: failed parsing index size, got {}",
+                                   metadata.index_size);
             throw std::runtime_error{msg.c_str()};
         }
+        index_size = static_cast<std::uint8_t>(metadata.index_size);
+
+        // Levels follow the full-detail chunks in order.
+        auto lod_records = reader.array(metadata.lods);
+        lods.resize(lod_records.size());
+
+        std::uint64_t offset{vertex_compressed_size + index_compressed_size
+                             + meshlet_compressed_size};
+        for (std::size_t i{0}; i < lod_records.size(); ++i)
+        {
+            auto& lod = lods[i];
 
-        std::vector<float> bounds_data(7);
-        bounds_data = metadata["bounds"].get<std::vector<float>>();
+            lod.vertex_buffer_size = lod_records[i].vertex_buffer_size;
+            lod.index_buffer_size  = lod_records[i].index_buffer_size;
+            lod.compressed_size    = lod_records[i].compressed_size;
+            lod.error              = lod_records[i].error;
+            lod.codec              = lod_records[i].codec;
+            lod.offset             = offset;
 
-        bounds.origin[0] = bounds_data[0];
-        bounds.origin[1] = bounds_data[1];
-        bounds.origin[2] = bounds_data[2];
+            validate_codec(lod.codec);
 
-        bounds.radius = bounds_data[3];
+            offset += lod.compressed_size;
+        }
 
-        bounds.extents[0] = bounds_data[4];
-        bounds.extents[1] = bounds_data[5];
-        bounds.extents[2] = bounds_data[6];
+        if (!magic_enum::enum_contains(metadata.filter))
+        {
+            auto msg = fmt::format("error: failed parsing mesh filter, got {}",
+                                   magic_enum::enum_integer(metadata.filter));
+            throw std::runtime_error{msg.c_str()};
+        }
+        filter = metadata.filter;
 
-        std::string format = metadata["vertex_format"];
-        if (auto res = magic_enum::enum_cast<VertexFormat>(format); res)
+        for (auto chunk_codec : {metadata.codec,
+                                 metadata.vertex_codec,
+                                 metadata.index_codec,
+                                 metadata.meshlet_codec})
         {
-            vertex_format = *res;
+            validate_codec(chunk_codec);
         }
-        else
+        codec         = metadata.codec;
+        vertex_codec  = metadata.vertex_codec;
+        index_codec   = metadata.index_codec;
+        meshlet_codec = metadata.meshlet_codec;
+
+        if (!magic_enum::enum_contains(metadata.vertex_format))
         {
-            auto msg = fmt::format("error: failed parsing vertex format, got {}", format);
+            auto msg = fmt::format("error: failed parsing vertex format, got {}",
+                                   magic_enum::enum_integer(metadata.vertex_format));
             throw std::runtime_error{msg.c_str()};
         }
+        vertex_format = metadata.vertex_format;
     }
 
     std::pair<std::vector<std::byte>, std::vector<std::byte>>
-    MeshAsset::unpack(std::vector<std::byte> const& source_buffer) const
+    MeshAsset::unpack(std::span<std::byte const> source_buffer) const
     {
-        std::vector<std::byte> decompressed_buffer;
-        decompressed_buffer.resize(vertex_buffer_size + index_buffer_size);
+        std::vector<std::byte> vertex_buffer(vertex_buffer_size);
+        std::vector<std::byte> index_buffer(index_buffer_size);
+        unpack(source_buffer, vertex_buffer, index_buffer);
+
+        return std::pair{std::move(vertex_buffer), std::move(index_buffer)};
+    }
 
-        if (LZ4_decompress_safe(core::to_const_data_ptr(source_buffer),
-                                core::to_data_ptr(decompressed_buffer),
-                                static_cast<int>(decompressed_buffer.size()),
-                                static_cast<int>(decompressed_buffer.size()))
-            < 0)
+    void MeshAsset::unpack(std::span<std::byte const> source_buffer,
+                           std::span<std::byte> vertex_buffer,
+                           std::span<std::byte> index_buffer) const
+    {
+        unpack_vertices(source_buffer, vertex_buffer);
+        unpack_indices(source_buffer, index_buffer);
+    }
+
+    void MeshAsset::unpack_vertices(std::span<std::byte const> source_buffer,
+                                    std::span<std::byte> vertex_buffer) const
+    {
+        if (vertex_buffer.size() < vertex_buffer_size
+            || source_buffer.size() < vertex_compressed_size)
         {
-            throw std::runtime_error{"error: failed de-compressing mesh buffer"};
+            throw std::runtime_error{"error: invalid vertex buffer size"};
         }
 
-        std::vector<std::byte> vertex_buffer(vertex_buffer_size);
-        std::memcpy(vertex_buffer.data(),
-                    decompressed_buffer.data(),
-                    vertex_buffer.size());
+        unpack_vertex_stream(filter,
+                             vertex_codec.codec,
+                             source_buffer.first(vertex_compressed_size),
+                             vertex_buffer.first(vertex_buffer_size),
+                             vertex_format);
+    }
 
-        std::vector<std::byte> index_buffer(index_buffer_size);
-        std::memcpy(index_buffer.data(),
-                    decompressed_buffer.data() + vertex_buffer.size(),
-                    index_buffer.size());
+    void MeshAsset::unpack_indices(std::span<std::byte const> source_buffer,
+                                   std::span<std::byte> index_buffer) const
+    {
+        if (index_buffer.size() < index_buffer_size
+            || source_buffer.size() < vertex_compressed_size + index_compressed_size)
+        {
+            throw std::runtime_error{"error: invalid index buffer size"};
+        }
 
-        return std::pair{vertex_buffer, index_buffer};
+        unpack_index_stream(
+            filter,
+            index_codec.codec,
+            source_buffer.subspan(vertex_compressed_size, index_compressed_size),
+            index_buffer.first(index_buffer_size),
+            index_size);
     }
 
-    AssetFile MeshAsset::pack(std::vector<std::byte> const& vertex_data,
-                              std::vector<std::byte> const& index_data) const
+    MeshAsset::MeshletBuffers
+    MeshAsset::unpack_meshlets(std::span<std::byte const> source_buffer) const
     {
-        AssetFile file;
-        file.type    = {'M', 'E', 'S', 'H'};
-        file.version = AssetFile::current_version;
+        auto offset = vertex_compressed_size + index_compressed_size;
+        if (source_buffer.size() < offset + meshlet_compressed_size)
+        {
+            throw std::runtime_error{"error: invalid meshlet buffer size"};
+        }
 
-        nlohmann::json metadata;
-        metadata["vertex_format"]      = magic_enum::enum_name(vertex_format);
-        metadata["vertex_buffer_size"] = vertex_buffer_size;
-        metadata["index_buffer_size"]  = index_buffer_size;
-        metadata["index_size"]         = index_size;
-        metadata["original_file"]      = original_file;
+        std::vector<std::byte> chunk(meshlet_chunk_size(meshlet_count,
+                                                        meshlet_vertex_count,
+                                                        meshlet_triangle_count));
+        decompress_exact(meshlet_codec.codec,
+                         source_buffer.subspan(offset, meshlet_compressed_size),
+                         chunk);
+
+        MeshletBuffers buffers;
+        buffers.meshlets.resize(meshlet_count);
+        buffers.vertices.resize(meshlet_vertex_count);
+        buffers.triangles.resize(meshlet_triangle_count * std::size_t{3});
+
+        auto source = chunk.data();
+        auto read   = [&source](auto& values) {
+            auto size = values.size() * sizeof(values[0]);
+            if (size != 0)
+            {
+                std::memcpy(values.data(), source, size);
+            }
+            source += size;
+        };
+
+        read(buffers.meshlets);
+        read(buffers.vertices);
+        read(buffers.triangles);
+
+        return buffers;
+    }
 
-        std::vector<float> bounds_data(7);
-        bounds_data[0] = bounds.origin[0];
-        bounds_data[1] = bounds.origin[1];
-        bounds_data[2] = bounds.origin[2];
+    std::pair<std::vector<std::byte>, std::vector<std::byte>>
+    MeshAsset::unpack_lod(std::size_t lod_index,
+                          std::span<std::byte const> source_buffer) const
+    {
+        auto const& lod = lods[lod_index];
+        std::vector<std::byte> vertex_buffer(lod.vertex_buffer_size);
+        std::vector<std::byte> index_buffer(lod.index_buffer_size);
+        unpack_lod(lod_index, source_buffer, vertex_buffer, index_buffer);
 
-        bounds_data[3] = bounds.radius;
+        return std::pair{std::move(vertex_buffer), std::move(index_buffer)};
+    }
 
-        bounds_data[4] = bounds.extents[0];
-        bounds_data[5] = bounds.extents[1];
-        bounds_data[6] = bounds.extents[2];
+    void MeshAsset::unpack_lod(std::size_t lod_index,
+                               std::span<std::byte const> source_buffer,
+                               std::span<std::byte> vertex_buffer,
+                               std::span<std::byte> index_buffer) const
+    {
+        auto const& lod = lods[lod_index];
+        if (vertex_buffer.size() < lod.vertex_buffer_size
+            || index_buffer.size() < lod.index_buffer_size
+            || source_buffer.size() < lod.offset + lod.compressed_size)
+        {
+            throw std::runtime_error{"error: invalid level of detail buffer size"};
+        }
 
-        metadata["bounds"] = bounds_data;
+        // Both streams of a level are compressed together so it is a single read. The
+        // filtered vertex stream keeps its size, so the index stream starts right after.
+        auto streams = source_buffer.subspan(lod.offset, lod.compressed_size);
 
-        std::size_t full_size = vertex_buffer_size + index_buffer_size;
+        std::vector<std::byte> chunk;
+        if (lod.codec.codec != Codec::none)
+        {
+            auto index_bound = (filter == MeshFilter::mesh_codec)
+                                   ? encoded_index_buffer_bound(lod.index_buffer_size
+                                                                / index_size)
+                                   : lod.index_buffer_size;
+            chunk.resize(lod.vertex_buffer_size + index_bound);
+            chunk.resize(decompress_chunk(lod.codec.codec, streams, chunk));
+            streams = chunk;
+        }
 
-        std::vector<std::byte> merged_buffer(full_size);
-        std::copy(vertex_data.begin(), vertex_data.end(), merged_buffer.begin());
-        std::copy(index_data.begin(),
-                  index_data.end(),
-                  merged_buffer.begin() + vertex_buffer_size);
+        if (streams.size() < lod.vertex_buffer_size)
+        {
+            throw std::runtime_error{"error: failed de-compressing mesh buffer"};
+        }
 
-        std::size_t compress_staging = LZ4_compressBound(static_cast<int>(full_size));
-        file.binary_blob.resize(compress_staging);
+        unpack_vertex_stream(filter,
+                             Codec::none,
+                             streams.first(lod.vertex_buffer_size),
+                             vertex_buffer.first(lod.vertex_buffer_size),
+                             vertex_format);
+        unpack_index_stream(filter,
+                            Codec::none,
+                            streams.subspan(lod.vertex_buffer_size),
+                            index_buffer.first(lod.index_buffer_size),
+                            index_size);
+    }
 
-        int compressed_size = LZ4_compress_default(core::to_const_data_ptr(merged_buffer),
-                                                   core::to_data_ptr(file.binary_blob),
-                                                   static_cast<int>(merged_buffer.size()),
-                                                   static_cast<int>(compress_staging));
-        file.binary_blob.resize(compressed_size);
+    AssetFile MeshAsset::pack(std::vector<std::byte> const& vertex_data,
+                              std::vector<std::byte> const& index_data,
+                              MeshletBuffers const& meshlets,
+                              std::span<LodBuffers const> lod_data) const
+    {
+        AssetFile file;
+        file.type    = {'M', 'E', 'S', 'H'};
+        file.version = AssetFile::current_version;
 
-        metadata["compression"] = "lz4";
+        MeshMetadata metadata;
+        metadata.vertex_buffer_size = vertex_buffer_size;
+        metadata.index_buffer_size  = index_buffer_size;
+        metadata.bounds             = bounds;
+        metadata.vertex_format      = vertex_format;
+        metadata.filter             = filter;
+        metadata.codec              = codec;
+        metadata.index_size         = index_size;
+
+        auto to_u32 = [](std::size_t value) { return static_cast<std::uint32_t>(value); };
+        metadata.meshlet_count          = to_u32(meshlets.meshlets.size());
+        metadata.meshlet_vertex_count   = to_u32(meshlets.vertices.size());
+        metadata.meshlet_triangle_count = to_u32(meshlets.triangles.size() / 3);
+
+        MetadataWriter<MeshMetadata> writer;
+        metadata.original_file = writer.add_string(original_file);
+
+        // The vertex and index streams are compressed as independent chunks so they can
+        // be decoded separately (and concurrently) straight into their destinations.
+        auto add_chunk = [this, &file](std::vector<std::byte> const& chunk) {
+            auto offset      = file.binary_blob.size();
+            auto chunk_codec = compress_chunk(codec, chunk, file.binary_blob);
+            return std::pair{static_cast<std::uint64_t>(file.binary_blob.size() - offset),
+                             chunk_codec};
+        };
+
+        // The mesh codec filters run first so the compressor sees the byte planes and
+        // triangle codes rather than the raw buffers.
+        bool filtered = (filter == MeshFilter::mesh_codec);
+
+        auto vertex_stream = [this, filtered](std::vector<std::byte> const& vertices) {
+            return filtered ? encode_vertex_buffer(vertices, vertex_size(vertex_format))
+                            : vertices;
+        };
+        auto index_stream = [this, filtered](std::vector<std::byte> const& indices) {
+            return filtered ? encode_index_buffer(indices, index_size) : indices;
+        };
+
+        std::tie(metadata.vertex_compressed_size, metadata.vertex_codec) =
+            add_chunk(vertex_stream(vertex_data));
+        std::tie(metadata.index_compressed_size, metadata.index_codec) =
+            add_chunk(index_stream(index_data));
+
+        std::vector<std::byte> meshlet_chunk;
+        meshlet_chunk.reserve(meshlet_chunk_size(metadata.meshlet_count,
+                                                 metadata.meshlet_vertex_count,
+                                                 metadata.meshlet_triangle_count));
+        auto append = [&meshlet_chunk](auto const& values) {
+            auto bytes = std::as_bytes(std::span{values});
+            meshlet_chunk.insert(meshlet_chunk.end(), bytes.begin(), bytes.end());
+        };
+        append(meshlets.meshlets);
+        append(meshlets.vertices);
+        append(meshlets.triangles);
+
+        std::tie(metadata.meshlet_compressed_size, metadata.meshlet_codec) =
+            add_chunk(meshlet_chunk);
+
+        std::vector<LodRecord> lod_records;
+        lod_records.reserve(lod_data.size());
+        std::vector<std::byte> lod_chunk;
+        for (auto const& lod : lod_data)
+        {
+            lod_chunk        = vertex_stream(lod.vertices);
+            auto lod_indices = index_stream(lod.indices);
+            lod_chunk.insert(lod_chunk.end(), lod_indices.begin(), lod_indices.end());
+
+            LodRecord record;
+            record.vertex_buffer_size = lod.vertices.size();
+            record.index_buffer_size  = lod.indices.size();
+            record.error              = lod.error;
+            std::tie(record.compressed_size, record.codec) = add_chunk(lod_chunk);
+            lod_records.push_back(record);
+        }
+        metadata.lods = writer.add_array<LodRecord>(lod_records);
 
-        file.json = metadata.dump();
+        file.metadata = writer.finish(metadata);
         return file;
     }
 
-    MeshAsset::Bounds MeshAsset::calculate_bounds(std::vector<Vertex> const& vertices)
+    std::string MeshAsset::to_json() const
     {
-        Vector3D<float> min;
-        min.fill(std::numeric_limits<float>::max());
+        nlohmann::json metadata;
+        metadata["vertex_format"]           = magic_enum::enum_name(vertex_format);
+        metadata["vertex_buffer_size"]      = vertex_buffer_size;
+        metadata["index_buffer_size"]       = index_buffer_size;
+        metadata["vertex_compressed_size"]  = vertex_compressed_size;
+        metadata["index_compressed_size"]   = index_compressed_size;
+        metadata["meshlet_compressed_size"] = meshlet_compressed_size;
+        metadata["meshlet_count"]           = meshlet_count;
+        metadata["meshlet_vertex_count"]    = meshlet_vertex_count;
+        metadata["meshlet_triangle_count"]  = meshlet_triangle_count;
+        metadata["index_size"]              = index_size;
+        metadata["filter"]                  = magic_enum::enum_name(filter);
+        metadata["codec"]                   = codec_name(codec);
+        metadata["vertex_codec"]            = codec_name(vertex_codec);
+        metadata["index_codec"]             = codec_name(index_codec);
+        metadata["meshlet_codec"]           = codec_name(meshlet_codec);
+        metadata["original_file"]           = original_file;
+        metadata["bounds"]["origin"]        = bounds.origin;
+        metadata["bounds"]["extents"]       = bounds.extents;
+        metadata["bounds"]["centre"]        = bounds.centre;
+        metadata["bounds"]["radius"]        = bounds.radius;
+
+        std::vector<nlohmann::json> lod_json;
+        for (auto& lod : lods)
+        {
+            nlohmann::json level;
+            level["vertex_buffer_size"] = lod.vertex_buffer_size;
+            level["index_buffer_size"]  = lod.index_buffer_size;
+            level["compressed_size"]    = lod.compressed_size;
+            level["error"]              = lod.error;
+            level["codec"]              = codec_name(lod.codec);
+            lod_json.push_back(level);
+        }
+        metadata["lods"] = lod_json;
 
-        Vector3D<float> max;
-        max.fill(std::numeric_limits<float>::min());
+        return metadata.dump(4);
+    }
 
-        for (auto v : vertices)
+    BoundingBox MeshAsset::Bounds::box() const
+    {
+        BoundingBox result;
+        for (std::size_t i{0}; i < 3; ++i)
         {
-            min[0] = std::min(min[0], v.position[0]);
-            min[1] = std::min(min[1], v.position[1]);
-            min[2] = std::min(min[2], v.position[2]);
-
-            max[0] = std::max(max[0], v.position[0]);
-            max[1] = std::max(max[1], v.position[1]);
-            max[2] = std::max(max[2], v.position[2]);
+            result.min[i] = origin[i] - extents[i];
+            result.max[i] = origin[i] + extents[i];
         }
 
-        Bounds bounds;
-        bounds.extents[0] = (max[0] - min[0]) / 2.0f;
-        bounds.extents[1] = (max[1] - min[1]) / 2.0f;
-        bounds.extents[2] = (max[2] - min[2]) / 2.0f;
-
-        bounds.origin[0] = bounds.extents[0] + min[0];
-        bounds.origin[1] = bounds.extents[1] + min[1];
-        bounds.origin[2] = bounds.extents[2] + min[2];
+        return result;
+    }
 
-        float r2{0.0f};
-        for (auto v : vertices)
+    MeshAsset::Bounds MeshAsset::calculate_bounds(std::span<std::byte const> vertices,
+                                                  VertexFormat format)
+    {
+        if (format != VertexFormat::f32_pncvtb)
         {
-            Vector3D<float> offset;
-            offset[0] = v.position[0] - bounds.origin[0];
-            offset[1] = v.position[1] - bounds.origin[1];
-            offset[2] = v.position[2] - bounds.origin[2];
+            auto msg = fmt::format("error: cannot calculate bounds of vertex format {}",
+                                   magic_enum::enum_integer(format));
+            throw std::runtime_error{msg.c_str()};
+        }
 
-            float distance =
-                std::inner_product(offset.begin(), offset.end(), offset.begin(), 0.0f);
-            r2 = std::max(r2, distance);
+        static_assert(offsetof(Vertex, position) == 0);
+        auto stride = sizeof(Vertex);
+        auto box    = compute_bounding_box(vertices, stride);
+        auto sphere = compute_bounding_sphere(vertices, stride, box);
+
+        Bounds bounds;
+        for (std::size_t i{0}; i < 3; ++i)
+        {
+            bounds.extents[i] = (box.max[i] - box.min[i]) / 2.0f;
+            bounds.origin[i]  = bounds.extents[i] + box.min[i];
         }
 
-        bounds.radius = std::sqrt(r2);
+        bounds.centre = sphere.centre;
+        bounds.radius = sphere.radius;
 
         return bounds;
     }
 
+    MeshAsset::Bounds MeshAsset::calculate_bounds(std::vector<Vertex> const& vertices)
+    {
+        return calculate_bounds(std::as_bytes(std::span{vertices}),
+                                VertexFormat::f32_pncvtb);
+    }
+
 } // namespace assets
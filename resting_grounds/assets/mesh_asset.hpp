@@ -1,53 +1,156 @@
 #pragma once
 
 #include "asset_file.hpp"
+#include "bounds.hpp"
+#include "codec.hpp"
 #include "types.hpp"
+#include "vertex_format.hpp"
 
 namespace assets
 {
-    enum class VertexFormat
+    // Lossless transform applied to the vertex and index streams ahead of the chunk
+    // codec: indices go through the triangle edge codec and vertices are split into
+    // delta-filtered byte planes.
+    enum class MeshFilter : std::uint32_t
     {
-        unknonw = 0,
-        // Point-Normal-Colour-Texture-Tangent-BiTangent data in 32-bit float
-        f32_pncvtb
-    };
-
-    struct Vertex
-    {
-        Vector3D<float> position;
-        Vector3D<float> normal;
-        Vector3D<float> colour;
-        Vector2D<float> uv;
-        Vector3D<float> tangent;
-        Vector3D<float> bitangent;
+        none = 0,
+        mesh_codec
     };
 
     struct MeshAsset
     {
         struct Bounds
         {
+            // Axis-aligned box spanning origin +/- extents.
             Vector3D<float> origin;
-            float radius;
             Vector3D<float> extents;
+
+            // Bounding sphere, whose centre generally differs from the box origin.
+            Vector3D<float> centre;
+            float radius;
+
+            BoundingBox box() const;
+        };
+
+        // A small cluster of triangles that can be culled on its own. Its vertices are
+        // indices into the mesh vertex buffer and its triangles are triplets of
+        // indices into the meshlet's own vertex list.
+        struct Meshlet
+        {
+            std::uint32_t vertex_offset;
+            std::uint32_t vertex_count;
+            std::uint32_t triangle_offset;
+            std::uint32_t triangle_count;
+
+            Vector3D<float> centre;
+            float radius;
+
+            // Every triangle faces away from a camera at position p if
+            //   dot(centre - p, cone_axis) >= cone_cutoff * length(centre - p) + radius.
+            // A cutoff of 1 means the cone is too wide to ever cull.
+            Vector3D<float> cone_axis;
+            float cone_cutoff;
+        };
+
+        struct MeshletBuffers
+        {
+            std::vector<Meshlet> meshlets;
+            std::vector<std::uint32_t> vertices;
+            std::vector<std::uint8_t> triangles;
         };
 
+        // A simplified copy of the mesh with its own vertices and indices, in the same
+        // vertex format and index size as the full-detail level.
+        struct Lod
+        {
+            std::uint64_t vertex_buffer_size;
+            std::uint64_t index_buffer_size;
+            std::uint64_t compressed_size;
+
+            // Estimated deviation from the full-detail surface in mesh units: the
+            // largest root mean square distance from a merged vertex to the triangles
+            // it replaced. It is not a bound, but grows with the visible change, so
+            // project it to pixels to pick a level by screen-space error.
+            float error;
+            ChunkCodec codec;
+
+            // Byte offset of the level within the binary blob. Not stored in the file, it
+            // is rebuilt by read() so a level can be streamed in on its own.
+            std::uint64_t offset;
+        };
+
+        struct LodBuffers
+        {
+            std::vector<std::byte> vertices;
+            std::vector<std::byte> indices;
+            float error;
+        };
+
+        static constexpr std::size_t max_meshlet_vertices{64};
+        static constexpr std::size_t max_meshlet_triangles{124};
+
         void read(AssetFile const& file);
+        void read(AssetFileView const& file);
+
+        std::pair<std::vector<std::byte>, std::vector<std::byte>>
+        unpack(std::span<std::byte const> source_buffer) const;
+
+        // Decompress directly into caller-owned memory (e.g. a mapped upload buffer). The
+        // destinations must be at least vertex_buffer_size and index_buffer_size bytes.
+        void unpack(std::span<std::byte const> source_buffer,
+                    std::span<std::byte> vertex_buffer,
+                    std::span<std::byte> index_buffer) const;
+        void unpack_vertices(std::span<std::byte const> source_buffer,
+                             std::span<std::byte> vertex_buffer) const;
+        void unpack_indices(std::span<std::byte const> source_buffer,
+                            std::span<std::byte> index_buffer) const;
+        MeshletBuffers unpack_meshlets(std::span<std::byte const> source_buffer) const;
 
         std::pair<std::vector<std::byte>, std::vector<std::byte>>
-        unpack(std::vector<std::byte> const& source_buffer) const;
+        unpack_lod(std::size_t lod_index, std::span<std::byte const> source_buffer) const;
+        void unpack_lod(std::size_t lod_index,
+                        std::span<std::byte const> source_buffer,
+                        std::span<std::byte> vertex_buffer,
+                        std::span<std::byte> index_buffer) const;
 
         AssetFile pack(std::vector<std::byte> const& vertex_data,
-                       std::vector<std::byte> const& index_data) const;
+                       std::vector<std::byte> const& index_data,
+                       MeshletBuffers const& meshlets = {},
+                       std::span<LodBuffers const> lod_data = {}) const;
 
+        // Only f32_pncvtb buffers are accepted, anything else throws: quantised
+        // positions are relative to the bounds stored with the mesh, so decode them
+        // first.
+        static Bounds calculate_bounds(std::span<std::byte const> vertices,
+                                       VertexFormat format);
         static Bounds calculate_bounds(std::vector<Vertex> const& vertices);
 
+        std::string to_json() const;
+
         std::uint64_t vertex_buffer_size;
         std::uint64_t index_buffer_size;
+        std::uint64_t vertex_compressed_size;
+        std::uint64_t index_compressed_size;
+        std::uint64_t meshlet_compressed_size;
+        std::uint32_t meshlet_count;
+        std::uint32_t meshlet_vertex_count;
+        std::uint32_t meshlet_triangle_count;
         Bounds bounds;
         VertexFormat vertex_format;
         std::uint8_t index_size;
-        CompressionMode compression_mode;
+        MeshFilter filter;
         std::string original_file;
+
+        // Codec pack() compresses every chunk with. Chunks that don't compress are stored
+        // as-is, so the codec each one ended up with is kept separately.
+        ChunkCodec codec;
+        ChunkCodec vertex_codec;
+        ChunkCodec index_codec;
+        ChunkCodec meshlet_codec;
+
+        // Simplified levels from finest to coarsest. The full-detail mesh above is level
+        // zero and isn't listed.
+        std::vector<Lod> lods;
     };
 
 } // namespace assets
@@ -0,0 +1,427 @@
+#include "mesh_codec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ASSETS_MESH_CODEC_SSE
+#    include <immintrin.h>
+#endif
+
+namespace assets
+{
+    namespace
+    {
+        static constexpr std::size_t edge_fifo_size{16};
+        static constexpr std::size_t vertex_block_size{16};
+
+        // Triangle codes: an edge hit packs the FIFO slot in the low nibble, the
+        // rotation that lines the triangle up with the edge in the next two bits and
+        // whether the third vertex is explicit in the top one. Anything else is a miss
+        // followed by three explicit vertices.
+        static constexpr std::uint8_t miss_code{0xff};
+        static constexpr std::uint8_t explicit_third{0x40};
+
+        static constexpr std::size_t max_varint_size{5};
+
+        static constexpr auto invalid_index = std::numeric_limits<std::uint32_t>::max();
+
+        struct Edge
+        {
+            std::uint32_t a{invalid_index};
+            std::uint32_t b{invalid_index};
+        };
+
+        class EdgeFifo
+        {
+        public:
+            // Stores the edges reversed, as that is how a neighbouring triangle sees
+            // them.
+            void push(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+            {
+                push_edge({b, a});
+                push_edge({c, b});
+                push_edge({a, c});
+            }
+
+            // Slot 0 is the most recently pushed edge.
+            Edge const& operator[](std::size_t slot) const
+            {
+                return m_edges[(m_head - 1 - slot) % edge_fifo_size];
+            }
+
+        private:
+            void push_edge(Edge edge)
+            {
+                m_edges[m_head % edge_fifo_size] = edge;
+                ++m_head;
+            }
+
+            std::array<Edge, edge_fifo_size> m_edges{};
+            std::size_t m_head{0};
+        };
+
+        std::uint32_t read_index(std::byte const* source, std::size_t index_size)
+        {
+            if (index_size == sizeof(std::uint16_t))
+            {
+                std::uint16_t value;
+                std::memcpy(&value, source, sizeof(value));
+                return value;
+            }
+
+            std::uint32_t value;
+            std::memcpy(&value, source, sizeof(value));
+            return value;
+        }
+
+        void check_index_size(std::size_t index_size)
+        {
+            if (index_size != sizeof(std::uint16_t)
+                && index_size != sizeof(std::uint32_t))
+            {
+                throw std::runtime_error{"error: unsupported index size"};
+            }
+        }
+
+        // Zigzag encoded delta from the previous vertex, 7 bits per byte. Deltas wrap
+        // around at 32 bits, which the decoder undoes by wrapping the same way.
+        void
+        write_delta(std::vector<std::byte>& out, std::uint32_t index, std::uint32_t last)
+        {
+            auto delta = static_cast<std::int32_t>(index - last);
+            auto value = (static_cast<std::uint32_t>(delta) << 1)
+                         ^ static_cast<std::uint32_t>(delta >> 31);
+            while (value >= 0x80)
+            {
+                out.push_back(static_cast<std::byte>((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<std::byte>(value));
+        }
+
+        class DeltaReader
+        {
+        public:
+            DeltaReader(std::byte const* data, std::byte const* end) :
+                m_data{data},
+                m_end{end}
+            {}
+
+            std::uint32_t read(std::uint32_t last)
+            {
+                std::uint32_t value{0};
+                for (std::uint32_t shift{0};; shift += 7)
+                {
+                    if (m_data == m_end || shift >= max_varint_size * 7)
+                    {
+                        throw std::runtime_error{"error: malformed index buffer"};
+                    }
+
+                    auto byte = static_cast<std::uint8_t>(*m_data++);
+                    value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+                    if (byte < 0x80)
+                    {
+                        break;
+                    }
+                }
+
+                return last + ((value >> 1) ^ (0u - (value & 1)));
+            }
+
+            std::byte const* data() const
+            {
+                return m_data;
+            }
+
+        private:
+            std::byte const* m_data;
+            std::byte const* m_end;
+        };
+
+#if defined(ASSETS_MESH_CODEC_SSE)
+        // Undoes 16 planes of a full block: a 16x16 byte transpose turns the planes
+        // back into vertices, then a running sum down the vertices removes the deltas.
+        void decode_vertex_group(std::uint8_t const* planes,
+                                 std::uint8_t* destination,
+                                 std::size_t stride,
+                                 std::uint8_t const* carry,
+                                 std::uint8_t* previous)
+        {
+            __m128i rows[16];
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                rows[i] = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const*>(planes + i * vertex_block_size));
+            }
+
+            // Four rounds of interleaving row i with row i + 8 transpose the block.
+            for (std::size_t round{0}; round < 4; ++round)
+            {
+                __m128i interleaved[16];
+                for (std::size_t i{0}; i < 8; ++i)
+                {
+                    interleaved[i * 2]     = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+                    interleaved[i * 2 + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+                }
+                std::memcpy(rows, interleaved, sizeof(rows));
+            }
+
+            auto sum = _mm_loadu_si128(reinterpret_cast<__m128i const*>(carry));
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                sum = _mm_add_epi8(sum, rows[i]);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i * stride),
+                                 sum);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(previous), sum);
+        }
+#endif
+
+        template<typename T>
+        std::size_t decode_indices(std::span<std::byte const> source,
+                                   std::span<std::byte> indices)
+        {
+            auto triangle_count = indices.size() / sizeof(T) / 3;
+            if (source.size() < triangle_count)
+            {
+                throw std::runtime_error{"error: malformed index buffer"};
+            }
+
+            auto codes = reinterpret_cast<std::uint8_t const*>(source.data());
+            DeltaReader deltas{source.data() + triangle_count,
+                               source.data() + source.size()};
+
+            EdgeFifo fifo;
+            std::uint32_t next{0};
+            std::uint32_t last{0};
+            auto destination = indices.data();
+            for (std::size_t t{0}; t < triangle_count; ++t)
+            {
+                auto code = codes[t];
+
+                std::uint32_t triangle[3];
+                if (code == miss_code)
+                {
+                    triangle[0] = deltas.read(last);
+                    triangle[1] = deltas.read(triangle[0]);
+                    triangle[2] = deltas.read(triangle[1]);
+                    last        = triangle[2];
+                }
+                else
+                {
+                    auto const& edge     = fifo[code & 0xf];
+                    std::size_t rotation = (code >> 4) & 0x3;
+                    if (edge.a == invalid_index || rotation > 2)
+                    {
+                        throw std::runtime_error{"error: malformed index buffer"};
+                    }
+
+                    auto c = ((code & explicit_third) != 0) ? deltas.read(last) : next;
+                    last   = c;
+
+                    // Rotations of 1 and 2 wrap around the triangle.
+                    auto first  = rotation;
+                    auto second = (rotation == 2) ? 0 : rotation + 1;
+                    auto third  = (rotation == 0) ? 2 : rotation - 1;
+
+                    triangle[first]  = edge.a;
+                    triangle[second] = edge.b;
+                    triangle[third]  = c;
+                }
+
+                next = std::max(
+                    next,
+                    std::max(triangle[0], std::max(triangle[1], triangle[2])) + 1);
+
+                T values[3] = {static_cast<T>(triangle[0]),
+                               static_cast<T>(triangle[1]),
+                               static_cast<T>(triangle[2])};
+                std::memcpy(destination, values, sizeof(values));
+                destination += sizeof(values);
+
+                fifo.push(triangle[0], triangle[1], triangle[2]);
+            }
+
+            return static_cast<std::size_t>(deltas.data() - source.data());
+        }
+    } // namespace
+
+    std::size_t encoded_index_buffer_bound(std::size_t index_count)
+    {
+        return (index_count / 3) * (1 + 3 * max_varint_size);
+    }
+
+    std::vector<std::byte> encode_index_buffer(std::span<std::byte const> indices,
+                                               std::size_t index_size)
+    {
+        check_index_size(index_size);
+        auto triangle_count = indices.size() / index_size / 3;
+
+        // Codes come first and deltas after, so each stream stays uniform for the
+        // compressor that follows.
+        std::vector<std::byte> codes(triangle_count);
+        std::vector<std::byte> deltas;
+        deltas.reserve(triangle_count * 2);
+
+        EdgeFifo fifo;
+        std::uint32_t next{0};
+        std::uint32_t last{0};
+        for (std::size_t t{0}; t < triangle_count; ++t)
+        {
+            std::array<std::uint32_t, 3> triangle;
+            for (std::size_t k{0}; k < 3; ++k)
+            {
+                triangle[k] = read_index(indices.data() + (t * 3 + k) * index_size,
+                                         index_size);
+            }
+
+            std::uint8_t code{miss_code};
+            for (std::size_t rotation{0}; rotation < 3 && code == miss_code; ++rotation)
+            {
+                auto a = triangle[rotation];
+                auto b = triangle[(rotation + 1) % 3];
+                auto c = triangle[(rotation + 2) % 3];
+                for (std::size_t slot{0}; slot < edge_fifo_size; ++slot)
+                {
+                    if (fifo[slot].a != a || fifo[slot].b != b)
+                    {
+                        continue;
+                    }
+
+                    code = static_cast<std::uint8_t>(slot | (rotation << 4));
+                    if (c != next)
+                    {
+                        code |= explicit_third;
+                        write_delta(deltas, c, last);
+                    }
+                    last = c;
+                    break;
+                }
+            }
+
+            if (code == miss_code)
+            {
+                for (auto index : triangle)
+                {
+                    write_delta(deltas, index, last);
+                    last = index;
+                }
+            }
+
+            next = std::max(
+                next,
+                std::max(triangle[0], std::max(triangle[1], triangle[2])) + 1);
+
+            codes[t] = static_cast<std::byte>(code);
+            fifo.push(triangle[0], triangle[1], triangle[2]);
+        }
+
+        codes.insert(codes.end(), deltas.begin(), deltas.end());
+        return codes;
+    }
+
+    std::size_t decode_index_buffer(std::span<std::byte const> source,
+                                    std::span<std::byte> indices,
+                                    std::size_t index_size)
+    {
+        check_index_size(index_size);
+        if (index_size == sizeof(std::uint16_t))
+        {
+            return decode_indices<std::uint16_t>(source, indices);
+        }
+
+        return decode_indices<std::uint32_t>(source, indices);
+    }
+
+    std::vector<std::byte> encode_vertex_buffer(std::span<std::byte const> vertices,
+                                                std::size_t stride)
+    {
+        std::vector<std::byte> out(vertices.size());
+        auto vertex_count = vertices.size() / stride;
+
+        std::vector<std::uint8_t> previous(stride, 0);
+        auto destination = reinterpret_cast<std::uint8_t*>(out.data());
+        auto source      = reinterpret_cast<std::uint8_t const*>(vertices.data());
+        for (std::size_t block{0}; block < vertex_count; block += vertex_block_size)
+        {
+            auto count = std::min(vertex_block_size, vertex_count - block);
+            for (std::size_t k{0}; k < stride; ++k)
+            {
+                for (std::size_t i{0}; i < count; ++i)
+                {
+                    auto byte      = source[(block + i) * stride + k];
+                    *destination++ = static_cast<std::uint8_t>(byte - previous[k]);
+                    previous[k]    = byte;
+                }
+            }
+        }
+
+        // Trailing bytes that don't make up a whole vertex are kept as they are.
+        auto tail = vertex_count * stride;
+        std::memcpy(out.data() + tail, vertices.data() + tail, vertices.size() - tail);
+
+        return out;
+    }
+
+    void decode_vertex_buffer(std::span<std::byte const> source,
+                              std::span<std::byte> vertices,
+                              std::size_t stride)
+    {
+        if (source.size() != vertices.size())
+        {
+            throw std::runtime_error{"error: malformed vertex buffer"};
+        }
+
+        auto vertex_count = vertices.size() / stride;
+
+        std::vector<std::uint8_t> previous(stride, 0);
+        std::vector<std::uint8_t> carry(stride, 0);
+        auto input       = reinterpret_cast<std::uint8_t const*>(source.data());
+        auto destination = reinterpret_cast<std::uint8_t*>(vertices.data());
+        for (std::size_t block{0}; block < vertex_count; block += vertex_block_size)
+        {
+            auto count = std::min(vertex_block_size, vertex_count - block);
+
+#if defined(ASSETS_MESH_CODEC_SSE)
+            if (count == vertex_block_size && stride >= 16)
+            {
+                // The last group is shifted back to end at the stride, re-decoding a
+                // few planes to the same values instead of running a scalar tail, so
+                // every group starts from the carry the block started with.
+                carry = previous;
+                for (std::size_t k{0}; k < stride; k += 16)
+                {
+                    auto group = std::min(k, stride - 16);
+                    decode_vertex_group(input + group * vertex_block_size,
+                                        destination + group,
+                                        stride,
+                                        carry.data() + group,
+                                        previous.data() + group);
+                }
+
+                input += vertex_block_size * stride;
+                destination += vertex_block_size * stride;
+                continue;
+            }
+#endif
+            for (std::size_t k{0}; k < stride; ++k)
+            {
+                for (std::size_t i{0}; i < count; ++i)
+                {
+                    previous[k] = static_cast<std::uint8_t>(previous[k] + *input++);
+                    destination[i * stride + k] = previous[k];
+                }
+            }
+
+            destination += count * stride;
+        }
+
+        auto tail = vertex_count * stride;
+        std::memcpy(vertices.data() + tail, source.data() + tail, vertices.size() - tail);
+    }
+} // namespace assets
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace assets
+{
+    // Lossless filters that make mesh buffers far easier for a general-purpose
+    // compressor to squeeze.
+
+    // Triangles that share an edge with one of the 16 previous triangles are stored as a
+    // reference to that edge plus the remaining vertex, the rest as deltas between
+    // consecutive indices. Index size is 2 or 4 bytes.
+    std::size_t encoded_index_buffer_bound(std::size_t index_count);
+    std::vector<std::byte> encode_index_buffer(std::span<std::byte const> indices,
+                                               std::size_t index_size);
+    // Returns the number of source bytes consumed.
+    std::size_t decode_index_buffer(std::span<std::byte const> source,
+                                    std::span<std::byte> indices,
+                                    std::size_t index_size);
+
+    // Transposes blocks of 16 vertices into byte planes and stores each byte as the
+    // difference from the same byte of the previous vertex. The output is the same size
+    // as the input.
+    std::vector<std::byte> encode_vertex_buffer(std::span<std::byte const> vertices,
+                                                std::size_t stride);
+    void decode_vertex_buffer(std::span<std::byte const> source,
+                              std::span<std::byte> vertices,
+                              std::size_t stride);
+} // namespace assets
@@ -0,0 +1,25 @@
+#include "metadata.hpp"
+
+namespace assets
+{
+    MetadataReader::MetadataReader(std::span<std::byte const> bytes) :
+        m_bytes{bytes}
+    {}
+
+    std::string_view MetadataReader::string(MetadataString ref) const
+    {
+        auto bytes = range(ref.offset, ref.size);
+        return {reinterpret_cast<char const*>(bytes.data()), bytes.size()};
+    }
+
+    std::span<std::byte const> MetadataReader::range(std::size_t offset,
+                                                     std::size_t size) const
+    {
+        if (offset > m_bytes.size() || size > m_bytes.size() - offset)
+        {
+            throw std::runtime_error{"error: metadata reference is out of bounds"};
+        }
+
+        return m_bytes.subspan(offset, size);
+    }
+} // namespace assets
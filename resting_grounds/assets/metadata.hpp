@@ -0,0 +1,122 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace assets
+{
+    static_assert(std::endian::native == std::endian::little,
+                  "asset metadata is stored as little-endian POD");
+
+    // Binary metadata is a fixed-layout, per-asset header followed by a data section.
+    // Variable-length fields (strings and arrays) live in the data section and are
+    // addressed from the header by offset relative to the start of the metadata block.
+    struct MetadataString
+    {
+        std::uint32_t offset;
+        std::uint32_t size;
+    };
+
+    template<typename T>
+    struct MetadataArray
+    {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+
+    template<typename Header>
+    class MetadataWriter
+    {
+    public:
+        static_assert(std::is_trivially_copyable_v<Header>);
+
+        MetadataWriter() :
+            m_bytes(sizeof(Header))
+        {}
+
+        MetadataString add_string(std::string_view str)
+        {
+            MetadataString ref{static_cast<std::uint32_t>(m_bytes.size()),
+                               static_cast<std::uint32_t>(str.size())};
+            append(str.data(), str.size());
+            return ref;
+        }
+
+        template<typename T>
+        MetadataArray<T> add_array(std::span<T const> values)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            m_bytes.resize((m_bytes.size() + alignof(T) - 1) / alignof(T) * alignof(T));
+            MetadataArray<T> ref{static_cast<std::uint32_t>(m_bytes.size()),
+                                 static_cast<std::uint32_t>(values.size())};
+            append(values.data(), values.size_bytes());
+            return ref;
+        }
+
+        std::vector<std::byte> finish(Header const& header)
+        {
+            std::memcpy(m_bytes.data(), &header, sizeof(Header));
+            return std::move(m_bytes);
+        }
+
+    private:
+        void append(void const* data, std::size_t size)
+        {
+            auto offset = m_bytes.size();
+            m_bytes.resize(offset + size);
+            if (size != 0)
+            {
+                std::memcpy(m_bytes.data() + offset, data, size);
+            }
+        }
+
+        std::vector<std::byte> m_bytes;
+    };
+
+    class MetadataReader
+    {
+    public:
+        MetadataReader(std::span<std::byte const> bytes);
+
+        template<typename Header>
+        Header header() const
+        {
+            static_assert(std::is_trivially_copyable_v<Header>);
+
+            Header header;
+            std::memcpy(&header, range(0, sizeof(Header)).data(), sizeof(Header));
+            return header;
+        }
+
+        std::string_view string(MetadataString ref) const;
+
+        // Arrays are returned in place; the metadata block must therefore be suitably
+        // aligned, which holds for heap buffers, mapped files and bundle entries.
+        template<typename T>
+        std::span<T const> array(MetadataArray<T> ref) const
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            auto bytes = range(ref.offset, std::size_t{ref.count} * sizeof(T));
+            if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(T) != 0)
+            {
+                throw std::runtime_error{"error: misaligned metadata array"};
+            }
+
+            return {reinterpret_cast<T const*>(bytes.data()), ref.count};
+        }
+
+    private:
+        std::span<std::byte const> range(std::size_t offset, std::size_t size) const;
+
+        std::span<std::byte const> m_bytes;
+    };
+} // namespace assets
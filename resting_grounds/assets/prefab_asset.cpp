@@ -1,79 +1,255 @@
 #include "prefab_asset.hpp"
+#include "metadata.hpp"
 
-#include <lz4.h>
-#include <magic_enum.hpp>
+#include <fmt/printf.h>
 #include <nlohmann/json.hpp>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define ASSETS_PREFAB_SSE
+#    include <emmintrin.h>
+#endif
+
 namespace assets
 {
+    namespace
+    {
+        struct PrefabMetadata
+        {
+            MetadataStringTable strings;
+            MetadataArray<std::uint32_t> parents;
+            MetadataArray<StringId> node_names;
+            MetadataArray<std::uint32_t> mesh_slots;
+            MetadataArray<PrefabAsset::NodeMesh> meshes;
+        };
+
+        static_assert(sizeof(PrefabAsset::NodeMesh) == 8);
+        static_assert(sizeof(PrefabMetadata) == 48);
+
+        // world = parent * local for column-major matrices. Each column of the result is
+        // the columns of the parent weighted by the matching column of the local matrix.
+        void multiply(float const* parent, float const* local, float* world)
+        {
+#if defined(ASSETS_PREFAB_SSE)
+            auto c0 = _mm_loadu_ps(parent);
+            auto c1 = _mm_loadu_ps(parent + 4);
+            auto c2 = _mm_loadu_ps(parent + 8);
+            auto c3 = _mm_loadu_ps(parent + 12);
+            for (std::size_t j{0}; j < 4; ++j)
+            {
+                auto const* weights = local + j * 4;
+
+                auto column = _mm_mul_ps(c0, _mm_set1_ps(weights[0]));
+                column      = _mm_add_ps(column, _mm_mul_ps(c1, _mm_set1_ps(weights[1])));
+                column      = _mm_add_ps(column, _mm_mul_ps(c2, _mm_set1_ps(weights[2])));
+                column      = _mm_add_ps(column, _mm_mul_ps(c3, _mm_set1_ps(weights[3])));
+                _mm_storeu_ps(world + j * 4, column);
+            }
+#else
+            for (std::size_t j{0}; j < 4; ++j)
+            {
+                for (std::size_t r{0}; r < 4; ++r)
+                {
+                    world[j * 4 + r] = parent[r] * local[j * 4]
+                                       + parent[4 + r] * local[j * 4 + 1]
+                                       + parent[8 + r] * local[j * 4 + 2]
+                                       + parent[12 + r] * local[j * 4 + 3];
+                }
+            }
+#endif
+        }
+    } // namespace
+
     static constexpr auto sizeof_matrix = sizeof(Matrix4x4<float>);
 
     void PrefabAsset::read(AssetFile const& file)
     {
-        auto metadata = nlohmann::json::parse(file.json);
+        read(file.view());
+    }
 
-        for (auto& [_, value] : metadata["node_matrices"].items())
+    void PrefabAsset::read(AssetFileView const& file)
+    {
+        MetadataReader reader{file.metadata};
+        auto metadata = reader.header<PrefabMetadata>();
+
+        auto node_strings      = read_string_table(reader, metadata.strings);
+        auto parent_entries    = reader.array(metadata.parents);
+        auto name_entries      = reader.array(metadata.node_names);
+        auto mesh_slot_entries = reader.array(metadata.mesh_slots);
+        auto mesh_entries      = reader.array(metadata.meshes);
+
+        auto num_nodes = parent_entries.size();
+        if (name_entries.size() != num_nodes || mesh_slot_entries.size() != num_nodes
+            || file.binary_blob.size() != num_nodes * sizeof_matrix)
         {
-            node_matrices.insert({value[0], value[1]});
+            throw std::runtime_error{"error: prefab node arrays differ in size"};
         }
 
-        for (auto& [_, value] : metadata["node_names"].items())
+        for (std::size_t i{0}; i < num_nodes; ++i)
         {
-            node_names.insert({value[0], value[1]});
+            if (parent_entries[i] != no_parent && parent_entries[i] >= i)
+            {
+                auto msg = fmt::format("error: prefab node {} precedes its parent", i);
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            if (mesh_slot_entries[i] != no_mesh
+                && mesh_slot_entries[i] >= mesh_entries.size())
+            {
+                auto msg = fmt::format("error: prefab node {} has an invalid mesh", i);
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            if (!node_strings.contains(name_entries[i]))
+            {
+                throw std::runtime_error{"error: prefab string is out of range"};
+            }
         }
 
-        for (auto& [_, value] : metadata["node_parents"].items())
+        for (auto& mesh : mesh_entries)
         {
-            node_parents.insert({value[0], value[1]});
+            if (!node_strings.contains(mesh.mesh_path)
+                || !node_strings.contains(mesh.material_path))
+            {
+                throw std::runtime_error{"error: prefab string is out of range"};
+            }
         }
 
-        std::unordered_map<std::uint64_t, nlohmann::json> mesh_nodes =
-            metadata["node_meshes"];
+        strings = std::move(node_strings);
+        parents.assign(parent_entries.begin(), parent_entries.end());
+        node_names.assign(name_entries.begin(), name_entries.end());
+        mesh_slots.assign(mesh_slot_entries.begin(), mesh_slot_entries.end());
+        meshes.assign(mesh_entries.begin(), mesh_entries.end());
 
-        for (auto pair : mesh_nodes)
-        {
-            NodeMesh node;
+        local_matrices.resize(num_nodes);
+        std::memcpy(local_matrices.data(),
+                    file.binary_blob.data(),
+                    file.binary_blob.size());
+    }
 
-            node.mesh_path     = pair.second["mesh_path"];
-            node.material_path = pair.second["material_path"];
+    AssetFile PrefabAsset::pack() const
+    {
+        MetadataWriter<PrefabMetadata> writer;
 
-            node_meshes.insert({pair.first, node});
-        }
+        PrefabMetadata metadata;
+        metadata.strings    = add_string_table(writer, strings);
+        metadata.parents    = writer.add_array<std::uint32_t>(parents);
+        metadata.node_names = writer.add_array<StringId>(node_names);
+        metadata.mesh_slots = writer.add_array<std::uint32_t>(mesh_slots);
+        metadata.meshes     = writer.add_array<NodeMesh>(meshes);
 
-        std::size_t num_matrices = file.binary_blob.size() / sizeof_matrix;
-        matrices.resize(num_matrices);
+        AssetFile file;
+        file.type    = {'P', 'R', 'F', 'B'};
+        file.version = AssetFile::current_version;
+
+        file.binary_blob.resize(local_matrices.size() * sizeof_matrix);
+        std::memcpy(file.binary_blob.data(),
+                    local_matrices.data(),
+                    local_matrices.size() * sizeof_matrix);
 
-        std::memcpy(matrices.data(), file.binary_blob.data(), file.binary_blob.size());
+        file.metadata = writer.finish(metadata);
+        return file;
     }
 
-    AssetFile PrefabAsset::pack() const
+    std::string PrefabAsset::to_json() const
     {
-        nlohmann::json metadata;
-        metadata["node_matrices"] = node_matrices;
-        metadata["node_names"]    = node_names;
-        metadata["node_parents"]  = node_parents;
+        std::vector<std::string_view> names;
+        names.reserve(node_count());
+        for (std::size_t i{0}; i < node_count(); ++i)
+        {
+            names.push_back(node_name(i));
+        }
 
-        std::unordered_map<std::uint64_t, nlohmann::json> mesh_index;
-        for (auto pair : node_meshes)
+        std::vector<nlohmann::json> mesh_list;
+        for (auto& mesh : meshes)
         {
             nlohmann::json mesh_node;
-            mesh_node["mesh_path"]     = pair.second.mesh_path;
-            mesh_node["material_path"] = pair.second.material_path;
-            mesh_index.insert({pair.first, mesh_node});
+            mesh_node["mesh_path"]     = strings[mesh.mesh_path];
+            mesh_node["material_path"] = strings[mesh.material_path];
+            mesh_list.push_back(mesh_node);
         }
 
-        metadata["node_meshes"] = mesh_index;
+        nlohmann::json metadata;
+        metadata["parents"]        = parents;
+        metadata["names"]          = names;
+        metadata["mesh_slots"]     = mesh_slots;
+        metadata["meshes"]         = mesh_list;
+        metadata["local_matrices"] = local_matrices;
 
-        AssetFile file;
-        file.type    = {'P', 'R', 'F', 'B'};
-        file.version = AssetFile::current_version;
+        return metadata.dump(4);
+    }
 
-        file.binary_blob.resize(matrices.size() * sizeof_matrix);
-        std::memcpy(file.binary_blob.data(),
-                    matrices.data(),
-                    matrices.size() * sizeof_matrix);
+    std::uint32_t PrefabAsset::add_node(std::uint32_t parent,
+                                        Matrix4x4<float> const& local_matrix,
+                                        std::string_view name,
+                                        std::uint32_t mesh_slot)
+    {
+        auto node = static_cast<std::uint32_t>(node_count());
+        if (parent != no_parent && parent >= node)
+        {
+            throw std::runtime_error{"error: prefab parents must be added first"};
+        }
 
-        file.json = metadata.dump();
-        return file;
+        if (mesh_slot != no_mesh && mesh_slot >= meshes.size())
+        {
+            throw std::runtime_error{"error: prefab mesh slot is out of range"};
+        }
+
+        parents.push_back(parent);
+        local_matrices.push_back(local_matrix);
+        node_names.push_back(strings.intern(name));
+        mesh_slots.push_back(mesh_slot);
+        return node;
+    }
+
+    std::uint32_t PrefabAsset::add_mesh(std::string_view mesh_path,
+                                        std::string_view material_path)
+    {
+        NodeMesh mesh;
+        mesh.material_path = strings.intern(material_path);
+        mesh.mesh_path     = strings.intern(mesh_path);
+
+        meshes.push_back(mesh);
+        return static_cast<std::uint32_t>(meshes.size() - 1);
+    }
+
+    std::size_t PrefabAsset::node_count() const
+    {
+        return parents.size();
+    }
+
+    std::string_view PrefabAsset::node_name(std::size_t node) const
+    {
+        return strings[node_names[node]];
+    }
+
+    void compute_world_transforms(std::span<std::uint32_t const> parents,
+                                  std::span<Matrix4x4<float> const> local_matrices,
+                                  std::span<Matrix4x4<float>> world_matrices)
+    {
+        if (local_matrices.size() != parents.size()
+            || world_matrices.size() != parents.size())
+        {
+            throw std::runtime_error{"error: prefab transform arrays differ in size"};
+        }
+
+        for (std::size_t i{0}; i < parents.size(); ++i)
+        {
+            auto parent = parents[i];
+            if (parent == PrefabAsset::no_parent)
+            {
+                world_matrices[i] = local_matrices[i];
+                continue;
+            }
+
+            if (parent >= i)
+            {
+                auto msg = fmt::format("error: prefab node {} precedes its parent", i);
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            multiply(world_matrices[parent].data(),
+                     local_matrices[i].data(),
+                     world_matrices[i].data());
+        }
     }
 } // namespace assets
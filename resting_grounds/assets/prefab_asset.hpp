@@ -1,27 +1,65 @@
 #pragma once
 
 #include "asset_file.hpp"
+#include "string_table.hpp"
 #include "types.hpp"
 
-#include <unordered_map>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace assets
 {
+    // Node hierarchy stored as parallel arrays indexed by node, sorted so that every
+    // parent comes before its children.
     struct PrefabAsset
     {
+        static constexpr std::uint32_t no_parent{0xffffffff};
+        static constexpr std::uint32_t no_mesh{0xffffffff};
+
         void read(AssetFile const& file);
+        void read(AssetFileView const& file);
         AssetFile pack() const;
 
+        std::string to_json() const;
+
         struct NodeMesh
         {
-            std::string material_path;
-            std::string mesh_path;
+            StringId material_path;
+            StringId mesh_path;
         };
 
-        std::unordered_map<std::uint64_t, int> node_matrices;
-        std::unordered_map<std::uint64_t, std::string> node_names;
-        std::unordered_map<std::uint64_t, std::uint64_t> node_parents;
-        std::unordered_map<std::uint64_t, NodeMesh> node_meshes;
-        std::vector<Matrix4x4<float>> matrices;
+        // Appends a mesh for nodes to refer to and returns its slot.
+        std::uint32_t add_mesh(std::string_view mesh_path,
+                               std::string_view material_path);
+
+        // Appends a node under a parent that is already in the prefab, or no_parent for a
+        // root, and returns its index.
+        std::uint32_t add_node(std::uint32_t parent,
+                               Matrix4x4<float> const& local_matrix,
+                               std::string_view name,
+                               std::uint32_t mesh_slot = no_mesh);
+
+        std::size_t node_count() const;
+        std::string_view node_name(std::size_t node) const;
+
+        // Node names and mesh paths are IDs in strings.
+        StringTable strings;
+
+        std::vector<std::uint32_t> parents;
+        // Column-major transforms relative to the parent of each node.
+        std::vector<Matrix4x4<float>> local_matrices;
+        std::vector<StringId> node_names;
+        // Index into meshes, or no_mesh.
+        std::vector<std::uint32_t> mesh_slots;
+        std::vector<NodeMesh> meshes;
     };
+
+    // Multiplies each local matrix by the world matrix of its parent in a single pass
+    // over the nodes, which relies on parents preceding their children.
+    void compute_world_transforms(std::span<std::uint32_t const> parents,
+                                  std::span<Matrix4x4<float> const> local_matrices,
+                                  std::span<Matrix4x4<float>> world_matrices);
 } // namespace assets
@@ -0,0 +1,159 @@
+#include "string_table.hpp"
+
+#include <fmt/printf.h>
+
+#include <mutex>
+#include <shared_mutex>
+
+namespace assets
+{
+    namespace
+    {
+        struct GlobalStrings
+        {
+            std::shared_mutex mutex;
+            StringTable table;
+        };
+
+        GlobalStrings& global_strings()
+        {
+            static GlobalStrings strings;
+            return strings;
+        }
+    } // namespace
+
+    StringTable::StringTable(StringTable const& other)
+    {
+        *this = other;
+    }
+
+    StringTable& StringTable::operator=(StringTable const& other)
+    {
+        if (this != &other)
+        {
+            // The keys view the strings of their own table, so they are rebuilt.
+            m_strings.clear();
+            m_ids.clear();
+            for (auto& str : other.m_strings)
+            {
+                intern(str);
+            }
+        }
+
+        return *this;
+    }
+
+    StringId StringTable::intern(std::string_view str)
+    {
+        if (auto it = m_ids.find(str); it != m_ids.end())
+        {
+            return it->second;
+        }
+
+        auto id = static_cast<StringId>(m_strings.size());
+        m_ids.insert({m_strings.emplace_back(str), id});
+        return id;
+    }
+
+    std::optional<StringId> StringTable::find(std::string_view str) const
+    {
+        if (auto it = m_ids.find(str); it != m_ids.end())
+        {
+            return it->second;
+        }
+
+        return {};
+    }
+
+    std::string_view StringTable::operator[](StringId id) const
+    {
+        return m_strings[id];
+    }
+
+    bool StringTable::contains(StringId id) const
+    {
+        return id < m_strings.size();
+    }
+
+    std::size_t StringTable::size() const
+    {
+        return m_strings.size();
+    }
+
+    std::vector<StringId> StringTable::merge(StringTable const& other)
+    {
+        std::vector<StringId> ids;
+        ids.reserve(other.size());
+        for (auto& str : other.m_strings)
+        {
+            ids.push_back(intern(str));
+        }
+
+        return ids;
+    }
+
+    StringTable read_string_table(MetadataReader const& reader, MetadataStringTable ref)
+    {
+        auto chars   = reader.string(ref.chars);
+        auto offsets = reader.array(ref.offsets);
+        if (offsets.empty() || offsets.front() != 0 || offsets.back() != chars.size())
+        {
+            throw std::runtime_error{"error: string table is out of range"};
+        }
+
+        StringTable table;
+        for (std::size_t i{0}; i + 1 < offsets.size(); ++i)
+        {
+            if (offsets[i] > offsets[i + 1])
+            {
+                throw std::runtime_error{"error: string table is out of range"};
+            }
+
+            // IDs in the file must stay the IDs in the table.
+            auto str = chars.substr(offsets[i], offsets[i + 1] - offsets[i]);
+            if (table.intern(str) != i)
+            {
+                auto msg = fmt::format("error: string table repeats \"{}\"", str);
+                throw std::runtime_error{msg.c_str()};
+            }
+        }
+
+        return table;
+    }
+
+    StringId intern_string(std::string_view str)
+    {
+        auto& strings = global_strings();
+        {
+            std::shared_lock lock{strings.mutex};
+            if (auto id = strings.table.find(str); id)
+            {
+                return *id;
+            }
+        }
+
+        std::unique_lock lock{strings.mutex};
+        return strings.table.intern(str);
+    }
+
+    std::string_view interned_string(StringId id)
+    {
+        auto& strings = global_strings();
+
+        std::shared_lock lock{strings.mutex};
+        if (!strings.table.contains(id))
+        {
+            throw std::runtime_error{"error: unknown interned string"};
+        }
+
+        return strings.table[id];
+    }
+
+    std::vector<StringId> intern_strings(StringTable const& table)
+    {
+        auto& strings = global_strings();
+
+        std::unique_lock lock{strings.mutex};
+        return strings.table.merge(table);
+    }
+} // namespace assets
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "metadata.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace assets
+{
+    // Index of a string in a StringTable, assigned densely in the order strings are first
+    // interned. Equal IDs from the same table mean equal strings.
+    using StringId = std::uint32_t;
+
+    // Deduplicated strings of an asset, so that repeated names and paths are stored once
+    // and compared as integers. Views stay valid for the lifetime of the table.
+    class StringTable
+    {
+    public:
+        StringTable() = default;
+        StringTable(StringTable const& other);
+        StringTable(StringTable&& other) = default;
+
+        StringTable& operator=(StringTable const& other);
+        StringTable& operator=(StringTable&& other) = default;
+
+        StringId intern(std::string_view str);
+        std::optional<StringId> find(std::string_view str) const;
+
+        std::string_view operator[](StringId id) const;
+        bool contains(StringId id) const;
+        std::size_t size() const;
+
+        // Interns every string of another table, returning the ID in this table of each
+        // of its IDs.
+        std::vector<StringId> merge(StringTable const& other);
+
+    private:
+        std::deque<std::string> m_strings;
+        std::unordered_map<std::string_view, StringId> m_ids;
+    };
+
+    // A table is stored as its strings back to back followed by size() + 1 offsets.
+    struct MetadataStringTable
+    {
+        MetadataString chars;
+        MetadataArray<std::uint32_t> offsets;
+    };
+
+    template<typename Header>
+    MetadataStringTable add_string_table(MetadataWriter<Header>& writer,
+                                         StringTable const& table)
+    {
+        std::string chars;
+        std::vector<std::uint32_t> offsets{0};
+        offsets.reserve(table.size() + 1);
+        for (StringId id{0}; id < table.size(); ++id)
+        {
+            chars.append(table[id]);
+            offsets.push_back(static_cast<std::uint32_t>(chars.size()));
+        }
+
+        MetadataStringTable ref;
+        ref.chars   = writer.add_string(chars);
+        ref.offsets = writer.template add_array<std::uint32_t>(offsets);
+        return ref;
+    }
+
+    StringTable read_string_table(MetadataReader const& reader, MetadataStringTable ref);
+
+    // Process-wide table for comparing strings from different assets by ID. It is safe to
+    // use from any thread, and its strings are never freed.
+    StringId intern_string(std::string_view str);
+    std::string_view interned_string(StringId id);
+    std::vector<StringId> intern_strings(StringTable const& table);
+} // namespace assets
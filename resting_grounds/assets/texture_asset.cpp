@@ -1,92 +1,381 @@
 #include "texture_asset.hpp"
+#include "metadata.hpp"
 
 #include <core/memory_buffer.hpp>
 
 #include <fmt/printf.h>
-#include <lz4.h>
 #include <magic_enum.hpp>
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
 namespace assets
 {
-    void TextureAsset::read(AssetFile const& file)
+    namespace
     {
-        auto metadata = nlohmann::json::parse(file.json);
+        struct PageRecord
+        {
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t compressed_size;
+            std::uint32_t original_size;
+            ChunkCodec codec;
+        };
+
+        // Only pages split into several tiles have tile records, stored in page order.
+        struct TileRecord
+        {
+            std::uint32_t compressed_size;
+            std::uint32_t original_size;
+            ChunkCodec codec;
+        };
+
+        struct TextureMetadata
+        {
+            std::uint64_t texture_size;
+            TextureFormat texture_format;
+            ChunkCodec codec;
+            std::uint32_t tile_size;
+            std::uint32_t reserved{0};
+            MetadataString original_file;
+            MetadataArray<PageRecord> pages;
+            MetadataArray<TileRecord> tiles;
+        };
+
+        static_assert(sizeof(TextureMetadata) == 48);
+
+        // Pages that don't get below this fraction of their size are not worth the
+        // decompression time and are stored as-is.
+        static constexpr float max_page_ratio{0.8f};
+
+        std::uint32_t tile_count(std::uint32_t extent, std::uint32_t tile_size)
+        {
+            return (tile_size == 0) ? 1 : (extent + tile_size - 1) / tile_size;
+        }
 
-        std::string format_string = metadata["format"];
-        if (auto ret = magic_enum::enum_cast<TextureFormat>(format_string); ret)
+        // A page is only split when it doesn't fit in a single tile.
+        std::pair<std::uint32_t, std::uint32_t> tile_grid(TextureAsset const& texture,
+                                                          TextureAsset::Page const& page)
         {
-            texture_format = *ret;
+            auto tiles_x = tile_count(page.width, texture.tile_size);
+            auto tiles_y = tile_count(page.height, texture.tile_size);
+            if (tiles_x * tiles_y == 1)
+            {
+                return {1, 1};
+            }
+
+            return {tiles_x, tiles_y};
         }
-        else
+
+        // Where the rows of a tile live within its page, in units of texel blocks.
+        struct TileRows
         {
-            auto msg = fmt::format("error: failed to parse texture format, received {}",
-                                   format_string);
-            throw std::runtime_error{msg.c_str()};
+            std::size_t page_offset;
+            std::size_t page_pitch;
+            std::size_t row_size;
+            std::size_t row_count;
+        };
+
+        TileRows tile_rows(TextureAsset const& texture,
+                           TextureAsset::Page const& page,
+                           std::uint32_t x,
+                           std::uint32_t y)
+        {
+            auto block = texel_block(texture.texture_format);
+
+            std::size_t page_blocks_x = (page.width + block.width - 1) / block.width;
+            std::size_t page_blocks_y = (page.height + block.height - 1) / block.height;
+            std::size_t tile_blocks_x = texture.tile_size / block.width;
+            std::size_t tile_blocks_y = texture.tile_size / block.height;
+
+            auto first_x = x * tile_blocks_x;
+            auto first_y = y * tile_blocks_y;
+            auto width   = std::min(tile_blocks_x, page_blocks_x - first_x);
+
+            TileRows rows;
+            rows.page_pitch  = page_blocks_x * block.size;
+            rows.page_offset = first_y * rows.page_pitch + first_x * block.size;
+            rows.row_size    = width * block.size;
+            rows.row_count   = std::min(tile_blocks_y, page_blocks_y - first_y);
+            return rows;
+        }
+
+        bool decompress_tile(TextureAsset::Tile const& tile,
+                             std::span<std::byte const> source_buffer,
+                             std::byte* destination)
+        {
+            if (tile.offset + tile.compressed_size > source_buffer.size())
+            {
+                return false;
+            }
+
+            try
+            {
+                decompress_exact(tile.codec.codec,
+                                 source_buffer.subspan(tile.offset, tile.compressed_size),
+                                 {destination, tile.original_size});
+            }
+            catch (std::runtime_error const&)
+            {
+                return false;
+            }
+
+            return true;
+        }
+
+        // Decodes one tile of a page into the page's own layout. Whole pages go straight
+        // to the destination, split ones through a scratch buffer.
+        bool decompress_page_tile(TextureAsset const& texture,
+                                  TextureAsset::Page const& page,
+                                  std::size_t tile_index,
+                                  std::span<std::byte const> source_buffer,
+                                  std::byte* page_destination,
+                                  std::vector<std::byte>& scratch)
+        {
+            auto const& tile = texture.tiles[page.first_tile + tile_index];
+            if (page.tiles_x * page.tiles_y == 1)
+            {
+                return decompress_tile(tile, source_buffer, page_destination);
+            }
+
+            scratch.resize(tile.original_size);
+            if (!decompress_tile(tile, source_buffer, scratch.data()))
+            {
+                return false;
+            }
+
+            auto rows = tile_rows(texture,
+                                  page,
+                                  static_cast<std::uint32_t>(tile_index % page.tiles_x),
+                                  static_cast<std::uint32_t>(tile_index / page.tiles_x));
+            for (std::size_t row{0}; row < rows.row_count; ++row)
+            {
+                std::memcpy(page_destination + rows.page_offset + row * rows.page_pitch,
+                            scratch.data() + row * rows.row_size,
+                            rows.row_size);
+            }
+
+            return true;
         }
 
-        std::string compression_string = metadata["compression"];
-        if (auto ret = magic_enum::enum_cast<CompressionMode>(compression_string); ret)
+        std::pair<std::vector<std::byte>, std::vector<std::size_t>>
+        allocate_destination(TextureAsset const& texture)
         {
-            compression_mode = *ret;
+            std::vector<std::size_t> offsets(texture.pages.size());
+            std::size_t dest_size{0};
+            for (std::size_t i{0}; i < texture.pages.size(); ++i)
+            {
+                offsets[i] = dest_size;
+                dest_size += texture.pages[i].original_size;
+            }
+
+            return {std::vector<std::byte>(dest_size), std::move(offsets)};
         }
-        else
+    } // namespace
+
+    TexelBlock texel_block(TextureFormat format)
+    {
+        switch (format)
         {
-            auto msg = fmt::format("error: failed to parse compression mode, recieved {}",
-                                   compression_string);
+        case TextureFormat::rgba_uint8:
+            return {1, 1, 4};
+
+        case TextureFormat::rgba_float32:
+            return {1, 1, 16};
+
+        case TextureFormat::rgba_float16:
+            return {1, 1, 8};
+
+        case TextureFormat::rgb9e5:
+        case TextureFormat::r11g11b10f:
+            return {1, 1, 4};
+
+        case TextureFormat::bc1_rgba_unorm:
+        case TextureFormat::bc4_r_unorm:
+            return {4, 4, 8};
+
+        case TextureFormat::bc3_rgba_unorm:
+        case TextureFormat::bc5_rg_unorm:
+        case TextureFormat::bc6h_rgb_ufloat:
+        case TextureFormat::bc6h_rgb_sfloat:
+        case TextureFormat::bc7_rgba_unorm:
+            return {4, 4, 16};
+
+        default:
+            break;
+        }
+
+        auto msg = fmt::format("error: texture format {} has no texel layout",
+                               magic_enum::enum_integer(format));
+        throw std::runtime_error{msg.c_str()};
+    }
+
+    void TextureAsset::read(AssetFile const& file)
+    {
+        read(file.view());
+    }
+
+    void TextureAsset::read(AssetFileView const& file)
+    {
+        MetadataReader reader{file.metadata};
+        auto metadata = reader.header<TextureMetadata>();
+
+        if (!magic_enum::enum_contains(metadata.texture_format))
+        {
+            auto msg = fmt::format("error: failed to parse texture format, received {}",
+                                   magic_enum::enum_integer(metadata.texture_format));
             throw std::runtime_error{msg.c_str()};
         }
+        texture_format = metadata.texture_format;
 
-        texture_size  = metadata["buffer_size"];
-        original_file = metadata["original_file"];
+        validate_codec(metadata.codec);
+        codec = metadata.codec;
 
-        for (auto& [key, value] : metadata["pages"].items())
+        texture_size  = metadata.texture_size;
+        tile_size     = metadata.tile_size;
+        original_file = reader.string(metadata.original_file);
+
+        auto page_records = reader.array(metadata.pages);
+        auto tile_records = reader.array(metadata.tiles);
+        pages.resize(page_records.size());
+        tiles.clear();
+
+        std::uint64_t offset{0};
+        std::size_t next_record{0};
+        for (std::size_t i{0}; i < page_records.size(); ++i)
         {
-            Page page;
+            auto& page = pages[i];
+
+            page.compressed_size = page_records[i].compressed_size;
+            page.original_size   = page_records[i].original_size;
+            page.width           = page_records[i].width;
+            page.height          = page_records[i].height;
+            page.codec           = page_records[i].codec;
+            page.offset          = offset;
+            page.first_tile      = tiles.size();
+
+            validate_codec(page.codec);
+
+            std::tie(page.tiles_x, page.tiles_y) = tile_grid(*this, page);
+            if (page.tiles_x * page.tiles_y == 1)
+            {
+                tiles.push_back({page.width,
+                                 page.height,
+                                 page.compressed_size,
+                                 page.original_size,
+                                 page.codec,
+                                 page.offset});
+            }
+            else
+            {
+                // Tiles follow each other in the blob just like pages do.
+                auto tile_offset = page.offset;
+                for (std::uint32_t y{0}; y < page.tiles_y; ++y)
+                {
+                    for (std::uint32_t x{0}; x < page.tiles_x; ++x)
+                    {
+                        if (next_record == tile_records.size())
+                        {
+                            throw std::runtime_error{"error: missing texture tiles"};
+                        }
+
+                        auto const& record = tile_records[next_record++];
+                        validate_codec(record.codec);
+
+                        auto rows = tile_rows(*this, page, x, y);
+                        if (record.original_size != rows.row_size * rows.row_count)
+                        {
+                            throw std::runtime_error{"error: invalid texture tile size"};
+                        }
+
+                        Tile tile;
+                        tile.width  = std::min(tile_size, page.width - x * tile_size);
+                        tile.height = std::min(tile_size, page.height - y * tile_size);
+                        tile.compressed_size = record.compressed_size;
+                        tile.original_size   = record.original_size;
+                        tile.codec           = record.codec;
+                        tile.offset          = tile_offset;
+                        tiles.push_back(tile);
+
+                        tile_offset += tile.compressed_size;
+                    }
+                }
 
-            page.compressed_size = value["compressed_size"];
-            page.original_size   = value["original_size"];
-            page.width           = value["width"];
-            page.height          = value["height"];
+                if (tile_offset != page.offset + page.compressed_size)
+                {
+                    throw std::runtime_error{"error: tiles don't fill their page"};
+                }
+            }
 
-            pages.push_back(page);
+            offset += page.compressed_size;
         }
     }
 
     std::vector<std::byte>
-    TextureAsset::unpack(std::vector<std::byte> const& source_buffer) const
+    TextureAsset::unpack(std::span<std::byte const> source_buffer) const
     {
-        // Loop through to figure out the size of the destination buffer.
-        std::size_t dest_size = std::accumulate(pages.begin(),
-                                                pages.end(),
-                                                std::uint32_t{0},
-                                                [](std::uint32_t sum, Page p) {
-                                                    return sum + p.original_size;
-                                                });
-
-        std::vector<std::byte> destination(dest_size);
-        auto source = core::to_const_data_ptr(source_buffer);
-        auto dest   = core::to_data_ptr(destination);
-
-        if (compression_mode == CompressionMode::lz4)
-        {
-            for (auto& page : pages)
-            {
-                if (LZ4_decompress_safe(source,
-                                        dest,
-                                        page.compressed_size,
-                                        page.original_size)
-                    < 0)
+        auto [destination, offsets] = allocate_destination(*this);
+
+        std::vector<std::byte> scratch;
+        for (std::size_t i{0}; i < pages.size(); ++i)
+        {
+            auto const& page = pages[i];
+            for (std::size_t t{0}; t < page.tiles_x * page.tiles_y; ++t)
+            {
+                if (!decompress_page_tile(*this,
+                                          page,
+                                          t,
+                                          source_buffer,
+                                          destination.data() + offsets[i],
+                                          scratch))
                 {
                     return {};
                 }
-                source += page.compressed_size;
-                dest += page.original_size;
             }
         }
-        else
+
+        return destination;
+    }
+
+    std::vector<std::byte> TextureAsset::unpack(std::span<std::byte const> source_buffer,
+                                                ThreadPool& pool) const
+    {
+        auto [destination, offsets] = allocate_destination(*this);
+
+        // Tiles are independent chunks with known source and destination offsets, so
+        // each one can be decoded on its own thread. Splitting large pages into tiles
+        // also keeps the top mip from serialising the whole texture.
+        std::vector<std::size_t> tile_pages(tiles.size());
+        for (std::size_t i{0}; i < pages.size(); ++i)
         {
-            destination = source_buffer;
+            auto const& page = pages[i];
+            std::fill_n(tile_pages.begin() + page.first_tile,
+                        page.tiles_x * page.tiles_y,
+                        i);
+        }
+
+        std::atomic<bool> failed{false};
+        pool.parallel_for(tiles.size(), [&](std::size_t t) {
+            thread_local std::vector<std::byte> scratch;
+
+            auto i           = tile_pages[t];
+            auto const& page = pages[i];
+            if (!decompress_page_tile(*this,
+                                      page,
+                                      t - page.first_tile,
+                                      source_buffer,
+                                      destination.data() + offsets[i],
+                                      scratch))
+            {
+                failed = true;
+            }
+        });
+
+        if (failed)
+        {
+            return {};
         }
 
         return destination;
@@ -94,40 +383,52 @@ namespace assets
 
     std::vector<std::byte>
     TextureAsset::unpack_page(int page_index,
-                              std::vector<std::byte> const& source_buffer) const
+                              std::span<std::byte const> source_buffer) const
     {
-        auto source = core::to_const_data_ptr(source_buffer);
-        for (int i{0}; i < page_index; ++i)
-        {
-            source += pages[i].compressed_size;
-        }
-
-        auto page = pages[page_index];
+        auto const& page = pages[page_index];
         std::vector<std::byte> destination(page.original_size);
 
-        if (compression_mode == CompressionMode::lz4)
+        std::vector<std::byte> scratch;
+        for (std::size_t t{0}; t < page.tiles_x * page.tiles_y; ++t)
         {
-            // Check if the compressed size matches the original. If it does, it wasn't
-            // compressed to begin with.
-            if (page.compressed_size != page.original_size)
+            if (!decompress_page_tile(*this,
+                                      page,
+                                      t,
+                                      source_buffer,
+                                      destination.data(),
+                                      scratch))
             {
-                if (LZ4_decompress_safe(source,
-                                        core::to_data_ptr(destination),
-                                        page.compressed_size,
-                                        page.original_size)
-                    < 0)
-                {
-                    return {};
-                }
-            }
-            else
-            {
-                std::memcpy(core::to_data_ptr(destination), source, page.original_size);
+                return {};
             }
         }
-        else
+
+        return destination;
+    }
+
+    std::vector<std::byte>
+    TextureAsset::unpack_tile(int page_index,
+                              std::uint32_t x,
+                              std::uint32_t y,
+                              std::span<std::byte const> source_buffer) const
+    {
+        auto const& page = pages[page_index];
+        if (x >= page.tiles_x || y >= page.tiles_y)
+        {
+            auto msg = fmt::format("error: tile ({}, {}) is outside the {}x{} tiles of "
+                                   "page {}",
+                                   x,
+                                   y,
+                                   page.tiles_x,
+                                   page.tiles_y,
+                                   page_index);
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        auto const& tile = tiles[page.first_tile + y * page.tiles_x + x];
+        std::vector<std::byte> destination(tile.original_size);
+        if (!decompress_tile(tile, source_buffer, destination.data()))
         {
-            std::memcpy(core::to_data_ptr(destination), source, page.original_size);
+            return {};
         }
 
         return destination;
@@ -139,55 +440,129 @@ namespace assets
         file.type    = {'T', 'E', 'X', 'I'};
         file.version = AssetFile::current_version;
 
-        auto pixels = core::to_const_data_ptr(pixel_data);
-        std::vector<std::byte> page_buffer;
-        for (auto& p : pages)
+        if (tile_size != 0)
         {
-            page_buffer.resize(p.original_size);
-            int compressed_size{0};
-            if (compression_mode == CompressionMode::lz4)
+            auto block = texel_block(texture_format);
+            if (tile_size % block.width != 0 || tile_size % block.height != 0)
             {
-                int compress_staging = LZ4_compressBound(p.original_size);
-                page_buffer.resize(compress_staging);
-                compressed_size = LZ4_compress_default(pixels,
-                                                       core::to_data_ptr(page_buffer),
-                                                       p.original_size,
-                                                       compress_staging);
+                auto msg = fmt::format("error: tile size {} is not a multiple of the "
+                                       "{}x{} blocks of {}",
+                                       tile_size,
+                                       block.width,
+                                       block.height,
+                                       magic_enum::enum_name(texture_format));
+                throw std::runtime_error{msg.c_str()};
+            }
+        }
 
-                float compression_rate =
-                    compressed_size / static_cast<float>(texture_size);
+        auto add_tile = [this, &file](std::uint32_t width,
+                                      std::uint32_t height,
+                                      std::span<std::byte const> bytes) {
+            Tile tile;
+            tile.width         = width;
+            tile.height        = height;
+            tile.original_size = static_cast<std::uint32_t>(bytes.size());
+            tile.offset        = file.binary_blob.size();
+            tile.codec = compress_chunk(codec, bytes, file.binary_blob, max_page_ratio);
+            tile.compressed_size =
+                static_cast<std::uint32_t>(file.binary_blob.size() - tile.offset);
+            tiles.push_back(tile);
+        };
 
-                if (compression_rate > 0.8f)
-                {
-                    compressed_size = p.original_size;
-                    page_buffer.resize(compressed_size);
-                    std::memcpy(page_buffer.data(), pixels, compressed_size);
-                }
-                else
-                {
-                    page_buffer.resize(compressed_size);
-                }
+        tiles.clear();
+
+        std::vector<std::byte> tile_bytes;
+        std::size_t pixel_offset{0};
+        for (auto& p : pages)
+        {
+            auto page_pixels =
+                std::span{pixel_data}.subspan(pixel_offset, p.original_size);
+
+            p.offset     = file.binary_blob.size();
+            p.first_tile = tiles.size();
+            std::tie(p.tiles_x, p.tiles_y) = tile_grid(*this, p);
+
+            if (p.tiles_x * p.tiles_y == 1)
+            {
+                add_tile(p.width, p.height, page_pixels);
+                p.codec = tiles.back().codec;
             }
             else
             {
-                compressed_size = p.original_size;
-                page_buffer.resize(compressed_size);
-                std::memcpy(page_buffer.data(), pixels, compressed_size);
+                for (std::uint32_t y{0}; y < p.tiles_y; ++y)
+                {
+                    for (std::uint32_t x{0}; x < p.tiles_x; ++x)
+                    {
+                        auto rows = tile_rows(*this, p, x, y);
+                        tile_bytes.resize(rows.row_size * rows.row_count);
+                        for (std::size_t row{0}; row < rows.row_count; ++row)
+                        {
+                            std::memcpy(tile_bytes.data() + row * rows.row_size,
+                                        page_pixels.data() + rows.page_offset
+                                            + row * rows.page_pitch,
+                                        rows.row_size);
+                        }
+
+                        add_tile(std::min(tile_size, p.width - x * tile_size),
+                                 std::min(tile_size, p.height - y * tile_size),
+                                 tile_bytes);
+                    }
+                }
+
+                // Every tile records its own codec, the page keeps the requested one.
+                p.codec = codec;
             }
 
-            p.compressed_size = compressed_size;
-            file.binary_blob.insert(file.binary_blob.end(),
-                                    page_buffer.begin(),
-                                    page_buffer.end());
+            p.compressed_size =
+                static_cast<std::uint32_t>(file.binary_blob.size() - p.offset);
 
-            pixels += p.original_size;
+            pixel_offset += p.original_size;
         }
 
+        std::vector<PageRecord> page_records;
+        std::vector<TileRecord> tile_records;
+        page_records.reserve(pages.size());
+        for (auto& p : pages)
+        {
+            page_records.push_back(
+                {p.width, p.height, p.compressed_size, p.original_size, p.codec});
+
+            if (p.tiles_x * p.tiles_y == 1)
+            {
+                continue;
+            }
+
+            for (std::size_t t{0}; t < p.tiles_x * p.tiles_y; ++t)
+            {
+                auto const& tile = tiles[p.first_tile + t];
+                tile_records.push_back(
+                    {tile.compressed_size, tile.original_size, tile.codec});
+            }
+        }
+
+        TextureMetadata metadata;
+        metadata.texture_size   = texture_size;
+        metadata.texture_format = texture_format;
+        metadata.codec          = codec;
+        metadata.tile_size      = tile_size;
+
+        MetadataWriter<TextureMetadata> writer;
+        metadata.original_file = writer.add_string(original_file);
+        metadata.pages         = writer.add_array<PageRecord>(page_records);
+        metadata.tiles         = writer.add_array<TileRecord>(tile_records);
+
+        file.metadata = writer.finish(metadata);
+        return file;
+    }
+
+    std::string TextureAsset::to_json() const
+    {
         nlohmann::json metadata;
         metadata["format"]        = magic_enum::enum_name(texture_format);
         metadata["buffer_size"]   = texture_size;
         metadata["original_file"] = original_file;
-        metadata["compression"]   = magic_enum::enum_name(compression_mode);
+        metadata["codec"]         = codec_name(codec);
+        metadata["tile_size"]     = tile_size;
 
         std::vector<nlohmann::json> page_json;
         for (auto& p : pages)
@@ -197,11 +572,12 @@ namespace assets
             page["original_size"]   = p.original_size;
             page["width"]           = p.width;
             page["height"]          = p.height;
+            page["codec"]           = codec_name(p.codec);
+            page["tiles"]           = {p.tiles_x, p.tiles_y};
             page_json.push_back(page);
         }
         metadata["pages"] = page_json;
 
-        file.json = metadata.dump();
-        return file;
+        return metadata.dump(4);
     }
 } // namespace assets
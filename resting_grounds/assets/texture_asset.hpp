@@ -1,38 +1,106 @@
 #pragma once
 
 #include "asset_file.hpp"
+#include "codec.hpp"
+#include "thread_pool.hpp"
 
 namespace assets
 {
-    enum class TextureFormat
+    enum class TextureFormat : std::uint32_t
     {
         unknonw = 0,
         rgba_uint8,
-        rgba_float32
+        rgba_float32,
+        // Block-compressed formats, stored as 4x4 texel blocks in row-major order.
+        bc1_rgba_unorm,
+        bc3_rgba_unorm,
+        bc4_r_unorm,
+        bc5_rg_unorm,
+        bc6h_rgb_ufloat,
+        bc6h_rgb_sfloat,
+        bc7_rgba_unorm,
+        // Compact HDR formats, one texel at a time like rgba_float32.
+        rgba_float16,
+        // Unsigned RGB packed into 32 bits, see half_float.hpp.
+        rgb9e5,
+        r11g11b10f
     };
 
+    // Smallest unit of texels a format stores: single texels for uncompressed formats,
+    // 4x4 blocks for block-compressed ones.
+    struct TexelBlock
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t size;
+    };
+
+    TexelBlock texel_block(TextureFormat format);
+
     struct TextureAsset
     {
         void read(AssetFile const& file);
-        std::vector<std::byte> unpack(std::vector<std::byte> const& source_buffer) const;
+        void read(AssetFileView const& file);
+        std::vector<std::byte> unpack(std::span<std::byte const> source_buffer) const;
+        std::vector<std::byte> unpack(std::span<std::byte const> source_buffer,
+                                      ThreadPool& pool) const;
         std::vector<std::byte>
-        unpack_page(int page_index, std::vector<std::byte> const& source_buffer) const;
+        unpack_page(int page_index, std::span<std::byte const> source_buffer) const;
+        // Decodes a single tile of a page, laid out as rows of the tile's own width.
+        // Pages that aren't split consist of the one tile (0, 0).
+        std::vector<std::byte> unpack_tile(int page_index,
+                                           std::uint32_t x,
+                                           std::uint32_t y,
+                                           std::span<std::byte const> source) const;
 
         AssetFile pack(std::vector<std::byte> const& pixel_data);
 
+        std::string to_json() const;
+
+        // A region of a page that is compressed on its own. Tiles cover their page in
+        // row-major order, and those along the right and bottom edges are clipped to it.
+        struct Tile
+        {
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t compressed_size;
+            std::uint32_t original_size;
+            ChunkCodec codec;
+
+            // Byte offset of the tile within the binary blob, rebuilt like page offsets.
+            std::uint64_t offset;
+        };
+
         struct Page
         {
             std::uint32_t width;
             std::uint32_t height;
             std::uint32_t compressed_size;
             std::uint32_t original_size;
+            ChunkCodec codec;
+
+            // Byte offset of the page within the binary blob. Not stored in the file, it
+            // is rebuilt by read() and pack() so pages can be located in O(1).
+            std::uint64_t offset;
+
+            // Tiles of the page in the tile list, also rebuilt by read() and pack().
+            std::uint32_t tiles_x;
+            std::uint32_t tiles_y;
+            std::size_t first_tile;
         };
 
         std::uint64_t texture_size;
         TextureFormat texture_format;
-        CompressionMode compression_mode;
+        // Codec pack() compresses every page with. Pages that don't compress well are
+        // stored as-is and record that in their own codec.
+        ChunkCodec codec;
+
+        // Edge length, in texels, of the tiles that pages larger than one tile are split
+        // into so regions can be streamed in on their own. 0 keeps every page whole.
+        std::uint32_t tile_size{0};
 
         std::string original_file;
         std::vector<Page> pages;
+        std::vector<Tile> tiles;
     };
 } // namespace assets
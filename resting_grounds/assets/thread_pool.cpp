@@ -0,0 +1,202 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace assets
+{
+    namespace
+    {
+        thread_local ThreadPool const* current_pool{nullptr};
+        thread_local std::size_t current_index{0};
+    } // namespace
+
+    ThreadPool::ThreadPool(std::size_t num_threads)
+    {
+        num_threads = std::max<std::size_t>(num_threads, 1);
+
+        m_queues.reserve(num_threads);
+        for (std::size_t i{0}; i < num_threads; ++i)
+        {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+
+        m_workers.reserve(num_threads);
+        for (std::size_t i{0}; i < num_threads; ++i)
+        {
+            m_workers.emplace_back([this, i]() {
+                worker_loop(i);
+            });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::scoped_lock lock{m_mutex};
+            m_stop = true;
+        }
+
+        m_condition.notify_all();
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::enqueue(std::function<void()> task)
+    {
+        std::size_t index;
+        if (current_pool == this)
+        {
+            index = current_index;
+        }
+        else
+        {
+            std::scoped_lock lock{m_mutex};
+            index        = m_next_queue;
+            m_next_queue = (m_next_queue + 1) % m_queues.size();
+        }
+
+        {
+            auto& queue = *m_queues[index];
+            std::scoped_lock lock{queue.mutex};
+            queue.tasks.push_back(std::move(task));
+        }
+
+        {
+            std::scoped_lock lock{m_mutex};
+            ++m_pending;
+        }
+
+        m_condition.notify_one();
+    }
+
+    void ThreadPool::parallel_for(std::size_t count,
+                                  std::function<void(std::size_t)> const& fn)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        // Helpers that are dequeued after every index has been claimed exit without
+        // touching fn, so only the shared state may outlive this call.
+        struct SharedState
+        {
+            std::atomic<std::size_t> next{0};
+            std::atomic<std::size_t> completed{0};
+            std::exception_ptr error;
+            std::mutex error_mutex;
+        };
+
+        auto state = std::make_shared<SharedState>();
+        auto run   = [state, count, fn_ptr = &fn]() {
+            for (auto i = state->next++; i < count; i = state->next++)
+            {
+                try
+                {
+                    (*fn_ptr)(i);
+                }
+                catch (...)
+                {
+                    std::scoped_lock lock{state->error_mutex};
+                    if (!state->error)
+                    {
+                        state->error = std::current_exception();
+                    }
+                }
+
+                if (++state->completed == count)
+                {
+                    state->completed.notify_all();
+                }
+            }
+        };
+
+        std::size_t num_helpers = std::min(count, m_workers.size()) - 1;
+        for (std::size_t i{0}; i < num_helpers; ++i)
+        {
+            enqueue(run);
+        }
+
+        run();
+        auto done = state->completed.load();
+        while (done < count)
+        {
+            state->completed.wait(done);
+            done = state->completed.load();
+        }
+
+        if (state->error)
+        {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    std::size_t ThreadPool::size() const
+    {
+        return m_workers.size();
+    }
+
+    bool ThreadPool::try_pop(std::size_t index, std::function<void()>& task)
+    {
+        {
+            auto& own = *m_queues[index];
+            std::scoped_lock lock{own.mutex};
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+
+        for (std::size_t i{1}; i < m_queues.size(); ++i)
+        {
+            auto& victim = *m_queues[(index + i) % m_queues.size()];
+            std::scoped_lock lock{victim.mutex};
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void ThreadPool::worker_loop(std::size_t index)
+    {
+        current_pool  = this;
+        current_index = index;
+
+        for (;;)
+        {
+            std::function<void()> task;
+            if (try_pop(index, task))
+            {
+                {
+                    std::scoped_lock lock{m_mutex};
+                    --m_pending;
+                }
+
+                task();
+                continue;
+            }
+
+            std::unique_lock lock{m_mutex};
+            if (m_stop && m_pending <= 0)
+            {
+                return;
+            }
+
+            m_condition.wait(lock, [this]() {
+                return m_stop || m_pending > 0;
+            });
+        }
+    }
+} // namespace assets
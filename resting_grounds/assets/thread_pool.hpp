@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace assets
+{
+    // Work-stealing thread pool. Every worker owns a deque: tasks enqueued from a worker
+    // go to the back of its own deque and are popped LIFO, while idle workers steal
+    // from the front of the others. Tasks enqueued from outside the pool are spread
+    // round-robin across the workers.
+    class ThreadPool
+    {
+    public:
+        ThreadPool(std::size_t num_threads = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(ThreadPool const&)            = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        void enqueue(std::function<void()> task);
+
+        // Invokes fn(i) for every i in [0, count) and blocks until all calls have
+        // finished. The calling thread takes part in the work, so it is safe to call
+        // this from inside a task running on the same pool. The first exception thrown
+        // by fn is re-thrown here.
+        void parallel_for(std::size_t count, std::function<void(std::size_t)> const& fn);
+
+        std::size_t size() const;
+
+    private:
+        struct WorkerQueue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        bool try_pop(std::size_t index, std::function<void()>& task);
+        void worker_loop(std::size_t index);
+
+        std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+        std::vector<std::thread> m_workers;
+        std::size_t m_next_queue{0};
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        std::ptrdiff_t m_pending{0};
+        bool m_stop{false};
+    };
+} // namespace assets
@@ -0,0 +1,258 @@
+#include "vertex_format.hpp"
+#include "half_float.hpp"
+
+#include <fmt/printf.h>
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace assets
+{
+    namespace
+    {
+        template<typename T>
+        T to_unorm(float value)
+        {
+            constexpr float scale = std::numeric_limits<T>::max();
+            return static_cast<T>(std::lround(std::clamp(value, 0.0f, 1.0f) * scale));
+        }
+
+        template<typename T>
+        float from_unorm(T value)
+        {
+            return value / static_cast<float>(std::numeric_limits<T>::max());
+        }
+
+        template<typename T>
+        T to_snorm(float value)
+        {
+            constexpr float scale = std::numeric_limits<T>::max();
+            return static_cast<T>(std::lround(std::clamp(value, -1.0f, 1.0f) * scale));
+        }
+
+        template<typename T>
+        float from_snorm(T value)
+        {
+            auto scale = static_cast<float>(std::numeric_limits<T>::max());
+            return std::max(value / scale, -1.0f);
+        }
+
+        float sign_not_zero(float value)
+        {
+            return (value >= 0.0f) ? 1.0f : -1.0f;
+        }
+
+        Vector3D<float> cross(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return {a[1] * b[2] - a[2] * b[1],
+                    a[2] * b[0] - a[0] * b[2],
+                    a[0] * b[1] - a[1] * b[0]};
+        }
+
+        float dot(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        // Projects the direction onto an octahedron and unfolds it onto the [-1, 1]
+        // square. A zero vector ends up as +z.
+        template<typename T>
+        std::array<T, 2> encode_octahedral(Vector3D<float> const& direction)
+        {
+            float length =
+                std::abs(direction[0]) + std::abs(direction[1]) + std::abs(direction[2]);
+            if (length == 0.0f)
+            {
+                return {0, 0};
+            }
+
+            float x = direction[0] / length;
+            float y = direction[1] / length;
+            if (direction[2] < 0.0f)
+            {
+                float folded_x = (1.0f - std::abs(y)) * sign_not_zero(x);
+                float folded_y = (1.0f - std::abs(x)) * sign_not_zero(y);
+                x              = folded_x;
+                y              = folded_y;
+            }
+
+            return {to_snorm<T>(x), to_snorm<T>(y)};
+        }
+
+        template<typename T>
+        Vector3D<float> decode_octahedral(std::array<T, 2> const& encoded)
+        {
+            Vector3D<float> direction;
+            direction[0] = from_snorm(encoded[0]);
+            direction[1] = from_snorm(encoded[1]);
+            direction[2] = 1.0f - std::abs(direction[0]) - std::abs(direction[1]);
+
+            float fold = std::max(-direction[2], 0.0f);
+            direction[0] += (direction[0] >= 0.0f) ? -fold : fold;
+            direction[1] += (direction[1] >= 0.0f) ? -fold : fold;
+
+            float length = std::sqrt(dot(direction, direction));
+            for (auto& value : direction)
+            {
+                value /= length;
+            }
+
+            return direction;
+        }
+
+        template<typename QVertex>
+        void encode(std::span<Vertex const> vertices,
+                    BoundingBox const& box,
+                    std::byte* destination)
+        {
+            using DirectionType = typename decltype(QVertex::normal)::value_type;
+            using ColourType    = typename decltype(QVertex::colour)::value_type;
+
+            Vector3D<float> scale;
+            for (std::size_t k{0}; k < 3; ++k)
+            {
+                float range = box.max[k] - box.min[k];
+                scale[k]    = (range > 0.0f) ? 1.0f / range : 0.0f;
+            }
+
+            for (auto const& vertex : vertices)
+            {
+                QVertex out;
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    out.position[k] = to_unorm<std::uint16_t>(
+                        (vertex.position[k] - box.min[k]) * scale[k]);
+                }
+
+                auto bitangent     = cross(vertex.normal, vertex.tangent);
+                out.bitangent_sign = (dot(bitangent, vertex.bitangent) < 0.0f) ? -1 : 1;
+                out.normal         = encode_octahedral<DirectionType>(vertex.normal);
+                out.tangent        = encode_octahedral<DirectionType>(vertex.tangent);
+
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    out.colour[k] = to_unorm<ColourType>(vertex.colour[k]);
+                }
+                out.colour[3] = std::numeric_limits<ColourType>::max();
+
+                out.uv = {float_to_half(vertex.uv[0]), float_to_half(vertex.uv[1])};
+
+                std::memcpy(destination, &out, sizeof(QVertex));
+                destination += sizeof(QVertex);
+            }
+        }
+
+        template<typename QVertex>
+        void decode(std::span<std::byte const> bytes,
+                    BoundingBox const& box,
+                    std::vector<Vertex>& vertices)
+        {
+            vertices.resize(bytes.size() / sizeof(QVertex));
+            auto source = bytes.data();
+            for (auto& vertex : vertices)
+            {
+                QVertex in;
+                std::memcpy(&in, source, sizeof(QVertex));
+                source += sizeof(QVertex);
+
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    float range        = box.max[k] - box.min[k];
+                    vertex.position[k] = box.min[k] + from_unorm(in.position[k]) * range;
+                    vertex.colour[k]   = from_unorm(in.colour[k]);
+                }
+
+                vertex.normal    = decode_octahedral(in.normal);
+                vertex.tangent   = decode_octahedral(in.tangent);
+                vertex.bitangent = cross(vertex.normal, vertex.tangent);
+                for (auto& value : vertex.bitangent)
+                {
+                    value *= in.bitangent_sign;
+                }
+
+                vertex.uv = {half_to_float(in.uv[0]), half_to_float(in.uv[1])};
+            }
+        }
+
+        [[noreturn]] void throw_unknown_format(VertexFormat format)
+        {
+            auto msg = fmt::format("error: unknown vertex format {}",
+                                   magic_enum::enum_integer(format));
+            throw std::runtime_error{msg.c_str()};
+        }
+    } // namespace
+
+    std::size_t vertex_size(VertexFormat format)
+    {
+        switch (format)
+        {
+        case VertexFormat::f32_pncvtb:
+            return sizeof(Vertex);
+        case VertexFormat::q16_pncvt_8_8:
+            return sizeof(QuantisedVertex_8_8);
+        case VertexFormat::q16_pncvt_16_8:
+            return sizeof(QuantisedVertex_16_8);
+        case VertexFormat::q16_pncvt_16_16:
+            return sizeof(QuantisedVertex_16_16);
+        default:
+            throw_unknown_format(format);
+        }
+    }
+
+    std::vector<std::byte> encode_vertices(std::span<Vertex const> vertices,
+                                           VertexFormat format,
+                                           BoundingBox const& box)
+    {
+        std::vector<std::byte> bytes(vertices.size() * vertex_size(format));
+        switch (format)
+        {
+        case VertexFormat::f32_pncvtb:
+            std::memcpy(bytes.data(), vertices.data(), bytes.size());
+            break;
+        case VertexFormat::q16_pncvt_8_8:
+            encode<QuantisedVertex_8_8>(vertices, box, bytes.data());
+            break;
+        case VertexFormat::q16_pncvt_16_8:
+            encode<QuantisedVertex_16_8>(vertices, box, bytes.data());
+            break;
+        case VertexFormat::q16_pncvt_16_16:
+            encode<QuantisedVertex_16_16>(vertices, box, bytes.data());
+            break;
+        default:
+            throw_unknown_format(format);
+        }
+
+        return bytes;
+    }
+
+    std::vector<Vertex> decode_vertices(std::span<std::byte const> bytes,
+                                        VertexFormat format,
+                                        BoundingBox const& box)
+    {
+        std::vector<Vertex> vertices;
+        switch (format)
+        {
+        case VertexFormat::f32_pncvtb:
+            vertices.resize(bytes.size() / sizeof(Vertex));
+            std::memcpy(vertices.data(), bytes.data(), vertices.size() * sizeof(Vertex));
+            break;
+        case VertexFormat::q16_pncvt_8_8:
+            decode<QuantisedVertex_8_8>(bytes, box, vertices);
+            break;
+        case VertexFormat::q16_pncvt_16_8:
+            decode<QuantisedVertex_16_8>(bytes, box, vertices);
+            break;
+        case VertexFormat::q16_pncvt_16_16:
+            decode<QuantisedVertex_16_16>(bytes, box, vertices);
+            break;
+        default:
+            throw_unknown_format(format);
+        }
+
+        return vertices;
+    }
+} // namespace assets
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace assets
+{
+    enum class VertexFormat : std::uint32_t
+    {
+        unknonw = 0,
+        // Point-Normal-Colour-Texture-Tangent-BiTangent data in 32-bit float
+        f32_pncvtb,
+        // Quantised Point-Normal-Colour-Texture-Tangent data (see QuantisedVertex). The
+        // suffixes are the bits per component of the normal/tangent and of the colour.
+        q16_pncvt_8_8,
+        q16_pncvt_16_8,
+        q16_pncvt_16_16
+    };
+
+    struct Vertex
+    {
+        Vector3D<float> position;
+        Vector3D<float> normal;
+        Vector3D<float> colour;
+        Vector2D<float> uv;
+        Vector3D<float> tangent;
+        Vector3D<float> bitangent;
+    };
+
+    // Positions are unorm16 across the mesh bounding box. Normals and tangents are
+    // octahedral-encoded snorm pairs and the bitangent is rebuilt as
+    // bitangent_sign * cross(normal, tangent). Colours are unorm RGBA with an opaque
+    // alpha and texture coordinates are half floats.
+    template<typename Direction, typename Colour>
+    struct QuantisedVertex
+    {
+        std::array<std::uint16_t, 3> position;
+        std::int16_t bitangent_sign;
+        Direction normal;
+        Direction tangent;
+        Colour colour;
+        std::array<std::uint16_t, 2> uv;
+    };
+
+    using QuantisedVertex_8_8 =
+        QuantisedVertex<std::array<std::int8_t, 2>, std::array<std::uint8_t, 4>>;
+    using QuantisedVertex_16_8 =
+        QuantisedVertex<std::array<std::int16_t, 2>, std::array<std::uint8_t, 4>>;
+    using QuantisedVertex_16_16 =
+        QuantisedVertex<std::array<std::int16_t, 2>, std::array<std::uint16_t, 4>>;
+
+    static_assert(sizeof(Vertex) == 68);
+    static_assert(sizeof(QuantisedVertex_8_8) == 20);
+    static_assert(sizeof(QuantisedVertex_16_8) == 24);
+    static_assert(sizeof(QuantisedVertex_16_16) == 28);
+
+    std::size_t vertex_size(VertexFormat format);
+
+    // The box must be the one stored with the mesh, as quantised positions are relative
+    // to it.
+    std::vector<std::byte> encode_vertices(std::span<Vertex const> vertices,
+                                           VertexFormat format,
+                                           BoundingBox const& box);
+    std::vector<Vertex> decode_vertices(std::span<std::byte const> bytes,
+                                        VertexFormat format,
+                                        BoundingBox const& box);
+} // namespace assets
@@ -0,0 +1,368 @@
+#include "synthetic_data.hpp"
+
+#include <assets/mesh_asset.hpp>
+#include <assets/prefab_asset.hpp>
+#include <assets/texture_asset.hpp>
+#include <assets/thread_pool.hpp>
+#include <core/io/file_input_stream.hpp>
+#include <core/io/file_output_stream.hpp>
+#include <kass/konvert_image.hpp>
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+#include <magic_enum.hpp>
+
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Every benchmark reports the bytes it reads or writes per iteration, and the vertices,
+// texels, pages or nodes it handles as items, so that runs show up as bytes/s and
+// items/s. Pass --benchmark_out=FILE --benchmark_out_format=json to keep the results.
+namespace
+{
+    using assets::TextureFormat;
+
+    static constexpr std::uint32_t texture_size{1024};
+
+    std::int64_t iterations(benchmark::State const& state)
+    {
+        return static_cast<std::int64_t>(state.iterations());
+    }
+
+    assets::AssetFile make_file(std::size_t blob_size)
+    {
+        assets::AssetFile file;
+        file.type    = {'B', 'N', 'C', 'H'};
+        file.version = assets::AssetFile::current_version;
+        file.metadata.resize(256);
+        file.binary_blob.resize(blob_size);
+        for (std::size_t i{0}; i < blob_size; ++i)
+        {
+            file.binary_blob[i] = static_cast<std::byte>(i * 7 / 64);
+        }
+
+        return file;
+    }
+
+    fs::path bench_file(std::string_view name)
+    {
+        return fs::temp_directory_path() / fmt::format("assets_bench_{}.asset", name);
+    }
+
+    void AssetFileSave(benchmark::State& state)
+    {
+        auto file = make_file(static_cast<std::size_t>(state.range(0)));
+        auto path = bench_file("save");
+        for (auto _ : state)
+        {
+            core::io::FileOutputStream stream{path.string()};
+            file.save(stream);
+        }
+
+        fs::remove(path);
+        state.SetBytesProcessed(iterations(state) * file.size());
+    }
+
+    void AssetFileLoad(benchmark::State& state)
+    {
+        auto file = make_file(static_cast<std::size_t>(state.range(0)));
+        auto path = bench_file("load");
+        {
+            core::io::FileOutputStream stream{path.string()};
+            file.save(stream);
+        }
+
+        for (auto _ : state)
+        {
+            assets::AssetFile loaded;
+            core::io::FileInputStream stream{path.string()};
+            loaded.load(stream);
+            benchmark::DoNotOptimize(loaded.binary_blob.data());
+        }
+
+        fs::remove(path);
+        state.SetBytesProcessed(iterations(state) * file.size());
+    }
+
+    // Arguments are the number of vertices along each side of the grid and the filter.
+    assets::MeshAsset make_mesh(benchmark::State& state, bench::SyntheticMesh const& data)
+    {
+        assets::MeshAsset mesh{};
+        mesh.vertex_format      = assets::VertexFormat::f32_pncvtb;
+        mesh.index_size         = data.vertices.size() <= 65536 ? 2 : 4;
+        mesh.filter             = static_cast<assets::MeshFilter>(state.range(1));
+        mesh.codec              = {};
+        mesh.vertex_buffer_size = data.vertices.size() * sizeof(assets::Vertex);
+        mesh.index_buffer_size  = data.indices.size() * mesh.index_size;
+
+        state.SetLabel(std::string{magic_enum::enum_name(mesh.filter)});
+        return mesh;
+    }
+
+    void MeshPack(benchmark::State& state)
+    {
+        auto data     = bench::make_grid_mesh(static_cast<std::uint32_t>(state.range(0)));
+        auto mesh     = make_mesh(state, data);
+        auto vertices = bench::vertex_bytes(data);
+        auto indices  = bench::index_bytes(data, mesh.index_size);
+        for (auto _ : state)
+        {
+            auto file = mesh.pack(vertices, indices);
+            benchmark::DoNotOptimize(file.binary_blob.data());
+        }
+
+        state.SetBytesProcessed(iterations(state) * (vertices.size() + indices.size()));
+        state.SetItemsProcessed(iterations(state) * data.vertices.size());
+    }
+
+    void MeshUnpack(benchmark::State& state)
+    {
+        auto data   = bench::make_grid_mesh(static_cast<std::uint32_t>(state.range(0)));
+        auto source = make_mesh(state, data);
+        auto file   = source.pack(bench::vertex_bytes(data),
+                                bench::index_bytes(data, source.index_size));
+
+        assets::MeshAsset mesh;
+        mesh.read(file);
+
+        std::vector<std::byte> vertices(mesh.vertex_buffer_size);
+        std::vector<std::byte> indices(mesh.index_buffer_size);
+        for (auto _ : state)
+        {
+            mesh.unpack(file.binary_blob, vertices, indices);
+            benchmark::DoNotOptimize(vertices.data());
+            benchmark::DoNotOptimize(indices.data());
+        }
+
+        state.SetBytesProcessed(iterations(state) * (vertices.size() + indices.size()));
+        state.SetItemsProcessed(iterations(state) * data.vertices.size());
+    }
+
+    void CalculateBounds(benchmark::State& state)
+    {
+        auto data     = bench::make_grid_mesh(static_cast<std::uint32_t>(state.range(0)));
+        auto vertices = bench::vertex_bytes(data);
+        for (auto _ : state)
+        {
+            auto bounds = assets::MeshAsset::calculate_bounds(
+                vertices,
+                assets::VertexFormat::f32_pncvtb);
+            benchmark::DoNotOptimize(bounds);
+        }
+
+        state.SetBytesProcessed(iterations(state) * vertices.size());
+        state.SetItemsProcessed(iterations(state) * data.vertices.size());
+    }
+
+    // Arguments are the texture format and the number of mip levels stored as pages.
+    bench::SyntheticTexture make_texture(benchmark::State& state)
+    {
+        auto format = static_cast<TextureFormat>(state.range(0));
+        auto pages  = static_cast<std::uint32_t>(state.range(1));
+        state.SetLabel(std::string{magic_enum::enum_name(format)});
+        return bench::make_texture(texture_size, pages, format);
+    }
+
+    std::int64_t texel_count(assets::TextureAsset const& texture)
+    {
+        std::int64_t count{0};
+        for (auto const& page : texture.pages)
+        {
+            count += std::int64_t{page.width} * page.height;
+        }
+
+        return count;
+    }
+
+    void TexturePack(benchmark::State& state)
+    {
+        auto [texture, pixels] = make_texture(state);
+        for (auto _ : state)
+        {
+            auto file = texture.pack(pixels);
+            benchmark::DoNotOptimize(file.binary_blob.data());
+        }
+
+        state.SetBytesProcessed(iterations(state) * pixels.size());
+        state.SetItemsProcessed(iterations(state) * texel_count(texture));
+    }
+
+    void TextureUnpack(benchmark::State& state)
+    {
+        auto [source, pixels] = make_texture(state);
+        auto file             = source.pack(pixels);
+
+        assets::TextureAsset texture;
+        texture.read(file);
+        for (auto _ : state)
+        {
+            auto texels = texture.unpack(file.binary_blob);
+            benchmark::DoNotOptimize(texels.data());
+        }
+
+        state.SetBytesProcessed(iterations(state) * texture.texture_size);
+        state.SetItemsProcessed(iterations(state) * texel_count(texture));
+    }
+
+    void TextureUnpackPool(benchmark::State& state)
+    {
+        static assets::ThreadPool pool;
+
+        auto [source, pixels] = make_texture(state);
+        auto file             = source.pack(pixels);
+
+        assets::TextureAsset texture;
+        texture.read(file);
+        for (auto _ : state)
+        {
+            auto texels = texture.unpack(file.binary_blob, pool);
+            benchmark::DoNotOptimize(texels.data());
+        }
+
+        state.SetBytesProcessed(iterations(state) * texture.texture_size);
+        state.SetItemsProcessed(iterations(state) * texel_count(texture));
+    }
+
+    // Decodes every page on its own, the way textures are streamed in. Items are pages.
+    void TextureUnpackPage(benchmark::State& state)
+    {
+        auto [source, pixels] = make_texture(state);
+        auto file             = source.pack(pixels);
+
+        assets::TextureAsset texture;
+        texture.read(file);
+        for (auto _ : state)
+        {
+            for (std::size_t i{0}; i < texture.pages.size(); ++i)
+            {
+                auto texels = texture.unpack_page(static_cast<int>(i), file.binary_blob);
+                benchmark::DoNotOptimize(texels.data());
+            }
+        }
+
+        state.SetBytesProcessed(iterations(state) * texture.texture_size);
+        state.SetItemsProcessed(iterations(state) * texture.pages.size());
+    }
+
+    void PrefabPack(benchmark::State& state)
+    {
+        auto prefab = bench::make_prefab(static_cast<std::size_t>(state.range(0)));
+
+        std::size_t size{0};
+        for (auto _ : state)
+        {
+            auto file = prefab.pack();
+            size      = file.size();
+            benchmark::DoNotOptimize(file.binary_blob.data());
+        }
+
+        state.SetBytesProcessed(iterations(state) * size);
+        state.SetItemsProcessed(iterations(state) * prefab.node_count());
+    }
+
+    void PrefabRead(benchmark::State& state)
+    {
+        auto file = bench::make_prefab(static_cast<std::size_t>(state.range(0))).pack();
+        for (auto _ : state)
+        {
+            assets::PrefabAsset prefab;
+            prefab.read(file);
+            benchmark::DoNotOptimize(prefab.parents.data());
+        }
+
+        state.SetBytesProcessed(iterations(state) * file.size());
+        state.SetItemsProcessed(iterations(state) * state.range(0));
+    }
+
+    // Arguments are the image size, the mip filter and whether the image is HDR. Blocks
+    // are left uncompressed, so the time goes to decoding, mip generation and packing.
+    void CompressImage(benchmark::State& state)
+    {
+        auto size = static_cast<std::uint32_t>(state.range(0));
+        auto hdr  = state.range(2) != 0;
+        auto path = bench::write_image_file(size, hdr);
+
+        kass::TextureOptions options;
+        options.block_compress = false;
+        options.format = hdr ? TextureFormat::rgba_float32 : TextureFormat::rgba_uint8;
+        options.mips.filter = static_cast<kass::MipFilter>(state.range(1));
+        state.SetLabel(fmt::format("{} {}",
+                                   magic_enum::enum_name(options.mips.filter),
+                                   magic_enum::enum_name(*options.format)));
+
+        std::size_t texture_bytes{0};
+        for (auto _ : state)
+        {
+            auto file = kass::compress_image(path.string(), options, {});
+            texture_bytes = file.binary_blob.size();
+            benchmark::DoNotOptimize(file.binary_blob.data());
+        }
+
+        fs::remove(path);
+
+        // Bytes are those of the decoded source image, which the output is built from.
+        auto texels = std::int64_t{size} * size;
+        state.SetBytesProcessed(iterations(state) * texels * (hdr ? 16 : 4));
+        state.SetItemsProcessed(iterations(state) * texels);
+        state.counters["packed_bytes"] = static_cast<double>(texture_bytes);
+    }
+
+    void texture_arguments(benchmark::internal::Benchmark* benchmark)
+    {
+        auto mips = std::int64_t{kass::count_mips(texture_size, texture_size)};
+        benchmark->ArgNames({"format", "pages"});
+        benchmark->ArgsProduct({{magic_enum::enum_integer(TextureFormat::rgba_uint8),
+                                 magic_enum::enum_integer(TextureFormat::rgba_float32),
+                                 magic_enum::enum_integer(TextureFormat::rgba_float16),
+                                 magic_enum::enum_integer(TextureFormat::rgb9e5),
+                                 magic_enum::enum_integer(TextureFormat::bc1_rgba_unorm),
+                                 magic_enum::enum_integer(TextureFormat::bc7_rgba_unorm)},
+                                {1, 4, mips}});
+        benchmark->Unit(benchmark::kMillisecond);
+    }
+
+    void mesh_arguments(benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({"side", "filter"});
+        using assets::MeshFilter;
+        benchmark->ArgsProduct({{64, 256, 1024},
+                                {magic_enum::enum_integer(MeshFilter::none),
+                                 magic_enum::enum_integer(MeshFilter::mesh_codec)}});
+        benchmark->Unit(benchmark::kMillisecond);
+    }
+} // namespace
+
+BENCHMARK(AssetFileSave)->ArgName("bytes")->RangeMultiplier(8)->Range(64 << 10, 64 << 20);
+BENCHMARK(AssetFileLoad)->ArgName("bytes")->RangeMultiplier(8)->Range(64 << 10, 64 << 20);
+
+BENCHMARK(MeshPack)->Apply(mesh_arguments);
+BENCHMARK(MeshUnpack)->Apply(mesh_arguments);
+BENCHMARK(CalculateBounds)->ArgName("side")->Arg(64)->Arg(256)->Arg(1024);
+
+BENCHMARK(TexturePack)->Apply(texture_arguments);
+BENCHMARK(TextureUnpack)->Apply(texture_arguments);
+BENCHMARK(TextureUnpackPool)->Apply(texture_arguments);
+BENCHMARK(TextureUnpackPage)->Apply(texture_arguments);
+
+BENCHMARK(PrefabPack)
+    ->ArgName("nodes")
+    ->RangeMultiplier(10)
+    ->Range(1'000, 1'000'000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(PrefabRead)
+    ->ArgName("nodes")
+    ->RangeMultiplier(10)
+    ->Range(1'000, 1'000'000)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(CompressImage)
+    ->ArgNames({"size", "filter", "hdr"})
+    ->ArgsProduct({{512, 2048},
+                   {magic_enum::enum_integer(kass::MipFilter::box),
+                    magic_enum::enum_integer(kass::MipFilter::kaiser)},
+                   {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
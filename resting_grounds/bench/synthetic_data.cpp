@@ -0,0 +1,287 @@
+#include "synthetic_data.hpp"
+
+#include <assets/half_float.hpp>
+
+#include <fmt/format.h>
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace bench
+{
+    namespace
+    {
+        static constexpr std::uint32_t seed{0x5eed};
+
+        template<typename T>
+        std::vector<std::byte> to_bytes(std::vector<T> const& values)
+        {
+            std::vector<std::byte> bytes(values.size() * sizeof(T));
+            std::memcpy(bytes.data(), values.data(), bytes.size());
+            return bytes;
+        }
+
+        // Gradients with a sine ripple and some noise, scaled by range. Alpha is opaque.
+        std::vector<float>
+        make_rgba(std::uint32_t width, std::uint32_t height, float range)
+        {
+            std::mt19937 rng{seed};
+            std::uniform_real_distribution<float> noise{-1.0f / 64, 1.0f / 64};
+
+            std::vector<float> texels(std::size_t{width} * height * 4);
+            for (std::uint32_t y{0}; y < height; ++y)
+            {
+                for (std::uint32_t x{0}; x < width; ++x)
+                {
+                    auto u = static_cast<float>(x) / static_cast<float>(width);
+                    auto v = static_cast<float>(y) / static_cast<float>(height);
+                    auto w = 0.5f + 0.5f * std::sin((u + v) * 20.0f);
+
+                    auto* texel = texels.data() + (std::size_t{y} * width + x) * 4;
+                    texel[0]    = std::clamp(u + noise(rng), 0.0f, 1.0f) * range;
+                    texel[1]    = std::clamp(v + noise(rng), 0.0f, 1.0f) * range;
+                    texel[2]    = std::clamp(w + noise(rng), 0.0f, 1.0f) * range;
+                    texel[3]    = 1.0f;
+                }
+            }
+
+            return texels;
+        }
+
+        std::vector<std::uint8_t> to_unorm8(std::vector<float> const& texels)
+        {
+            std::vector<std::uint8_t> bytes(texels.size());
+            for (std::size_t i{0}; i < texels.size(); ++i)
+            {
+                bytes[i] = static_cast<std::uint8_t>(texels[i] * 255.0f + 0.5f);
+            }
+
+            return bytes;
+        }
+    } // namespace
+
+    SyntheticMesh make_grid_mesh(std::uint32_t side)
+    {
+        if (side < 2)
+        {
+            throw std::runtime_error{"error: grid meshes need 2 or more vertices a side"};
+        }
+
+        std::mt19937 rng{seed};
+        std::uniform_real_distribution<float> height{-0.05f, 0.05f};
+
+        SyntheticMesh mesh;
+        mesh.vertices.resize(std::size_t{side} * side);
+        auto scale = 1.0f / static_cast<float>(side - 1);
+        for (std::uint32_t y{0}; y < side; ++y)
+        {
+            for (std::uint32_t x{0}; x < side; ++x)
+            {
+                auto u = static_cast<float>(x) * scale;
+                auto v = static_cast<float>(y) * scale;
+
+                auto& vertex     = mesh.vertices[std::size_t{y} * side + x];
+                vertex.position  = {u * 100.0f, height(rng), v * 100.0f};
+                vertex.normal    = {0.0f, 1.0f, 0.0f};
+                vertex.colour    = {u, v, 1.0f};
+                vertex.uv        = {u, v};
+                vertex.tangent   = {1.0f, 0.0f, 0.0f};
+                vertex.bitangent = {0.0f, 0.0f, 1.0f};
+            }
+        }
+
+        mesh.indices.reserve(std::size_t{side - 1} * (side - 1) * 6);
+        for (std::uint32_t y{0}; y + 1 < side; ++y)
+        {
+            for (std::uint32_t x{0}; x + 1 < side; ++x)
+            {
+                auto i = y * side + x;
+                mesh.indices.insert(mesh.indices.end(),
+                                    {i, i + side, i + 1, i + 1, i + side, i + side + 1});
+            }
+        }
+
+        return mesh;
+    }
+
+    std::vector<std::byte> vertex_bytes(SyntheticMesh const& mesh)
+    {
+        return to_bytes(mesh.vertices);
+    }
+
+    std::vector<std::byte> index_bytes(SyntheticMesh const& mesh,
+                                       std::uint8_t index_size)
+    {
+        if (index_size == sizeof(std::uint32_t))
+        {
+            return to_bytes(mesh.indices);
+        }
+
+        std::vector<std::uint16_t> narrow(mesh.indices.begin(), mesh.indices.end());
+        return to_bytes(narrow);
+    }
+
+    std::vector<std::byte> make_texels(std::uint32_t width,
+                                       std::uint32_t height,
+                                       assets::TextureFormat format)
+    {
+        using assets::TextureFormat;
+
+        auto block = assets::texel_block(format);
+        if (block.width > 1)
+        {
+            std::mt19937 rng{seed};
+            std::uniform_int_distribution<int> byte{0, 255};
+
+            auto blocks_x = (width + block.width - 1) / block.width;
+            auto blocks_y = (height + block.height - 1) / block.height;
+            std::vector<std::byte> bytes(std::size_t{blocks_x} * blocks_y * block.size);
+            std::generate(bytes.begin(), bytes.end(), [&] {
+                return static_cast<std::byte>(byte(rng));
+            });
+            return bytes;
+        }
+
+        auto hdr    = format != TextureFormat::rgba_uint8;
+        auto texels = make_rgba(width, height, hdr ? 16.0f : 1.0f);
+        switch (format)
+        {
+        case TextureFormat::rgba_uint8:
+            return to_bytes(to_unorm8(texels));
+
+        case TextureFormat::rgba_float32:
+            return to_bytes(texels);
+
+        case TextureFormat::rgba_float16:
+        {
+            std::vector<std::uint16_t> halves(texels.size());
+            assets::float_to_half(texels, halves);
+            return to_bytes(halves);
+        }
+
+        case TextureFormat::rgb9e5:
+        case TextureFormat::r11g11b10f:
+        {
+            std::vector<std::uint32_t> packed(texels.size() / 4);
+            if (format == TextureFormat::rgb9e5)
+            {
+                assets::rgba_to_rgb9e5(texels, packed);
+            }
+            else
+            {
+                assets::rgba_to_r11g11b10f(texels, packed);
+            }
+            return to_bytes(packed);
+        }
+
+        default:
+            throw std::runtime_error{"error: unsupported synthetic texture format"};
+        }
+    }
+
+    SyntheticTexture make_texture(std::uint32_t size,
+                                  std::uint32_t page_count,
+                                  assets::TextureFormat format)
+    {
+        SyntheticTexture result;
+        auto& texture          = result.texture;
+        texture.texture_format = format;
+        texture.codec          = {};
+        texture.texture_size   = 0;
+
+        auto extent = size;
+        for (std::uint32_t i{0}; i < page_count; ++i)
+        {
+            auto texels = make_texels(extent, extent, format);
+
+            assets::TextureAsset::Page page{};
+            page.width         = extent;
+            page.height        = extent;
+            page.original_size = static_cast<std::uint32_t>(texels.size());
+            texture.pages.push_back(page);
+            texture.texture_size += texels.size();
+
+            result.pixels.insert(result.pixels.end(), texels.begin(), texels.end());
+            if (extent == 1)
+            {
+                break;
+            }
+            extent /= 2;
+        }
+
+        return result;
+    }
+
+    assets::PrefabAsset make_prefab(std::size_t node_count)
+    {
+        static constexpr std::uint32_t mesh_count{16};
+
+        std::mt19937 rng{seed};
+        std::uniform_real_distribution<float> offset{-10.0f, 10.0f};
+
+        assets::PrefabAsset prefab;
+        for (std::uint32_t i{0}; i < mesh_count; ++i)
+        {
+            prefab.add_mesh(fmt::format("meshes/mesh_{}.mesh", i),
+                            fmt::format("materials/material_{}.material", i));
+        }
+
+        prefab.parents.reserve(node_count);
+        prefab.local_matrices.reserve(node_count);
+        prefab.node_names.reserve(node_count);
+        prefab.mesh_slots.reserve(node_count);
+        for (std::size_t i{0}; i < node_count; ++i)
+        {
+            auto parent = i == 0 ? assets::PrefabAsset::no_parent
+                                 : static_cast<std::uint32_t>(rng() % i);
+            auto mesh = (rng() % 4 == 0) ? static_cast<std::uint32_t>(rng() % mesh_count)
+                                         : assets::PrefabAsset::no_mesh;
+
+            // Column-major, so the translation goes in the last column.
+            assets::Matrix4x4<float> local{
+                1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+            local[12] = offset(rng);
+            local[13] = offset(rng);
+            local[14] = offset(rng);
+
+            prefab.add_node(parent, local, fmt::format("node_{}", i), mesh);
+        }
+
+        return prefab;
+    }
+
+    fs::path write_image_file(std::uint32_t size, bool hdr)
+    {
+        auto path = fs::temp_directory_path()
+                    / fmt::format("assets_bench_{}.{}", size, hdr ? "hdr" : "png");
+
+        auto texels = make_rgba(size, size, hdr ? 16.0f : 1.0f);
+        auto name   = path.string();
+        auto width  = static_cast<int>(size);
+        int written{0};
+        if (hdr)
+        {
+            written = stbi_write_hdr(name.c_str(), width, width, 4, texels.data());
+        }
+        else
+        {
+            auto bytes = to_unorm8(texels);
+            written =
+                stbi_write_png(name.c_str(), width, width, 4, bytes.data(), width * 4);
+        }
+
+        if (written == 0)
+        {
+            auto msg = fmt::format("error: unable to write image {}", path.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        return path;
+    }
+} // namespace bench
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <assets/prefab_asset.hpp>
+#include <assets/texture_asset.hpp>
+#include <assets/vertex_format.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace bench
+{
+    // Everything here is generated from a fixed seed, so runs of different builds work
+    // on the same bytes and their results can be compared directly.
+
+    struct SyntheticMesh
+    {
+        std::vector<assets::Vertex> vertices;
+        std::vector<std::uint32_t> indices;
+    };
+
+    // A side x side grid of vertices over a noisy height field, two triangles per cell.
+    SyntheticMesh make_grid_mesh(std::uint32_t side);
+
+    std::vector<std::byte> vertex_bytes(SyntheticMesh const& mesh);
+    std::vector<std::byte> index_bytes(SyntheticMesh const& mesh,
+                                       std::uint8_t index_size);
+
+    // Texels of a single page. Uncompressed formats get smooth gradients with a little
+    // noise, similar to photographs, while block-compressed ones get random blocks, as
+    // their encoded data is close to incompressible anyway.
+    std::vector<std::byte> make_texels(std::uint32_t width,
+                                       std::uint32_t height,
+                                       assets::TextureFormat format);
+
+    struct SyntheticTexture
+    {
+        assets::TextureAsset texture;
+        std::vector<std::byte> pixels;
+    };
+
+    // The first page_count levels of the mip chain of a size x size texture, ready to be
+    // packed.
+    SyntheticTexture make_texture(std::uint32_t size,
+                                  std::uint32_t page_count,
+                                  assets::TextureFormat format);
+
+    // A random tree of node_count nodes, with roughly one node in four holding one of a
+    // small set of meshes.
+    assets::PrefabAsset make_prefab(std::size_t node_count);
+
+    // Writes a size x size RGBA image for kass to convert: a PNG, or a Radiance HDR when
+    // hdr is set. Returns the path of the file, under the system temporary directory.
+    std::filesystem::path write_image_file(std::uint32_t size, bool hdr);
+} // namespace bench
@@ -0,0 +1,1050 @@
+#include "block_compress.hpp"
+
+#include <assets/half_float.hpp>
+
+#include <fmt/printf.h>
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define KASS_BLOCK_COMPRESS_SSE
+#    include <emmintrin.h>
+#endif
+
+namespace kass
+{
+    namespace
+    {
+        using assets::TextureFormat;
+
+        // The 16 texels of a block with one array per channel, so that four texels can
+        // be compared against a palette entry at once.
+        struct Texels
+        {
+            float channels[4][16];
+        };
+
+        struct Endpoints
+        {
+            std::array<float, 4> a;
+            std::array<float, 4> b;
+        };
+
+        struct Palette
+        {
+            float colours[16][4];
+            std::size_t count;
+        };
+
+        using Indices = std::array<std::uint8_t, 16>;
+
+        static constexpr std::uint32_t all_texels{0xffff};
+
+        // Weights of the second endpoint, out of 64, for the 4-bit indices of BC6H and
+        // BC7.
+        static constexpr std::array<int, 16> bptc_weights{
+            0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        // Packs fields LSB first, as every BC format lays out its bits.
+        class BlockWriter
+        {
+        public:
+            void write(std::uint64_t value, std::size_t bits)
+            {
+                value &= (std::uint64_t{1} << bits) - 1;
+
+                auto word  = m_position / 64;
+                auto shift = m_position % 64;
+                m_words[word] |= value << shift;
+                if (shift + bits > 64)
+                {
+                    m_words[word + 1] |= value >> (64 - shift);
+                }
+
+                m_position += bits;
+            }
+
+            void store(std::byte* destination, std::size_t size) const
+            {
+                std::memcpy(destination, m_words.data(), size);
+            }
+
+        private:
+            std::array<std::uint64_t, 2> m_words{};
+            std::size_t m_position{0};
+        };
+
+        // Picks the closest palette entry for every texel and returns the total squared
+        // error.
+        float fit_indices(Texels const& texels, Palette const& palette, Indices& indices)
+        {
+            float error{0.0f};
+#if defined(KASS_BLOCK_COMPRESS_SSE)
+            for (std::size_t i{0}; i < 16; i += 4)
+            {
+                __m128 channels[4];
+                for (std::size_t c{0}; c < 4; ++c)
+                {
+                    channels[c] = _mm_loadu_ps(texels.channels[c] + i);
+                }
+
+                auto best       = _mm_set1_ps(std::numeric_limits<float>::max());
+                auto best_index = _mm_setzero_si128();
+                for (std::size_t k{0}; k < palette.count; ++k)
+                {
+                    auto distance = _mm_setzero_ps();
+                    for (std::size_t c{0}; c < 4; ++c)
+                    {
+                        auto delta =
+                            _mm_sub_ps(channels[c], _mm_set1_ps(palette.colours[k][c]));
+                        distance = _mm_add_ps(distance, _mm_mul_ps(delta, delta));
+                    }
+
+                    auto closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+                    best        = _mm_min_ps(distance, best);
+                    best_index =
+                        _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(int(k))),
+                                     _mm_andnot_si128(closer, best_index));
+                }
+
+                alignas(16) float distances[4];
+                alignas(16) std::int32_t closest[4];
+                _mm_store_ps(distances, best);
+                _mm_store_si128(reinterpret_cast<__m128i*>(closest), best_index);
+                for (std::size_t j{0}; j < 4; ++j)
+                {
+                    indices[i + j] = static_cast<std::uint8_t>(closest[j]);
+                    error += distances[j];
+                }
+            }
+#else
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                auto best = std::numeric_limits<float>::max();
+                for (std::size_t k{0}; k < palette.count; ++k)
+                {
+                    float distance{0.0f};
+                    for (std::size_t c{0}; c < 4; ++c)
+                    {
+                        auto delta = texels.channels[c][i] - palette.colours[k][c];
+                        distance += delta * delta;
+                    }
+
+                    if (distance < best)
+                    {
+                        best       = distance;
+                        indices[i] = static_cast<std::uint8_t>(k);
+                    }
+                }
+
+                error += best;
+            }
+#endif
+            return error;
+        }
+
+        // Corners of the bounding box of the texels, with channels that fall while the
+        // widest one rises flipped so the box diagonal follows the texels.
+        Endpoints
+        bounding_box(Texels const& texels, std::uint32_t mask, std::size_t channels)
+        {
+            Endpoints endpoints{};
+            std::array<float, 4> mean{};
+            auto count = static_cast<float>(std::popcount(mask));
+            std::size_t widest{0};
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                auto low  = std::numeric_limits<float>::max();
+                auto high = std::numeric_limits<float>::lowest();
+                for (std::size_t i{0}; i < 16; ++i)
+                {
+                    if (mask & (1u << i))
+                    {
+                        low  = std::min(low, texels.channels[c][i]);
+                        high = std::max(high, texels.channels[c][i]);
+                        mean[c] += texels.channels[c][i];
+                    }
+                }
+
+                // Pull the ends in slightly, the extremes are rarely worth an endpoint.
+                auto inset     = (high - low) / 16.0f;
+                endpoints.a[c] = low + inset;
+                endpoints.b[c] = high - inset;
+
+                auto range = endpoints.b[widest] - endpoints.a[widest];
+                if (endpoints.b[c] - endpoints.a[c] > range)
+                {
+                    widest = c;
+                }
+            }
+
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                mean[c] /= count;
+            }
+
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                float covariance{0.0f};
+                for (std::size_t i{0}; i < 16; ++i)
+                {
+                    if (mask & (1u << i))
+                    {
+                        covariance += (texels.channels[c][i] - mean[c])
+                                      * (texels.channels[widest][i] - mean[widest]);
+                    }
+                }
+
+                if (covariance < 0.0f)
+                {
+                    std::swap(endpoints.a[c], endpoints.b[c]);
+                }
+            }
+
+            return endpoints;
+        }
+
+        // Ends of the span of the texels along their principal axis, found by power
+        // iteration on the covariance matrix.
+        Endpoints
+        principal_axis(Texels const& texels, std::uint32_t mask, std::size_t channels)
+        {
+            std::array<float, 4> mean{};
+            float count{0.0f};
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                if (mask & (1u << i))
+                {
+                    for (std::size_t c{0}; c < channels; ++c)
+                    {
+                        mean[c] += texels.channels[c][i];
+                    }
+                    count += 1.0f;
+                }
+            }
+
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                mean[c] /= count;
+            }
+
+            float covariance[4][4]{};
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                if (mask & (1u << i))
+                {
+                    for (std::size_t r{0}; r < channels; ++r)
+                    {
+                        for (std::size_t c{0}; c < channels; ++c)
+                        {
+                            covariance[r][c] += (texels.channels[r][i] - mean[r])
+                                                * (texels.channels[c][i] - mean[c]);
+                        }
+                    }
+                }
+            }
+
+            // Start from the row of the channel with the largest variance, which can't be
+            // orthogonal to the principal axis.
+            std::size_t start{0};
+            for (std::size_t c{1}; c < channels; ++c)
+            {
+                if (covariance[c][c] > covariance[start][start])
+                {
+                    start = c;
+                }
+            }
+
+            std::array<float, 4> axis{};
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                axis[c] = covariance[start][c];
+            }
+
+            for (int iteration{0}; iteration < 8; ++iteration)
+            {
+                std::array<float, 4> next{};
+                float largest{0.0f};
+                for (std::size_t r{0}; r < channels; ++r)
+                {
+                    for (std::size_t c{0}; c < channels; ++c)
+                    {
+                        next[r] += covariance[r][c] * axis[c];
+                    }
+                    largest = std::max(largest, std::abs(next[r]));
+                }
+
+                if (largest == 0.0f)
+                {
+                    return {mean, mean};
+                }
+
+                for (std::size_t c{0}; c < channels; ++c)
+                {
+                    axis[c] = next[c] / largest;
+                }
+            }
+
+            float length{0.0f};
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                length += axis[c] * axis[c];
+            }
+            length = std::sqrt(length);
+
+            auto low  = std::numeric_limits<float>::max();
+            auto high = std::numeric_limits<float>::lowest();
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                if (mask & (1u << i))
+                {
+                    float t{0.0f};
+                    for (std::size_t c{0}; c < channels; ++c)
+                    {
+                        t += (texels.channels[c][i] - mean[c]) * axis[c] / length;
+                    }
+                    low  = std::min(low, t);
+                    high = std::max(high, t);
+                }
+            }
+
+            Endpoints endpoints{mean, mean};
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                endpoints.a[c] += axis[c] / length * low;
+                endpoints.b[c] += axis[c] / length * high;
+            }
+
+            return endpoints;
+        }
+
+        Endpoints initial_endpoints(Texels const& texels,
+                                    std::uint32_t mask,
+                                    std::size_t channels,
+                                    BlockQuality quality)
+        {
+            if (quality == BlockQuality::fast)
+            {
+                return bounding_box(texels, mask, channels);
+            }
+
+            return principal_axis(texels, mask, channels);
+        }
+
+        // Least-squares endpoints for fixed indices, where weights[k] is how far along
+        // from a to b palette entry k lies. Returns false if the indices don't pin both
+        // endpoints down.
+        bool refine_endpoints(Texels const& texels,
+                              std::uint32_t mask,
+                              std::size_t channels,
+                              Indices const& indices,
+                              float const* weights,
+                              Endpoints& endpoints)
+        {
+            float aa{0.0f};
+            float ab{0.0f};
+            float bb{0.0f};
+            std::array<float, 4> ax{};
+            std::array<float, 4> bx{};
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                if (!(mask & (1u << i)))
+                {
+                    continue;
+                }
+
+                auto t = weights[indices[i]];
+                auto s = 1.0f - t;
+                aa += s * s;
+                ab += s * t;
+                bb += t * t;
+                for (std::size_t c{0}; c < channels; ++c)
+                {
+                    ax[c] += s * texels.channels[c][i];
+                    bx[c] += t * texels.channels[c][i];
+                }
+            }
+
+            auto determinant = aa * bb - ab * ab;
+            if (std::abs(determinant) < 1e-6f)
+            {
+                return false;
+            }
+
+            for (std::size_t c{0}; c < channels; ++c)
+            {
+                endpoints.a[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+                endpoints.b[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+            }
+
+            return true;
+        }
+
+        int quantise(float value, float scale, int max)
+        {
+            return std::clamp(static_cast<int>(std::lround(value * scale)), 0, max);
+        }
+
+        struct ColourCandidate
+        {
+            std::array<int, 2> endpoints;
+            Indices indices;
+            float error;
+        };
+
+        // The colour half of BC1 and BC3. In punch-through mode texels with alpha below
+        // one half become transparent, otherwise the block always uses four colours.
+        void encode_colour(Texels const& texels,
+                           BlockQuality quality,
+                           bool punch_through,
+                           std::byte* destination)
+        {
+            Texels colour = texels;
+            std::uint32_t mask{all_texels};
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                if (punch_through && texels.channels[3][i] < 127.5f)
+                {
+                    mask &= ~(1u << i);
+                }
+                colour.channels[3][i] = 0.0f;
+            }
+
+            BlockWriter writer;
+            if (mask == 0)
+            {
+                writer.write(0, 32);
+                writer.write(0xffffffff, 32);
+                writer.store(destination, 8);
+                return;
+            }
+
+            bool three_colour = mask != all_texels;
+
+            auto evaluate = [&](Endpoints const& endpoints) {
+                ColourCandidate candidate;
+
+                Palette palette{};
+                for (std::size_t e{0}; e < 2; ++e)
+                {
+                    auto const& end = (e == 0) ? endpoints.a : endpoints.b;
+
+                    auto r = quantise(end[0], 31.0f / 255.0f, 31);
+                    auto g = quantise(end[1], 63.0f / 255.0f, 63);
+                    auto b = quantise(end[2], 31.0f / 255.0f, 31);
+                    candidate.endpoints[e] = (r << 11) | (g << 5) | b;
+
+                    palette.colours[e][0] = static_cast<float>((r << 3) | (r >> 2));
+                    palette.colours[e][1] = static_cast<float>((g << 2) | (g >> 4));
+                    palette.colours[e][2] = static_cast<float>((b << 3) | (b >> 2));
+                }
+
+                for (std::size_t c{0}; c < 3; ++c)
+                {
+                    auto a = palette.colours[0][c];
+                    auto b = palette.colours[1][c];
+                    if (three_colour)
+                    {
+                        palette.colours[2][c] = (a + b) / 2.0f;
+                    }
+                    else
+                    {
+                        palette.colours[2][c] = (2.0f * a + b) / 3.0f;
+                        palette.colours[3][c] = (a + 2.0f * b) / 3.0f;
+                    }
+                }
+                palette.count = three_colour ? 3 : 4;
+
+                candidate.error = fit_indices(colour, palette, candidate.indices);
+                return candidate;
+            };
+
+            auto endpoints = initial_endpoints(colour, mask, 3, quality);
+            auto best      = evaluate(endpoints);
+            if (quality == BlockQuality::high)
+            {
+                static constexpr float four_weights[]  = {0.0f, 1.0f, 1.0f / 3, 2.0f / 3};
+                static constexpr float three_weights[] = {0.0f, 1.0f, 0.5f};
+
+                auto weights = three_colour ? three_weights : four_weights;
+                for (int iteration{0}; iteration < 2; ++iteration)
+                {
+                    if (!refine_endpoints(colour,
+                                          mask,
+                                          3,
+                                          best.indices,
+                                          weights,
+                                          endpoints))
+                    {
+                        break;
+                    }
+
+                    auto candidate = evaluate(endpoints);
+                    if (candidate.error >= best.error)
+                    {
+                        break;
+                    }
+                    best = candidate;
+                }
+            }
+
+            // The order of the endpoints selects the mode: c0 > c1 has four colours.
+            auto [c0, c1] = best.endpoints;
+            if (!three_colour)
+            {
+                if (c0 < c1)
+                {
+                    std::swap(c0, c1);
+                    for (auto& index : best.indices)
+                    {
+                        index ^= 1;
+                    }
+                }
+                else if (c0 == c1)
+                {
+                    best.indices.fill(0);
+                }
+            }
+            else if (c0 > c1)
+            {
+                std::swap(c0, c1);
+                for (auto& index : best.indices)
+                {
+                    index = (index < 2) ? index ^ 1 : index;
+                }
+            }
+
+            writer.write(c0, 16);
+            writer.write(c1, 16);
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                writer.write((mask & (1u << i)) ? best.indices[i] : 3, 2);
+            }
+            writer.store(destination, 8);
+        }
+
+        // Palette of a BC4 block. a > b interpolates six values between them, otherwise
+        // four are interpolated and 0 and 255 are added.
+        Palette single_channel_palette(int a, int b)
+        {
+            Palette palette{};
+            palette.colours[0][0] = static_cast<float>(a);
+            palette.colours[1][0] = static_cast<float>(b);
+            if (a > b)
+            {
+                for (int k{2}; k < 8; ++k)
+                {
+                    palette.colours[k][0] = ((8 - k) * a + (k - 1) * b) / 7.0f;
+                }
+            }
+            else
+            {
+                for (int k{2}; k < 6; ++k)
+                {
+                    palette.colours[k][0] = ((6 - k) * a + (k - 1) * b) / 5.0f;
+                }
+                palette.colours[6][0] = 0.0f;
+                palette.colours[7][0] = 255.0f;
+            }
+            palette.count = 8;
+
+            return palette;
+        }
+
+        void encode_single_channel(float const (&values)[16],
+                                   BlockQuality quality,
+                                   std::byte* destination)
+        {
+            Texels texels{};
+            std::copy(std::begin(values), std::end(values), texels.channels[0]);
+
+            struct Candidate
+            {
+                int a;
+                int b;
+                Indices indices;
+                float error;
+            };
+
+            auto evaluate = [&texels](int a, int b) {
+                Candidate candidate{a, b, {}, 0.0f};
+                candidate.error =
+                    fit_indices(texels, single_channel_palette(a, b), candidate.indices);
+                return candidate;
+            };
+
+            auto [low, high] = std::minmax_element(std::begin(values), std::end(values));
+            auto best =
+                evaluate(quantise(*high, 1.0f, 255), quantise(*low, 1.0f, 255));
+
+            if (quality == BlockQuality::high)
+            {
+                std::array<float, 8> weights{0.0f, 1.0f};
+                for (std::size_t k{2}; k < 8; ++k)
+                {
+                    weights[k] = (k - 1) / 7.0f;
+                }
+
+                Endpoints endpoints{};
+                if (best.a > best.b
+                    && refine_endpoints(texels,
+                                        all_texels,
+                                        1,
+                                        best.indices,
+                                        weights.data(),
+                                        endpoints))
+                {
+                    auto a = quantise(endpoints.a[0], 1.0f, 255);
+                    auto b = quantise(endpoints.b[0], 1.0f, 255);
+                    if (a > b)
+                    {
+                        auto candidate = evaluate(a, b);
+                        best = (candidate.error < best.error) ? candidate : best;
+                    }
+                }
+
+                // Leave the extremes to the fixed 0 and 255 entries of the other mode.
+                auto inner_low  = 255.0f;
+                auto inner_high = 0.0f;
+                for (auto value : values)
+                {
+                    if (value > 0.5f && value < 254.5f)
+                    {
+                        inner_low  = std::min(inner_low, value);
+                        inner_high = std::max(inner_high, value);
+                    }
+                }
+
+                if (inner_low <= inner_high)
+                {
+                    auto candidate = evaluate(quantise(inner_low, 1.0f, 255),
+                                              quantise(inner_high, 1.0f, 255));
+                    best = (candidate.error < best.error) ? candidate : best;
+                }
+            }
+
+            BlockWriter writer;
+            writer.write(static_cast<std::uint64_t>(best.a), 8);
+            writer.write(static_cast<std::uint64_t>(best.b), 8);
+            for (auto index : best.indices)
+            {
+                writer.write(index, 3);
+            }
+            writer.store(destination, 8);
+        }
+
+        // Lerps two expanded endpoints with the BC6H and BC7 weights.
+        int bptc_interpolate(int a, int b, std::size_t index)
+        {
+            return ((64 - bptc_weights[index]) * a + bptc_weights[index] * b + 32) >> 6;
+        }
+
+        // The first texel is the index anchor and has to point into the first half of
+        // the palette, which saves a bit. Returns true if the endpoints must be swapped
+        // for that, after inverting the indices to match.
+        bool anchor_indices(Indices& indices)
+        {
+            if (indices[0] < 8)
+            {
+                return false;
+            }
+
+            for (auto& index : indices)
+            {
+                index = static_cast<std::uint8_t>(15 - index);
+            }
+
+            return true;
+        }
+
+        std::array<float, 16> bptc_weights_normalised()
+        {
+            std::array<float, 16> weights;
+            for (std::size_t k{0}; k < 16; ++k)
+            {
+                weights[k] = bptc_weights[k] / 64.0f;
+            }
+
+            return weights;
+        }
+
+        // BC7 mode 6: a single subset of RGBA with 7-bit endpoints plus a p-bit each and
+        // 4-bit indices.
+        void
+        encode_bc7(Texels const& texels, BlockQuality quality, std::byte* destination)
+        {
+            struct Candidate
+            {
+                std::array<int, 4> a;
+                std::array<int, 4> b;
+                int pa;
+                int pb;
+                Indices indices;
+                float error;
+            };
+
+            auto evaluate = [&texels](Endpoints const& endpoints, int pa, int pb) {
+                Candidate candidate;
+                candidate.pa = pa;
+                candidate.pb = pb;
+
+                Palette palette{};
+                for (std::size_t c{0}; c < 4; ++c)
+                {
+                    candidate.a[c] = quantise(endpoints.a[c] - pa, 0.5f, 127);
+                    candidate.b[c] = quantise(endpoints.b[c] - pb, 0.5f, 127);
+
+                    auto a = (candidate.a[c] << 1) | pa;
+                    auto b = (candidate.b[c] << 1) | pb;
+                    for (std::size_t k{0}; k < 16; ++k)
+                    {
+                        palette.colours[k][c] =
+                            static_cast<float>(bptc_interpolate(a, b, k));
+                    }
+                }
+                palette.count = 16;
+
+                candidate.error = fit_indices(texels, palette, candidate.indices);
+                return candidate;
+            };
+
+            // The p-bit that rounds an endpoint with the least error.
+            auto closest_pbit = [](std::array<float, 4> const& endpoint) {
+                std::array<float, 2> error{};
+                for (int p{0}; p < 2; ++p)
+                {
+                    for (auto value : endpoint)
+                    {
+                        auto expanded = (quantise(value - p, 0.5f, 127) << 1) | p;
+                        error[p] += (value - expanded) * (value - expanded);
+                    }
+                }
+
+                return error[1] < error[0] ? 1 : 0;
+            };
+
+            auto search = [&](Endpoints const& endpoints) {
+                if (quality != BlockQuality::high)
+                {
+                    return evaluate(endpoints,
+                                    closest_pbit(endpoints.a),
+                                    closest_pbit(endpoints.b));
+                }
+
+                auto best = evaluate(endpoints, 0, 0);
+                for (int p{1}; p < 4; ++p)
+                {
+                    auto candidate = evaluate(endpoints, p & 1, p >> 1);
+                    best = (candidate.error < best.error) ? candidate : best;
+                }
+
+                return best;
+            };
+
+            auto endpoints = initial_endpoints(texels, all_texels, 4, quality);
+            auto best      = search(endpoints);
+            if (quality == BlockQuality::high)
+            {
+                auto weights = bptc_weights_normalised();
+                for (int iteration{0}; iteration < 2; ++iteration)
+                {
+                    if (!refine_endpoints(texels,
+                                          all_texels,
+                                          4,
+                                          best.indices,
+                                          weights.data(),
+                                          endpoints))
+                    {
+                        break;
+                    }
+
+                    auto candidate = search(endpoints);
+                    if (candidate.error >= best.error)
+                    {
+                        break;
+                    }
+                    best = candidate;
+                }
+            }
+
+            if (anchor_indices(best.indices))
+            {
+                std::swap(best.a, best.b);
+                std::swap(best.pa, best.pb);
+            }
+
+            BlockWriter writer;
+            writer.write(1 << 6, 7);
+            for (std::size_t c{0}; c < 4; ++c)
+            {
+                writer.write(static_cast<std::uint64_t>(best.a[c]), 7);
+                writer.write(static_cast<std::uint64_t>(best.b[c]), 7);
+            }
+            writer.write(static_cast<std::uint64_t>(best.pa), 1);
+            writer.write(static_cast<std::uint64_t>(best.pb), 1);
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                writer.write(best.indices[i], (i == 0) ? 3 : 4);
+            }
+            writer.store(destination, 16);
+        }
+
+        // Largest finite half, BC6H has no encoding for infinity or NaN.
+        static constexpr float max_half_bits{0x7bff};
+
+        // Unsigned BC6H works on the bit patterns of halves, which grow roughly with the
+        // logarithm of the value, so texels are fitted in that space.
+        float half_bits(float value)
+        {
+            if (!(value > 0.0f))
+            {
+                return 0.0f;
+            }
+
+            return std::min(static_cast<float>(assets::float_to_half(value)),
+                            max_half_bits);
+        }
+
+        // Endpoints are stored with 10 bits and stretched back to 16 before they are
+        // interpolated, and the result is scaled by 31/64 into the half range.
+        int bc6h_unquantise(int value)
+        {
+            if (value == 0)
+            {
+                return 0;
+            }
+
+            if (value == 1023)
+            {
+                return 0xffff;
+            }
+
+            return ((value << 16) + 0x8000) >> 10;
+        }
+
+        int bc6h_quantise(float bits)
+        {
+            return quantise(bits * 64.0f / 31.0f - 32.0f, 1.0f / 64.0f, 1023);
+        }
+
+        // BC6H mode 11: a single region of unsigned RGB with 10-bit endpoints and 4-bit
+        // indices.
+        void
+        encode_bc6h(Texels const& texels, BlockQuality quality, std::byte* destination)
+        {
+            struct Candidate
+            {
+                std::array<int, 3> a;
+                std::array<int, 3> b;
+                Indices indices;
+                float error;
+            };
+
+            auto evaluate = [&texels](Endpoints const& endpoints) {
+                Candidate candidate;
+
+                Palette palette{};
+                for (std::size_t c{0}; c < 3; ++c)
+                {
+                    candidate.a[c] = bc6h_quantise(endpoints.a[c]);
+                    candidate.b[c] = bc6h_quantise(endpoints.b[c]);
+
+                    auto a = bc6h_unquantise(candidate.a[c]);
+                    auto b = bc6h_unquantise(candidate.b[c]);
+                    for (std::size_t k{0}; k < 16; ++k)
+                    {
+                        palette.colours[k][c] =
+                            static_cast<float>((bptc_interpolate(a, b, k) * 31) >> 6);
+                    }
+                }
+                palette.count = 16;
+
+                candidate.error = fit_indices(texels, palette, candidate.indices);
+                return candidate;
+            };
+
+            auto endpoints = initial_endpoints(texels, all_texels, 3, quality);
+            auto best      = evaluate(endpoints);
+            if (quality == BlockQuality::high)
+            {
+                auto weights = bptc_weights_normalised();
+                for (int iteration{0}; iteration < 2; ++iteration)
+                {
+                    if (!refine_endpoints(texels,
+                                          all_texels,
+                                          3,
+                                          best.indices,
+                                          weights.data(),
+                                          endpoints))
+                    {
+                        break;
+                    }
+
+                    auto candidate = evaluate(endpoints);
+                    if (candidate.error >= best.error)
+                    {
+                        break;
+                    }
+                    best = candidate;
+                }
+            }
+
+            if (anchor_indices(best.indices))
+            {
+                std::swap(best.a, best.b);
+            }
+
+            BlockWriter writer;
+            writer.write(0x03, 5);
+            for (auto const& endpoint : {best.a, best.b})
+            {
+                for (auto value : endpoint)
+                {
+                    writer.write(static_cast<std::uint64_t>(value), 10);
+                }
+            }
+            for (std::size_t i{0}; i < 16; ++i)
+            {
+                writer.write(best.indices[i], (i == 0) ? 3 : 4);
+            }
+            writer.store(destination, 16);
+        }
+
+        // Gathers the block at (x, y) in texels, clamping to the edges of the image.
+        Texels load_block(TextureFormat format,
+                          std::uint32_t width,
+                          std::uint32_t height,
+                          void const* pixels,
+                          std::uint32_t x,
+                          std::uint32_t y)
+        {
+            Texels texels;
+            for (std::uint32_t i{0}; i < 16; ++i)
+            {
+                std::size_t px = std::min(x + i % 4, width - 1);
+                std::size_t py = std::min(y + i / 4, height - 1);
+                auto offset    = (py * width + px) * 4;
+
+                if (format == TextureFormat::bc6h_rgb_ufloat)
+                {
+                    auto texel = static_cast<float const*>(pixels) + offset;
+                    for (std::size_t c{0}; c < 3; ++c)
+                    {
+                        texels.channels[c][i] = half_bits(texel[c]);
+                    }
+                    texels.channels[3][i] = 0.0f;
+                }
+                else
+                {
+                    auto texel = static_cast<std::uint8_t const*>(pixels) + offset;
+                    for (std::size_t c{0}; c < 4; ++c)
+                    {
+                        texels.channels[c][i] = static_cast<float>(texel[c]);
+                    }
+                }
+            }
+
+            return texels;
+        }
+    } // namespace
+
+    bool can_compress_blocks(TextureFormat format)
+    {
+        switch (format)
+        {
+        case TextureFormat::bc1_rgba_unorm:
+        case TextureFormat::bc3_rgba_unorm:
+        case TextureFormat::bc4_r_unorm:
+        case TextureFormat::bc5_rg_unorm:
+        case TextureFormat::bc6h_rgb_ufloat:
+        case TextureFormat::bc7_rgba_unorm:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    std::vector<std::byte> compress_blocks(TextureFormat format,
+                                           BlockQuality quality,
+                                           std::uint32_t width,
+                                           std::uint32_t height,
+                                           void const* pixels,
+                                           assets::ThreadPool* pool)
+    {
+        if (!can_compress_blocks(format))
+        {
+            auto msg = fmt::format("error: cannot encode texture format {}",
+                                   magic_enum::enum_name(format));
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        auto block_size = assets::texel_block(format).size;
+        auto blocks_x   = (width + 3) / 4;
+        auto blocks_y   = (height + 3) / 4;
+        std::vector<std::byte> blocks(std::size_t{blocks_x} * blocks_y * block_size);
+
+        auto encode_row = [&](std::size_t y) {
+            for (std::uint32_t x{0}; x < blocks_x; ++x)
+            {
+                auto destination = blocks.data() + (y * blocks_x + x) * block_size;
+                auto texels      = load_block(format,
+                                         width,
+                                         height,
+                                         pixels,
+                                         x * 4,
+                                         static_cast<std::uint32_t>(y) * 4);
+
+                switch (format)
+                {
+                case TextureFormat::bc1_rgba_unorm:
+                    encode_colour(texels, quality, true, destination);
+                    break;
+
+                case TextureFormat::bc3_rgba_unorm:
+                    encode_single_channel(texels.channels[3], quality, destination);
+                    encode_colour(texels, quality, false, destination + 8);
+                    break;
+
+                case TextureFormat::bc4_r_unorm:
+                    encode_single_channel(texels.channels[0], quality, destination);
+                    break;
+
+                case TextureFormat::bc5_rg_unorm:
+                    encode_single_channel(texels.channels[0], quality, destination);
+                    encode_single_channel(texels.channels[1], quality, destination + 8);
+                    break;
+
+                case TextureFormat::bc6h_rgb_ufloat:
+                    encode_bc6h(texels, quality, destination);
+                    break;
+
+                default:
+                    encode_bc7(texels, quality, destination);
+                    break;
+                }
+            }
+        };
+
+        if (pool != nullptr)
+        {
+            pool->parallel_for(blocks_y, encode_row);
+        }
+        else
+        {
+            for (std::size_t y{0}; y < blocks_y; ++y)
+            {
+                encode_row(y);
+            }
+        }
+
+        return blocks;
+    }
+} // namespace kass
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <assets/texture_asset.hpp>
+#include <assets/thread_pool.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace kass
+{
+    // How much time the encoder spends per block. fast takes the bounds of the block as
+    // endpoints, normal fits them along the principal axis of its texels and high also
+    // refines them by least squares and tries every alternative block mode.
+    enum class BlockQuality
+    {
+        fast,
+        normal,
+        high
+    };
+
+    // Whether compress_blocks can encode a format. BC6H is only written unsigned.
+    bool can_compress_blocks(assets::TextureFormat format);
+
+    // Encodes an image into the 4x4 blocks of a block-compressed format, repeating the
+    // last row and column to fill partial blocks. Pixels are RGBA, 8-bit unorm for
+    // every format except BC6H which takes 32-bit floats. Rows of blocks are encoded in
+    // parallel when a pool is given.
+    std::vector<std::byte> compress_blocks(assets::TextureFormat format,
+                                           BlockQuality quality,
+                                           std::uint32_t width,
+                                           std::uint32_t height,
+                                           void const* pixels,
+                                           assets::ThreadPool* pool = nullptr);
+} // namespace kass
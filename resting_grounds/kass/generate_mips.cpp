@@ -0,0 +1,442 @@
+#include "generate_mips.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define KASS_GENERATE_MIPS_SSE
+#    include <emmintrin.h>
+#endif
+
+namespace kass
+{
+    namespace
+    {
+        // Rows handed to each task when a level is filtered in parallel.
+        static constexpr std::size_t band_rows{16};
+
+        // Half-width of the Kaiser window in texels of the smaller level, and its shape.
+        static constexpr float kaiser_width{3.0f};
+        static constexpr float kaiser_alpha{4.0f};
+
+        // The source texels and weights that make up each destination texel along one
+        // axis. Every destination texel has the same number of taps, padded with zero
+        // weights, and indices are clamped to the edge of the source.
+        struct Taps
+        {
+            std::size_t count;
+            std::vector<std::uint32_t> indices;
+            std::vector<float> weights;
+        };
+
+        float bessel_i0(float x)
+        {
+            float sum{1.0f};
+            float term{1.0f};
+            for (int k{1}; k < 16; ++k)
+            {
+                auto factor = x / (2.0f * k);
+                term *= factor * factor;
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        float kaiser(float x)
+        {
+            if (std::abs(x) >= kaiser_width)
+            {
+                return 0.0f;
+            }
+
+            auto pi   = std::numbers::pi_v<float>;
+            auto sinc = (x == 0.0f) ? 1.0f : std::sin(pi * x) / (pi * x);
+            auto t    = x / kaiser_width;
+            return sinc * bessel_i0(kaiser_alpha * std::sqrt(1.0f - t * t))
+                   / bessel_i0(kaiser_alpha);
+        }
+
+        Taps build_taps(std::uint32_t source, std::uint32_t destination, MipFilter filter)
+        {
+            auto scale  = static_cast<float>(source) / destination;
+            auto radius = scale * ((filter == MipFilter::box) ? 0.5f : kaiser_width);
+
+            // Odd sizes make the box straddle three texels instead of two.
+            std::vector<std::vector<std::pair<std::uint32_t, float>>> texels(destination);
+            std::size_t count{0};
+            for (std::uint32_t i{0}; i < destination; ++i)
+            {
+                auto centre = (i + 0.5f) * scale;
+                auto first  = static_cast<int>(std::floor(centre - radius));
+                auto last   = static_cast<int>(std::ceil(centre + radius));
+
+                float total{0.0f};
+                for (int j{first}; j < last; ++j)
+                {
+                    float weight{0.0f};
+                    if (filter == MipFilter::box)
+                    {
+                        auto low  = std::max(static_cast<float>(j), centre - radius);
+                        auto high = std::min(static_cast<float>(j + 1), centre + radius);
+                        weight    = std::max(0.0f, high - low);
+                    }
+                    else
+                    {
+                        weight = kaiser((j + 0.5f - centre) / scale);
+                    }
+
+                    if (weight == 0.0f)
+                    {
+                        continue;
+                    }
+
+                    auto index = std::clamp(j, 0, static_cast<int>(source) - 1);
+                    texels[i].emplace_back(static_cast<std::uint32_t>(index), weight);
+                    total += weight;
+                }
+
+                for (auto& [index, weight] : texels[i])
+                {
+                    weight /= total;
+                }
+                count = std::max(count, texels[i].size());
+            }
+
+            Taps taps;
+            taps.count = count;
+            taps.indices.resize(destination * count, 0);
+            taps.weights.resize(destination * count, 0.0f);
+            for (std::uint32_t i{0}; i < destination; ++i)
+            {
+                for (std::size_t k{0}; k < texels[i].size(); ++k)
+                {
+                    taps.indices[i * count + k] = texels[i][k].first;
+                    taps.weights[i * count + k] = texels[i][k].second;
+                }
+            }
+
+            return taps;
+        }
+
+        // Filters rows [first, last) of an RGBA float image horizontally.
+        void filter_rows(float const* source,
+                         std::size_t source_width,
+                         float* destination,
+                         std::size_t destination_width,
+                         Taps const& taps,
+                         std::size_t first,
+                         std::size_t last)
+        {
+            for (std::size_t y{first}; y < last; ++y)
+            {
+                auto source_row      = source + y * source_width * 4;
+                auto destination_row = destination + y * destination_width * 4;
+                for (std::size_t x{0}; x < destination_width; ++x)
+                {
+                    auto indices = taps.indices.data() + x * taps.count;
+                    auto weights = taps.weights.data() + x * taps.count;
+#if defined(KASS_GENERATE_MIPS_SSE)
+                    auto sum = _mm_setzero_ps();
+                    for (std::size_t k{0}; k < taps.count; ++k)
+                    {
+                        auto texel = _mm_loadu_ps(source_row + indices[k] * 4);
+                        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), texel));
+                    }
+                    _mm_storeu_ps(destination_row + x * 4, sum);
+#else
+                    float sum[4]{};
+                    for (std::size_t k{0}; k < taps.count; ++k)
+                    {
+                        for (std::size_t c{0}; c < 4; ++c)
+                        {
+                            sum[c] += weights[k] * source_row[indices[k] * 4 + c];
+                        }
+                    }
+                    std::memcpy(destination_row + x * 4, sum, sizeof(sum));
+#endif
+                }
+            }
+        }
+
+        // Filters rows [first, last) of the destination vertically, a whole source row
+        // at a time.
+        void filter_columns(float const* source,
+                            std::size_t width,
+                            float* destination,
+                            Taps const& taps,
+                            std::size_t first,
+                            std::size_t last)
+        {
+            auto row_size = width * 4;
+            for (std::size_t y{first}; y < last; ++y)
+            {
+                auto destination_row = destination + y * row_size;
+                std::fill_n(destination_row, row_size, 0.0f);
+
+                for (std::size_t k{0}; k < taps.count; ++k)
+                {
+                    auto tap        = y * taps.count + k;
+                    auto weight     = taps.weights[tap];
+                    auto source_row = source + taps.indices[tap] * row_size;
+                    if (weight == 0.0f)
+                    {
+                        continue;
+                    }
+
+                    std::size_t i{0};
+#if defined(KASS_GENERATE_MIPS_SSE)
+                    auto factor = _mm_set1_ps(weight);
+                    for (; i < row_size; i += 4)
+                    {
+                        auto sum   = _mm_loadu_ps(destination_row + i);
+                        auto texel = _mm_loadu_ps(source_row + i);
+                        _mm_storeu_ps(destination_row + i,
+                                      _mm_add_ps(sum, _mm_mul_ps(factor, texel)));
+                    }
+#endif
+                    for (; i < row_size; ++i)
+                    {
+                        destination_row[i] += weight * source_row[i];
+                    }
+                }
+            }
+        }
+
+        template<typename Fn>
+        void for_each_band(std::size_t rows, assets::ThreadPool* pool, Fn&& fn)
+        {
+            auto bands = (rows + band_rows - 1) / band_rows;
+            auto band  = [&](std::size_t b) {
+                fn(b * band_rows, std::min(rows, (b + 1) * band_rows));
+            };
+
+            if (pool != nullptr)
+            {
+                pool->parallel_for(bands, band);
+            }
+            else
+            {
+                for (std::size_t b{0}; b < bands; ++b)
+                {
+                    band(b);
+                }
+            }
+        }
+
+        float srgb_to_linear(float value)
+        {
+            return (value <= 0.04045f) ? value / 12.92f
+                                       : std::pow((value + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linear_to_srgb(float value)
+        {
+            return (value <= 0.0031308f) ? value * 12.92f
+                                         : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        }
+
+        // Decoding has one entry per 8-bit value. Encoding is indexed by linear values
+        // in 1/65535 steps, which is fine enough to round every sRGB value correctly.
+        struct SrgbTables
+        {
+            static constexpr std::size_t encode_steps{65536};
+
+            std::array<float, 256> decode;
+            std::vector<std::uint8_t> encode;
+        };
+
+        SrgbTables const& srgb_tables()
+        {
+            static SrgbTables const tables = []() {
+                SrgbTables tables;
+                for (std::size_t i{0}; i < tables.decode.size(); ++i)
+                {
+                    tables.decode[i] = srgb_to_linear(i / 255.0f);
+                }
+
+                tables.encode.resize(SrgbTables::encode_steps);
+                for (std::size_t i{0}; i < tables.encode.size(); ++i)
+                {
+                    auto value = linear_to_srgb(i / float(SrgbTables::encode_steps - 1));
+                    tables.encode[i] =
+                        static_cast<std::uint8_t>(std::lround(value * 255.0f));
+                }
+
+                return tables;
+            }();
+
+            return tables;
+        }
+
+        // Turns rows of the input into linear, optionally premultiplied, floats.
+        void load_rows(void const* pixels,
+                       std::size_t width,
+                       bool is_float,
+                       MipOptions const& options,
+                       float* destination,
+                       std::size_t first,
+                       std::size_t last)
+        {
+            auto const& tables = srgb_tables();
+            for (std::size_t i{first * width}; i < last * width; ++i)
+            {
+                auto texel = destination + i * 4;
+                if (is_float)
+                {
+                    std::memcpy(texel, static_cast<float const*>(pixels) + i * 4, 16);
+                }
+                else
+                {
+                    auto source = static_cast<std::uint8_t const*>(pixels) + i * 4;
+                    for (std::size_t c{0}; c < 4; ++c)
+                    {
+                        texel[c] = (c < 3 && options.srgb) ? tables.decode[source[c]]
+                                                           : source[c] / 255.0f;
+                    }
+                }
+
+                if (options.premultiply_alpha)
+                {
+                    for (std::size_t c{0}; c < 3; ++c)
+                    {
+                        texel[c] *= texel[3];
+                    }
+                }
+            }
+        }
+
+        // The reverse of load_rows. Values the filter pushed out of range are clamped.
+        void store_rows(float const* source,
+                        std::size_t width,
+                        bool is_float,
+                        MipOptions const& options,
+                        std::byte* pixels,
+                        std::size_t first,
+                        std::size_t last)
+        {
+            auto const& tables = srgb_tables();
+            for (std::size_t i{first * width}; i < last * width; ++i)
+            {
+                float texel[4];
+                std::memcpy(texel, source + i * 4, sizeof(texel));
+
+                texel[3] = std::clamp(texel[3], 0.0f, 1.0f);
+                for (std::size_t c{0}; c < 3; ++c)
+                {
+                    if (options.premultiply_alpha)
+                    {
+                        texel[c] = (texel[3] > 0.0f) ? texel[c] / texel[3] : 0.0f;
+                    }
+                    texel[c] = std::max(texel[c], 0.0f);
+                }
+
+                if (is_float)
+                {
+                    std::memcpy(pixels + i * 16, texel, sizeof(texel));
+                    continue;
+                }
+
+                auto destination = reinterpret_cast<std::uint8_t*>(pixels) + i * 4;
+                for (std::size_t c{0}; c < 4; ++c)
+                {
+                    auto value = std::min(texel[c], 1.0f);
+                    if (c < 3 && options.srgb)
+                    {
+                        auto step = value * (SrgbTables::encode_steps - 1) + 0.5f;
+                        destination[c] = tables.encode[static_cast<std::size_t>(step)];
+                    }
+                    else
+                    {
+                        destination[c] = static_cast<std::uint8_t>(value * 255.0f + 0.5f);
+                    }
+                }
+            }
+        }
+    } // namespace
+
+    std::uint32_t count_mips(std::uint32_t width, std::uint32_t height)
+    {
+        std::uint32_t count{1};
+        while (width > 1 || height > 1)
+        {
+            width  = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+            ++count;
+        }
+
+        return count;
+    }
+
+    std::vector<MipLevel> generate_mips(std::uint32_t width,
+                                        std::uint32_t height,
+                                        void const* pixels,
+                                        bool is_float,
+                                        MipOptions const& options,
+                                        assets::ThreadPool* pool)
+    {
+        std::size_t texel_size = is_float ? 16 : 4;
+
+        std::vector<MipLevel> levels(count_mips(width, height));
+        levels[0].width  = width;
+        levels[0].height = height;
+        levels[0].texels.resize(std::size_t{width} * height * texel_size);
+        std::memcpy(levels[0].texels.data(), pixels, levels[0].texels.size());
+
+        // Every level is filtered from the linear floats of the one above rather than
+        // from its stored texels, so rounding doesn't accumulate down the chain.
+        std::vector<float> current(std::size_t{width} * height * 4);
+        for_each_band(height, pool, [&](std::size_t first, std::size_t last) {
+            load_rows(pixels, width, is_float, options, current.data(), first, last);
+        });
+
+        std::vector<float> horizontal;
+        std::vector<float> next;
+        for (std::size_t i{1}; i < levels.size(); ++i)
+        {
+            auto const& above = levels[i - 1];
+            auto& level       = levels[i];
+            level.width       = std::max(1u, above.width / 2);
+            level.height      = std::max(1u, above.height / 2);
+
+            auto taps_x = build_taps(above.width, level.width, options.filter);
+            auto taps_y = build_taps(above.height, level.height, options.filter);
+
+            horizontal.resize(std::size_t{level.width} * above.height * 4);
+            for_each_band(above.height, pool, [&](std::size_t first, std::size_t last) {
+                filter_rows(current.data(),
+                            above.width,
+                            horizontal.data(),
+                            level.width,
+                            taps_x,
+                            first,
+                            last);
+            });
+
+            next.resize(std::size_t{level.width} * level.height * 4);
+            level.texels.resize(std::size_t{level.width} * level.height * texel_size);
+            for_each_band(level.height, pool, [&](std::size_t first, std::size_t last) {
+                filter_columns(horizontal.data(),
+                               level.width,
+                               next.data(),
+                               taps_y,
+                               first,
+                               last);
+                store_rows(next.data(),
+                           level.width,
+                           is_float,
+                           options,
+                           level.texels.data(),
+                           first,
+                           last);
+            });
+
+            std::swap(current, next);
+        }
+
+        return levels;
+    }
+} // namespace kass
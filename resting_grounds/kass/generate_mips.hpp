@@ -0,0 +1,50 @@
+#pragma once
+
+#include <assets/thread_pool.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kass
+{
+    enum class MipFilter
+    {
+        // Averages the texels each level covers in the one above.
+        box,
+        // Kaiser-windowed sinc, sharper than box at a higher cost.
+        kaiser
+    };
+
+    struct MipOptions
+    {
+        MipFilter filter{MipFilter::box};
+        // Colour channels of 8-bit images are sRGB encoded and are filtered in linear
+        // space. Turn off for data such as normal maps.
+        bool srgb{true};
+        // Weight colours by alpha while filtering, so that the colour of transparent
+        // texels doesn't bleed into their neighbours. Turn off when alpha isn't
+        // coverage, e.g. a mask packed next to unrelated colour channels.
+        bool premultiply_alpha{true};
+    };
+
+    struct MipLevel
+    {
+        std::uint32_t width;
+        std::uint32_t height;
+        std::vector<std::byte> texels;
+    };
+
+    // Number of levels down to 1x1, halving each side until it reaches 1.
+    std::uint32_t count_mips(std::uint32_t width, std::uint32_t height);
+
+    // Builds the full mip chain of an RGBA image, 8-bit unorm or 32-bit float, with the
+    // first level being the image itself. Each level is filtered from the one above, and
+    // bands of rows are filtered in parallel when a pool is given.
+    std::vector<MipLevel> generate_mips(std::uint32_t width,
+                                        std::uint32_t height,
+                                        void const* pixels,
+                                        bool is_float,
+                                        MipOptions const& options,
+                                        assets::ThreadPool* pool = nullptr);
+} // namespace kass
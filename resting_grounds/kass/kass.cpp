@@ -1,9 +1,14 @@
+#include "konvert_cache.hpp"
 #include "konverter.hpp"
 
 #include <argparse/argparse.hpp>
 #include <fmt/printf.h>
+#include <magic_enum.hpp>
 
+#include <algorithm>
 #include <filesystem>
+#include <memory>
+#include <thread>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -12,9 +17,64 @@ struct Options
 {
     std::vector<fs::path> input_paths;
     fs::path output_path;
-    bool split{false};
+    fs::path cache_path;
+    std::size_t num_jobs{std::thread::hardware_concurrency()};
+    kass::KonvertOptions konvert;
+    bool use_cache{true};
 };
 
+int report(std::vector<kass::KonvertResult> const& results)
+{
+    using kass::KonvertStatus;
+
+    auto count = [&results](KonvertStatus status) {
+        return std::count_if(results.begin(),
+                             results.end(),
+                             [status](kass::KonvertResult const& result) {
+                                 return result.status == status;
+                             });
+    };
+
+    for (auto& result : results)
+    {
+        for (auto& mesh : result.meshes)
+        {
+            fmt::print("{}: mesh '{}' ({}): {} triangles, {} -> {} vertices, {} "
+                       "meshlets, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, {} -> {} "
+                       "bytes\n",
+                       result.input.string(),
+                       mesh.name,
+                       magic_enum::enum_name(mesh.vertex_format),
+                       mesh.triangle_count,
+                       mesh.input_vertex_count,
+                       mesh.vertex_count,
+                       mesh.meshlet_count,
+                       mesh.input_acmr,
+                       mesh.acmr,
+                       mesh.input_atvr,
+                       mesh.atvr,
+                       mesh.input_bytes,
+                       mesh.bytes);
+        }
+
+        if (result.status == KonvertStatus::failed)
+        {
+            fmt::print("{}: {}\n", result.input.string(), result.error);
+        }
+    }
+
+    auto failed = count(KonvertStatus::failed);
+    fmt::print("kass: {} converted, {} from cache, {} up to date, {} skipped, "
+               "{} failed\n",
+               count(KonvertStatus::converted),
+               count(KonvertStatus::cached),
+               count(KonvertStatus::up_to_date),
+               count(KonvertStatus::skipped),
+               failed);
+
+    return failed == 0 ? 0 : 1;
+}
+
 std::pair<Options, int> parse_args(int argc, char* argv[])
 {
     argparse::ArgumentParser parser{"kass"};
@@ -33,6 +93,82 @@ std::pair<Options, int> parse_args(int argc, char* argv[])
         .metavar("OUT")
         .nargs(1)
         .help("Output directory where the converted files will be placed");
+    parser.add_argument("-c", "--cache")
+        .metavar("DIR")
+        .nargs(1)
+        .help("Directory of the conversion cache (defaults to .kass_cache in the "
+              "working directory)");
+    parser.add_argument("-j", "--jobs")
+        .metavar("N")
+        .nargs(1)
+        .scan<'i', int>()
+        .help("Number of files to convert concurrently (defaults to the number of "
+              "hardware threads)");
+    parser.add_argument("--codec")
+        .metavar("CODEC")
+        .nargs(1)
+        .help("Codec assets are compressed with: none, lz4, lz4hc[:LEVEL] or "
+              "zstd[:LEVEL] (defaults to lz4)");
+    parser.add_argument("--no-quantise")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Store mesh vertices as 32-bit floats instead of the smallest quantised "
+              "format within tolerance");
+    parser.add_argument("--lods")
+        .metavar("N")
+        .nargs(1)
+        .scan<'i', int>()
+        .help("Number of simplified levels of detail generated per mesh (defaults to "
+              "4)");
+    parser.add_argument("--tile-size")
+        .metavar("N")
+        .nargs(1)
+        .scan<'i', int>()
+        .help("Split texture mips larger than N texels along a side into tiles that "
+              "can be streamed separately (defaults to 0, no tiling)");
+    parser.add_argument("--texture-format")
+        .metavar("FORMAT")
+        .nargs(1)
+        .help("Format every texture is stored in, e.g. rgba_uint8 or bc5_rg_unorm "
+              "(defaults to a block-compressed format that suits each image)");
+    parser.add_argument("--texture-quality")
+        .metavar("QUALITY")
+        .nargs(1)
+        .help("Time spent encoding texture blocks: fast, normal or high (defaults to "
+              "normal)");
+    parser.add_argument("--mip-filter")
+        .metavar("FILTER")
+        .nargs(1)
+        .help("Filter texture mips are generated with: box or kaiser (defaults to box)");
+    parser.add_argument("--no-srgb")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Filter 8-bit textures as linear data instead of sRGB colours, e.g. for "
+              "normal maps. Data with an alpha channel likely wants --no-premultiply");
+    parser.add_argument("--no-premultiply")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Filter texture mips without weighting colours by alpha, for images whose "
+              "alpha holds data such as a mask rather than coverage");
+    parser.add_argument("--hdr-tolerance")
+        .metavar("ERROR")
+        .nargs(1)
+        .scan<'g', float>()
+        .help("Relative error raw HDR textures may lose to be stored as rgb9e5, "
+              "r11g11b10f or rgba_float16 (defaults to 1/256)");
+    parser.add_argument("--material-schemas")
+        .metavar("FILE")
+        .nargs(1)
+        .help("JSON file with the parameter layout of each base effect, used to "
+              "compile the custom properties of materials into parameter blocks");
+    parser.add_argument("--no-block-compress")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Store textures as raw texels unless --texture-format says otherwise");
+    parser.add_argument("--no-cache")
+        .default_value(false)
+        .implicit_value(true)
+        .help("Convert every input even if it is unchanged since the last run");
     parser.add_epilog(
         "This tool converts GLTF and all related files into a pre - processed asset file "
         "to speed up\n"
@@ -44,8 +180,9 @@ std::pair<Options, int> parse_args(int argc, char* argv[])
         "in which\n"
         "case they are merged into a single file per root directory (if the original "
         "input was a\n"
-        "directory). Converted files are saved next to the source files unless -o is "
-        "provided\n");
+        "directory). Converted files are saved next to the source files, with .kass "
+        "appended\n"
+        "to the file name, unless -o is provided\n");
 
     Options opt;
 
@@ -80,7 +217,154 @@ std::pair<Options, int> parse_args(int argc, char* argv[])
 
     if (parser["-s"] == true)
     {
-        opt.split = true;
+        opt.konvert.split = true;
+    }
+
+    opt.cache_path = fs::current_path() / ".kass_cache";
+    if (auto arg = parser.present("-c"); arg)
+    {
+        opt.cache_path = fs::path{*arg};
+    }
+
+    if (parser["--no-cache"] == true)
+    {
+        opt.use_cache = false;
+    }
+
+    if (auto arg = parser.present("--codec"); arg)
+    {
+        try
+        {
+            opt.konvert.codec = assets::parse_codec(*arg);
+        }
+        catch (std::runtime_error const& e)
+        {
+            fmt::print("{}\n", e.what());
+            return {opt, -1};
+        }
+    }
+
+    if (parser["--no-quantise"] == true)
+    {
+        opt.konvert.mesh.quantise = false;
+    }
+
+    if (auto arg = parser.present<int>("--lods"); arg)
+    {
+        if (*arg < 0)
+        {
+            fmt::print("error: the number of levels of detail cannot be negative\n");
+            return {opt, -1};
+        }
+
+        opt.konvert.mesh.lod_count = static_cast<std::size_t>(*arg);
+    }
+
+    if (auto arg = parser.present<int>("--tile-size"); arg)
+    {
+        if (*arg < 0)
+        {
+            fmt::print("error: the tile size cannot be negative\n");
+            return {opt, -1};
+        }
+
+        opt.konvert.texture.tile_size = static_cast<std::uint32_t>(*arg);
+    }
+
+    if (auto arg = parser.present("--texture-format"); arg)
+    {
+        auto format = magic_enum::enum_cast<assets::TextureFormat>(*arg);
+        if (!format || *format == assets::TextureFormat::unknonw)
+        {
+            fmt::print("error: unknown texture format {}\n", *arg);
+            return {opt, -1};
+        }
+
+        if (!kass::can_store_format(*format))
+        {
+            fmt::print("error: textures cannot be encoded as {}\n", *arg);
+            return {opt, -1};
+        }
+
+        opt.konvert.texture.format = *format;
+    }
+
+    if (auto arg = parser.present("--texture-quality"); arg)
+    {
+        auto quality = magic_enum::enum_cast<kass::BlockQuality>(*arg);
+        if (!quality)
+        {
+            fmt::print("error: unknown texture quality {}\n", *arg);
+            return {opt, -1};
+        }
+
+        opt.konvert.texture.quality = *quality;
+    }
+
+    if (auto arg = parser.present("--mip-filter"); arg)
+    {
+        auto filter = magic_enum::enum_cast<kass::MipFilter>(*arg);
+        if (!filter)
+        {
+            fmt::print("error: unknown mip filter {}\n", *arg);
+            return {opt, -1};
+        }
+
+        opt.konvert.texture.mips.filter = *filter;
+    }
+
+    if (parser["--no-srgb"] == true)
+    {
+        opt.konvert.texture.mips.srgb = false;
+    }
+
+    if (parser["--no-premultiply"] == true)
+    {
+        opt.konvert.texture.mips.premultiply_alpha = false;
+    }
+
+    if (auto arg = parser.present<float>("--hdr-tolerance"); arg)
+    {
+        if (!(*arg >= 0.0f))
+        {
+            fmt::print("error: the HDR tolerance cannot be negative\n");
+            return {opt, -1};
+        }
+
+        opt.konvert.texture.hdr_tolerance = *arg;
+    }
+
+    if (auto arg = parser.present("--material-schemas"); arg)
+    {
+        // Parsed once here rather than by every material the workers convert.
+        auto& material   = opt.konvert.material;
+        material.schemas = fs::absolute(*arg);
+        try
+        {
+            material.schema_table = std::make_shared<kass::MaterialSchemas const>(
+                kass::load_material_schemas(material.schemas));
+        }
+        catch (std::exception const& e)
+        {
+            fmt::print("{}\n", e.what());
+            return {opt, -1};
+        }
+    }
+
+    if (parser["--no-block-compress"] == true)
+    {
+        opt.konvert.texture.block_compress = false;
+    }
+
+    if (auto arg = parser.present<int>("-j"); arg)
+    {
+        if (*arg < 1)
+        {
+            fmt::print("error: the number of jobs must be at least 1\n");
+            return {opt, -1};
+        }
+
+        opt.num_jobs = static_cast<std::size_t>(*arg);
     }
 
     return {opt, 0};
@@ -94,10 +378,22 @@ int main(int argc, char** argv)
         return ret;
     }
 
-    for (auto path : opt.input_paths)
+    std::unique_ptr<kass::KonvertCache> cache;
+    if (opt.use_cache)
+    {
+        cache = std::make_unique<kass::KonvertCache>(
+            opt.cache_path,
+            kass::konvert_options(opt.konvert));
+    }
+
+    assets::ThreadPool pool{opt.num_jobs};
+    auto results =
+        kass::konvert_inputs(opt.input_paths, opt.konvert, cache.get(), pool);
+
+    if (cache)
     {
-        kass::konvert_file(path);
+        cache->save();
     }
 
-    return 0;
+    return report(results);
 }
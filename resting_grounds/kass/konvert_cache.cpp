@@ -0,0 +1,282 @@
+#include "konvert_cache.hpp"
+#include "konverter.hpp"
+
+#include <assets/mapped_file.hpp>
+#include <core/io/file_output_stream.hpp>
+
+#include <fmt/printf.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace kass
+{
+    namespace
+    {
+        static constexpr std::uint32_t manifest_version{1};
+
+        static constexpr std::uint64_t prime_1{11400714785074694791ull};
+        static constexpr std::uint64_t prime_2{14029467366897019727ull};
+        static constexpr std::uint64_t prime_3{1609587929392839161ull};
+        static constexpr std::uint64_t prime_4{9650029242287828579ull};
+        static constexpr std::uint64_t prime_5{2870177450012600261ull};
+
+        template<typename T>
+        T read_le(std::byte const* ptr)
+        {
+            T value;
+            std::memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+
+        std::uint64_t round(std::uint64_t acc, std::uint64_t input)
+        {
+            acc += input * prime_2;
+            acc = std::rotl(acc, 31);
+            return acc * prime_1;
+        }
+
+        std::uint64_t merge_round(std::uint64_t acc, std::uint64_t value)
+        {
+            acc ^= round(0, value);
+            return acc * prime_1 + prime_4;
+        }
+
+        std::string key_to_string(std::uint64_t key)
+        {
+            return fmt::format("{:016x}", key);
+        }
+    } // namespace
+
+    std::uint64_t hash_bytes(std::span<std::byte const> bytes, std::uint64_t seed)
+    {
+        // XXH64.
+        auto ptr        = bytes.data();
+        auto const size = bytes.size();
+        auto const end  = ptr + size;
+
+        std::uint64_t hash;
+        if (size >= 32)
+        {
+            std::uint64_t v1 = seed + prime_1 + prime_2;
+            std::uint64_t v2 = seed + prime_2;
+            std::uint64_t v3 = seed;
+            std::uint64_t v4 = seed - prime_1;
+
+            for (; ptr + 32 <= end; ptr += 32)
+            {
+                v1 = round(v1, read_le<std::uint64_t>(ptr));
+                v2 = round(v2, read_le<std::uint64_t>(ptr + 8));
+                v3 = round(v3, read_le<std::uint64_t>(ptr + 16));
+                v4 = round(v4, read_le<std::uint64_t>(ptr + 24));
+            }
+
+            hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12)
+                   + std::rotl(v4, 18);
+            hash = merge_round(hash, v1);
+            hash = merge_round(hash, v2);
+            hash = merge_round(hash, v3);
+            hash = merge_round(hash, v4);
+        }
+        else
+        {
+            hash = seed + prime_5;
+        }
+
+        hash += size;
+
+        for (; ptr + 8 <= end; ptr += 8)
+        {
+            hash ^= round(0, read_le<std::uint64_t>(ptr));
+            hash = std::rotl(hash, 27) * prime_1 + prime_4;
+        }
+
+        if (ptr + 4 <= end)
+        {
+            hash ^= read_le<std::uint32_t>(ptr) * prime_1;
+            hash = std::rotl(hash, 23) * prime_2 + prime_3;
+            ptr += 4;
+        }
+
+        for (; ptr < end; ++ptr)
+        {
+            hash ^= static_cast<std::uint8_t>(*ptr) * prime_5;
+            hash = std::rotl(hash, 11) * prime_1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= prime_2;
+        hash ^= hash >> 29;
+        hash *= prime_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    KonvertCache::KonvertCache(fs::path const& cache_dir, std::string_view options) :
+        m_cache_dir{cache_dir}
+    {
+        auto fingerprint = fmt::format("{};{};{}",
+                                       converter_version,
+                                       assets::AssetFile::current_version,
+                                       options);
+        m_seed = hash_bytes(std::as_bytes(std::span{fingerprint}));
+
+        fs::create_directories(m_cache_dir / "objects");
+
+        auto manifest_path = m_cache_dir / "manifest.json";
+        if (!fs::exists(manifest_path))
+        {
+            return;
+        }
+
+        try
+        {
+            std::ifstream stream{manifest_path};
+            auto manifest = nlohmann::json::parse(stream);
+            if (manifest["version"] != manifest_version)
+            {
+                return;
+            }
+
+            for (auto& [input, value] : manifest["entries"].items())
+            {
+                ManifestEntry entry;
+                entry.key = std::stoull(value["key"].get<std::string>(), nullptr, 16);
+                for (auto& output : value["outputs"])
+                {
+                    entry.outputs.emplace_back(output.get<std::string>());
+                }
+
+                m_manifest.insert({input, std::move(entry)});
+            }
+        }
+        catch (std::exception const& e)
+        {
+            fmt::print("warning: ignoring corrupt cache manifest: {}\n", e.what());
+            m_manifest.clear();
+        }
+    }
+
+    std::uint64_t KonvertCache::key(fs::path const& input,
+                                    std::span<fs::path const> dependencies) const
+    {
+        assets::MappedFile file{input};
+        auto key = hash_bytes(file.bytes(), m_seed);
+
+        for (auto const& dependency : dependencies)
+        {
+            if (fs::is_regular_file(dependency))
+            {
+                assets::MappedFile dependency_file{dependency};
+                key = hash_bytes(dependency_file.bytes(), key);
+            }
+        }
+
+        return key;
+    }
+
+    bool KonvertCache::is_up_to_date(fs::path const& input, std::uint64_t key) const
+    {
+        std::scoped_lock lock{m_mutex};
+        auto it = m_manifest.find(input.generic_string());
+        if (it == m_manifest.end() || it->second.key != key)
+        {
+            return false;
+        }
+
+        auto const& outputs = it->second.outputs;
+        return std::all_of(outputs.begin(), outputs.end(), [](fs::path const& output) {
+            return fs::exists(output);
+        });
+    }
+
+    std::optional<assets::AssetFile> KonvertCache::find(std::uint64_t key) const
+    {
+        auto path = object_path(key);
+        if (!fs::exists(path))
+        {
+            return {};
+        }
+
+        try
+        {
+            assets::MappedFile mapping{path};
+            auto view = assets::AssetFileView::load(mapping.bytes());
+
+            assets::AssetFile file;
+            file.type    = view.type;
+            file.version = view.version;
+            file.metadata.assign(view.metadata.begin(), view.metadata.end());
+            file.binary_blob.assign(view.binary_blob.begin(), view.binary_blob.end());
+            return file;
+        }
+        catch (std::exception const&)
+        {
+            // Stale or truncated objects are simply treated as misses.
+            return {};
+        }
+    }
+
+    void KonvertCache::store(std::uint64_t key, assets::AssetFile const& file)
+    {
+        // Write to a unique temporary and rename so an interrupted run never leaves a
+        // truncated object behind, even if two jobs store identical inputs at once.
+        auto path = object_path(key);
+        auto tmp  = path;
+        tmp += fmt::format(".{}.tmp", m_next_temp++);
+        {
+            core::io::FileOutputStream stream{tmp.string()};
+            file.save(stream);
+        }
+
+        fs::rename(tmp, path);
+    }
+
+    void KonvertCache::record(fs::path const& input,
+                              std::uint64_t key,
+                              std::vector<fs::path> outputs)
+    {
+        std::scoped_lock lock{m_mutex};
+        m_manifest[input.generic_string()] = {key, std::move(outputs)};
+    }
+
+    void KonvertCache::save() const
+    {
+        std::scoped_lock lock{m_mutex};
+        nlohmann::json entries = nlohmann::json::object();
+        for (auto& [input, entry] : m_manifest)
+        {
+            std::vector<std::string> outputs;
+            for (auto& output : entry.outputs)
+            {
+                outputs.push_back(output.generic_string());
+            }
+
+            entries[input] = {{"key", key_to_string(entry.key)}, {"outputs", outputs}};
+        }
+
+        nlohmann::json manifest;
+        manifest["version"] = manifest_version;
+        manifest["entries"] = entries;
+
+        auto path = m_cache_dir / "manifest.json";
+        auto tmp  = path;
+        tmp += ".tmp";
+        {
+            std::ofstream stream{tmp};
+            stream << manifest.dump(4);
+        }
+
+        fs::rename(tmp, path);
+    }
+
+    fs::path KonvertCache::object_path(std::uint64_t key) const
+    {
+        return m_cache_dir / "objects" / (key_to_string(key) + ".kass");
+    }
+} // namespace kass
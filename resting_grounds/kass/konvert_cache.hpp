@@ -0,0 +1,62 @@
+#pragma once
+
+#include <assets/asset_file.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace kass
+{
+    std::uint64_t hash_bytes(std::span<std::byte const> bytes, std::uint64_t seed = 0);
+
+    // Persistent conversion cache. Converted assets are stored under a key derived from
+    // the source bytes, the converter options and the converter version, and a
+    // manifest records which outputs each input produced on the last run. All member
+    // functions are safe to call concurrently.
+    class KonvertCache
+    {
+    public:
+        KonvertCache(std::filesystem::path const& cache_dir, std::string_view options);
+
+        // Dependencies are hashed after the input in the order given. Missing ones are
+        // skipped so that the converter gets to report them.
+        std::uint64_t key(std::filesystem::path const& input,
+                          std::span<std::filesystem::path const> dependencies = {}) const;
+
+        // True if the input was last converted with the same key and every output it
+        // produced still exists.
+        bool is_up_to_date(std::filesystem::path const& input, std::uint64_t key) const;
+
+        std::optional<assets::AssetFile> find(std::uint64_t key) const;
+        void store(std::uint64_t key, assets::AssetFile const& file);
+
+        void record(std::filesystem::path const& input,
+                    std::uint64_t key,
+                    std::vector<std::filesystem::path> outputs);
+
+        void save() const;
+
+    private:
+        struct ManifestEntry
+        {
+            std::uint64_t key;
+            std::vector<std::filesystem::path> outputs;
+        };
+
+        std::filesystem::path object_path(std::uint64_t key) const;
+
+        std::filesystem::path m_cache_dir;
+        std::uint64_t m_seed;
+        std::atomic<std::uint64_t> m_next_temp{0};
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, ManifestEntry> m_manifest;
+    };
+} // namespace kass
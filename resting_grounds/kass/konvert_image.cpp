@@ -1,16 +1,22 @@
 #include "konvert_image.hpp"
 
+#include <assets/half_float.hpp>
 #include <assets/texture_asset.hpp>
 #include <core/memory_buffer.hpp>
 
 #include <fmt/printf.h>
+#include <magic_enum.hpp>
 #include <stb_image.h>
 #if defined(KASS_USE_NVTT)
 #    include <nvtt/nvtt.h>
-#else
-#    include <stb_image_resize.h>
 #endif
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <span>
+
 namespace kass
 {
     bool is_valid_image(std::string const& filename)
@@ -19,6 +25,12 @@ namespace kass
         return stbi_info(filename.c_str(), &w, &h, &c) == 1;
     }
 
+    bool can_store_format(assets::TextureFormat format)
+    {
+        return format != assets::TextureFormat::unknonw
+               && (assets::texel_block(format).width == 1 || can_compress_blocks(format));
+    }
+
 #if defined(KASS_USE_NVTT)
     std::vector<std::byte> compress_nvtt(assets::TextureAsset& texture,
                                          int width,
@@ -109,89 +121,262 @@ namespace kass
     }
 #else
 
-    int count_mipmaps(int width, int height)
+    bool is_opaque(std::uint8_t const* pixels, int width, int height)
     {
-        int count{1};
-        while (width > 1 && height > 1)
+        for (std::size_t i{0}; i < std::size_t(width) * height; ++i)
         {
-            width  = width / 2;
-            height = height / 2;
-            ++count;
+            if (pixels[i * 4 + 3] != 255)
+            {
+                return false;
+            }
         }
 
-        return count + 1;
+        return true;
     }
 
-    std::vector<std::byte> compress_regular(assets::TextureAsset& texture,
+    // RMS over texels of the error in each channel relative to the largest channel of its
+    // texel, so that dark texels count as much as bright ones. Non-finite texels, which
+    // none of the formats keep, are skipped.
+    template <typename Decode>
+    float relative_error(float const* pixels, std::size_t texel_count, Decode&& decode)
+    {
+        static constexpr float smallest_normal_half{6.103515625e-05f};
+
+        double sum{0.0};
+        std::size_t counted{0};
+        for (std::size_t i{0}; i < texel_count; ++i)
+        {
+            float const* texel = pixels + i * 4;
+            if (!std::isfinite(texel[0]) || !std::isfinite(texel[1])
+                || !std::isfinite(texel[2]) || !std::isfinite(texel[3]))
+            {
+                continue;
+            }
+
+            auto decoded = decode(texel);
+            float scale  = std::max({std::abs(texel[0]),
+                                     std::abs(texel[1]),
+                                     std::abs(texel[2]),
+                                     smallest_normal_half});
+            float error{0.0f};
+            for (std::size_t c{0}; c < decoded.size(); ++c)
+            {
+                error = std::max(error, std::abs(decoded[c] - texel[c]) / scale);
+            }
+
+            sum += double(error) * error;
+            ++counted;
+        }
+
+        return counted == 0 ? 0.0f : static_cast<float>(std::sqrt(sum / counted));
+    }
+
+    // Picks the smallest raw format that keeps an HDR image within the tolerance. The
+    // packed formats have no alpha, so they are only tried for opaque images.
+    assets::TextureFormat select_hdr_format(float const* pixels,
                                             int width,
                                             int height,
-                                            void const* pixels,
-                                            bool is_hdr)
+                                            float tolerance)
     {
-        using assets::TextureAsset;
+        using assets::TextureFormat;
 
-        const int num_mips = count_mipmaps(width, height);
-        int mip_w{width};
-        int mip_h{height};
-        std::vector<std::byte> compressed_data;
-        std::size_t data_size = (is_hdr) ? sizeof(float) : sizeof(std::uint8_t);
-        for (int mip{0}; mip < num_mips; ++mip)
+        auto texel_count = std::size_t(width) * height;
+        bool opaque{true};
+        for (std::size_t i{0}; i < texel_count && opaque; ++i)
         {
-            std::vector<std::byte> mip_bytes(mip_w * mip_h * data_size * 4);
-            int ret{0};
-            if (is_hdr)
+            opaque = pixels[i * 4 + 3] == 1.0f;
+        }
+
+        if (opaque)
+        {
+            auto rgb9e5_error = relative_error(pixels, texel_count, [](float const* t) {
+                return assets::rgb9e5_to_float(assets::float_to_rgb9e5(t[0], t[1], t[2]));
+            });
+            auto r11g11b10f_error =
+                relative_error(pixels, texel_count, [](float const* t) {
+                    return assets::r11g11b10f_to_float(
+                        assets::float_to_r11g11b10f(t[0], t[1], t[2]));
+                });
+
+            auto best = rgb9e5_error <= r11g11b10f_error ? TextureFormat::rgb9e5
+                                                         : TextureFormat::r11g11b10f;
+            if (std::min(rgb9e5_error, r11g11b10f_error) <= tolerance)
             {
-                ret = stbir_resize_float(reinterpret_cast<const float*>(pixels),
-                                         width,
-                                         height,
-                                         0,
-                                         reinterpret_cast<float*>(mip_bytes.data()),
-                                         mip_w,
-                                         mip_h,
-                                         0,
-                                         4);
+                return best;
             }
-            else
+        }
+
+        auto half_error = relative_error(pixels, texel_count, [](float const* t) {
+            std::array<float, 4> decoded;
+            for (std::size_t c{0}; c < decoded.size(); ++c)
+            {
+                decoded[c] = assets::half_to_float(assets::float_to_half(t[c]));
+            }
+            return decoded;
+        });
+
+        return half_error <= tolerance ? TextureFormat::rgba_float16
+                                       : TextureFormat::rgba_float32;
+    }
+
+    // Converts the float texels of a level into a compact HDR format in place.
+    void pack_hdr_texels(assets::TextureFormat format, MipLevel& level)
+    {
+        using assets::TextureFormat;
+
+        std::span<float const> rgba{reinterpret_cast<float const*>(level.texels.data()),
+                                    level.texels.size() / sizeof(float)};
+        auto texel_count = rgba.size() / 4;
+
+        std::vector<std::byte> packed(texel_count * assets::texel_block(format).size);
+        if (format == TextureFormat::rgba_float16)
+        {
+            assets::float_to_half(
+                rgba,
+                {reinterpret_cast<std::uint16_t*>(packed.data()), rgba.size()});
+        }
+        else if (format == TextureFormat::rgb9e5)
+        {
+            assets::rgba_to_rgb9e5(
+                rgba,
+                {reinterpret_cast<std::uint32_t*>(packed.data()), texel_count});
+        }
+        else
+        {
+            assets::rgba_to_r11g11b10f(
+                rgba,
+                {reinterpret_cast<std::uint32_t*>(packed.data()), texel_count});
+        }
+
+        level.texels = std::move(packed);
+    }
+
+    assets::TextureFormat select_format(TextureOptions const& options,
+                                        int width,
+                                        int height,
+                                        int channels,
+                                        void const* pixels,
+                                        bool is_hdr)
+    {
+        using assets::TextureFormat;
+
+        if (options.format)
+        {
+            auto format = *options.format;
+            if (!can_store_format(format))
             {
-                ret =
-                    stbir_resize_uint8(reinterpret_cast<const unsigned char*>(pixels),
-                                       width,
-                                       height,
-                                       0,
-                                       reinterpret_cast<unsigned char*>(mip_bytes.data()),
-                                       mip_w,
-                                       mip_h,
-                                       0,
-                                       4);
+                auto msg = fmt::format("error: cannot encode texture format {}",
+                                       magic_enum::enum_name(format));
+                throw std::runtime_error{msg.c_str()};
             }
 
-            if (!ret)
+            bool is_float = format == TextureFormat::rgba_float32
+                            || format == TextureFormat::rgba_float16
+                            || format == TextureFormat::rgb9e5
+                            || format == TextureFormat::r11g11b10f
+                            || format == TextureFormat::bc6h_rgb_ufloat
+                            || format == TextureFormat::bc6h_rgb_sfloat;
+            if (is_float != is_hdr)
             {
-                fmt::print("error: compression failed");
-                return {};
+                auto msg = fmt::format("error: cannot store {} images as {}",
+                                       is_hdr ? "HDR" : "LDR",
+                                       magic_enum::enum_name(format));
+                throw std::runtime_error{msg.c_str()};
             }
 
-            if (mip == num_mips - 1)
+            return format;
+        }
+
+        if (!options.block_compress)
+        {
+            return is_hdr ? select_hdr_format(static_cast<float const*>(pixels),
+                                              width,
+                                              height,
+                                              options.hdr_tolerance)
+                          : TextureFormat::rgba_uint8;
+        }
+
+        if (is_hdr)
+        {
+            return TextureFormat::bc6h_rgb_ufloat;
+        }
+
+        if (channels == 1)
+        {
+            return TextureFormat::bc4_r_unorm;
+        }
+
+        // BC7 is worth the encoding time unless the fastest preset is asked for.
+        if (options.quality == BlockQuality::fast)
+        {
+            return is_opaque(static_cast<std::uint8_t const*>(pixels), width, height)
+                       ? TextureFormat::bc1_rgba_unorm
+                       : TextureFormat::bc3_rgba_unorm;
+        }
+
+        return TextureFormat::bc7_rgba_unorm;
+    }
+
+    std::vector<std::byte> compress_regular(assets::TextureAsset& texture,
+                                            int width,
+                                            int height,
+                                            void const* pixels,
+                                            bool is_hdr,
+                                            TextureOptions const& options,
+                                            assets::ThreadPool* pool)
+    {
+        using assets::TextureAsset;
+        using assets::TextureFormat;
+
+        auto format           = texture.texture_format;
+        bool block_compressed = assets::texel_block(format).width > 1;
+        bool packed_hdr       = format == TextureFormat::rgba_float16
+                                || format == TextureFormat::rgb9e5
+                                || format == TextureFormat::r11g11b10f;
+
+        auto levels = generate_mips(static_cast<std::uint32_t>(width),
+                                    static_cast<std::uint32_t>(height),
+                                    pixels,
+                                    is_hdr,
+                                    options.mips,
+                                    pool);
+
+        std::vector<std::byte> compressed_data;
+        for (auto& level : levels)
+        {
+            if (block_compressed)
             {
-                break;
+                level.texels = compress_blocks(format,
+                                               options.quality,
+                                               level.width,
+                                               level.height,
+                                               level.texels.data(),
+                                               pool);
+            }
+            else if (packed_hdr)
+            {
+                pack_hdr_texels(format, level);
             }
 
             TextureAsset::Page page;
-            page.width         = mip_w;
-            page.height        = mip_h;
-            page.original_size = static_cast<std::uint32_t>(mip_bytes.size());
+            page.width         = level.width;
+            page.height        = level.height;
+            page.original_size = static_cast<std::uint32_t>(level.texels.size());
             texture.pages.push_back(page);
 
             compressed_data.insert(compressed_data.end(),
-                                   mip_bytes.begin(),
-                                   mip_bytes.end());
+                                   level.texels.begin(),
+                                   level.texels.end());
         }
 
         return compressed_data;
     }
 #endif
 
-    assets::AssetFile compress_image(std::string const& filename)
+    assets::AssetFile compress_image(std::string const& filename,
+                                     TextureOptions const& options,
+                                     assets::ChunkCodec codec,
+                                     assets::ThreadPool* pool)
     {
         using assets::TextureAsset;
         using assets::TextureFormat;
@@ -215,18 +400,28 @@ namespace kass
             return {};
         }
 
+        // Encoding can throw, so the pixels are released however this returns.
+        std::unique_ptr<void, decltype(&stbi_image_free)> pixel_owner{pixels,
+                                                                      stbi_image_free};
+
         int texture_size = width * height * channels;
 
         TextureAsset texture;
-        texture.texture_size = texture_size;
-        texture.texture_format =
-            (is_hdr) ? TextureFormat::rgba_float32 : TextureFormat::rgba_uint8;
+        texture.texture_size  = texture_size;
         texture.original_file = filename;
+        texture.codec         = codec;
+        texture.tile_size     = options.tile_size;
 
 #if defined(KASS_USE_NVTT)
+        static_cast<void>(pool);
+        texture.texture_format =
+            (is_hdr) ? TextureFormat::bc6h_rgb_sfloat : TextureFormat::bc7_rgba_unorm;
         auto bytes = compress_nvtt(texture, width, height, pixels, is_hdr);
 #else
-        auto bytes = compress_regular(texture, width, height, pixels, is_hdr);
+        texture.texture_format =
+            select_format(options, width, height, channels, pixels, is_hdr);
+        auto bytes =
+            compress_regular(texture, width, height, pixels, is_hdr, options, pool);
 #endif
         if (bytes.empty())
         {
@@ -234,7 +429,6 @@ namespace kass
         }
 
         texture.texture_size = bytes.size();
-        stbi_image_free(pixels);
 
         return texture.pack(bytes);
     }
@@ -1,14 +1,49 @@
 #pragma once
 
+#include "block_compress.hpp"
+#include "generate_mips.hpp"
+
 #include <assets/asset_file.hpp>
+#include <assets/codec.hpp>
+#include <assets/texture_asset.hpp>
+#include <assets/thread_pool.hpp>
 
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <vector>
 
 namespace kass
 {
+    struct TextureOptions
+    {
+        // Mips larger than this many texels along either side are split into tiles that
+        // are compressed and loaded on their own. 0 keeps every mip whole.
+        std::uint32_t tile_size{0};
+
+        // Format mips are stored in. Without one, a block-compressed format is picked
+        // from the contents of the image, or the raw format when block_compress is off.
+        bool block_compress{true};
+        BlockQuality quality{BlockQuality::normal};
+        std::optional<assets::TextureFormat> format;
+
+        // Largest RMS relative error HDR images may lose when stored raw. The most
+        // compact of rgb9e5, r11g11b10f and rgba_float16 within it is used, else
+        // rgba_float32.
+        float hdr_tolerance{1.0f / 256};
+
+        MipOptions mips;
+    };
+
     bool is_valid_image(std::string const& filename);
 
-    assets::AssetFile compress_image(std::string const& filename);
+    // Whether textures can be converted to a format, i.e. it is stored raw or
+    // compress_blocks can encode it.
+    bool can_store_format(assets::TextureFormat format);
+
+    // Blocks are encoded on the pool when one is given.
+    assets::AssetFile compress_image(std::string const& filename,
+                                     TextureOptions const& options,
+                                     assets::ChunkCodec codec,
+                                     assets::ThreadPool* pool = nullptr);
 } // namespace kass
@@ -0,0 +1,121 @@
+#include "konvert_manifest.hpp"
+
+#include <assets/asset_bundle.hpp>
+#include <assets/dependency_manifest.hpp>
+#include <assets/material_asset.hpp>
+#include <assets/prefab_asset.hpp>
+
+#include <map>
+#include <set>
+#include <tuple>
+#include <vector>
+
+namespace kass
+{
+    namespace
+    {
+        static constexpr std::array<char, 4> mesh_type{'M', 'E', 'S', 'H'};
+        static constexpr std::array<char, 4> texture_type{'T', 'E', 'X', 'I'};
+        static constexpr std::array<char, 4> material_type{'M', 'A', 'T', 'X'};
+        static constexpr std::array<char, 4> prefab_type{'P', 'R', 'F', 'B'};
+
+        using AssetKey     = std::tuple<std::uint64_t, std::array<char, 4>>;
+        using AssetIndex   = std::map<AssetKey, assets::AssetFile const*>;
+        using Dependencies = std::vector<assets::DependencyManifest::Dependency>;
+
+        class DependencyCollector
+        {
+        public:
+            DependencyCollector(AssetIndex const& index) :
+                m_index{index}
+            {}
+
+            // Returns the asset if the bundle has it and it wasn't collected already.
+            assets::AssetFile const* add(std::array<char, 4> const& type,
+                                         std::string_view name)
+            {
+                AssetKey key{assets::hash_name(name), type};
+                auto it = m_index.find(key);
+                if (it == m_index.end() || !m_seen.insert(key).second)
+                {
+                    return nullptr;
+                }
+
+                m_dependencies.push_back({std::get<0>(key), it->second->size(), type});
+                return it->second;
+            }
+
+            void add_material(assets::MaterialAsset const& material)
+            {
+                for (auto [slot, path] : material.textures)
+                {
+                    add(texture_type, material.strings[path]);
+                }
+            }
+
+            Dependencies const& dependencies() const
+            {
+                return m_dependencies;
+            }
+
+        private:
+            AssetIndex const& m_index;
+            std::set<AssetKey> m_seen;
+            Dependencies m_dependencies;
+        };
+    } // namespace
+
+    std::optional<assets::AssetFile>
+    konvert_manifest(std::span<BundledAsset const> bundled)
+    {
+        AssetIndex index;
+        for (auto const& asset : bundled)
+        {
+            index.insert({{assets::hash_name(asset.name), asset.file->type}, asset.file});
+        }
+
+        assets::DependencyManifest manifest;
+        for (auto const& asset : bundled)
+        {
+            DependencyCollector collector{index};
+            if (asset.file->type == material_type)
+            {
+                assets::MaterialAsset material;
+                material.read(*asset.file);
+                collector.add_material(material);
+            }
+            else if (asset.file->type == prefab_type)
+            {
+                assets::PrefabAsset prefab;
+                prefab.read(*asset.file);
+                for (auto const& mesh : prefab.meshes)
+                {
+                    collector.add(mesh_type, prefab.strings[mesh.mesh_path]);
+
+                    // Materials bring their textures along.
+                    auto material_path = prefab.strings[mesh.material_path];
+                    if (auto file = collector.add(material_type, material_path); file)
+                    {
+                        assets::MaterialAsset material;
+                        material.read(*file);
+                        collector.add_material(material);
+                    }
+                }
+            }
+
+            if (!collector.dependencies().empty())
+            {
+                manifest.add_root(asset.file->type,
+                                  assets::hash_name(asset.name),
+                                  collector.dependencies());
+            }
+        }
+
+        if (manifest.roots.empty())
+        {
+            return {};
+        }
+
+        return manifest.pack();
+    }
+} // namespace kass
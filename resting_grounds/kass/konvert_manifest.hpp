@@ -0,0 +1,23 @@
+#pragma once
+
+#include <assets/asset_file.hpp>
+
+#include <optional>
+#include <span>
+#include <string>
+
+namespace kass
+{
+    struct BundledAsset
+    {
+        std::string name;
+        assets::AssetFile const* file;
+    };
+
+    // Builds the dependency manifest of the prefabs and materials going into a bundle.
+    // Their mesh, material and texture paths are looked up as names of other assets in
+    // the bundle, that is relative to its root, and anything outside it is left out.
+    // Returns nothing if no asset has dependencies in the bundle.
+    std::optional<assets::AssetFile>
+    konvert_manifest(std::span<BundledAsset const> bundled);
+} // namespace kass
@@ -0,0 +1,368 @@
+#include "konvert_material.hpp"
+
+#include <fmt/printf.h>
+#include <magic_enum.hpp>
+#include <nlohmann/json.hpp>
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace kass
+{
+    namespace
+    {
+        std::uint32_t round_up(std::uint32_t value, std::uint32_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        std::uint32_t component_count(assets::ParameterType type)
+        {
+            return assets::parameter_size(type) / 4;
+        }
+
+        // Base alignment of a single element. Three-component vectors align like four
+        // and matrices like their vec4 columns, under both layouts.
+        std::uint32_t parameter_alignment(assets::ParameterType type)
+        {
+            auto size = assets::parameter_size(type);
+            return size <= 8 ? size : 16;
+        }
+
+        bool is_float(assets::ParameterType type)
+        {
+            using assets::ParameterType;
+            return type == ParameterType::float1 || type == ParameterType::float2
+                   || type == ParameterType::float3 || type == ParameterType::float4
+                   || type == ParameterType::float4x4;
+        }
+
+        bool is_signed(assets::ParameterType type)
+        {
+            using assets::ParameterType;
+            return type == ParameterType::int1 || type == ParameterType::int2
+                   || type == ParameterType::int3 || type == ParameterType::int4;
+        }
+
+        std::vector<double> parse_values(std::string_view name, std::string_view str)
+        {
+            std::vector<double> values;
+            while (!str.empty())
+            {
+                auto start = str.find_first_not_of(" \t\r\n,");
+                if (start == std::string_view::npos)
+                {
+                    break;
+                }
+
+                str        = str.substr(start);
+                auto token = str.substr(0, str.find_first_of(" \t\r\n,"));
+                str        = str.substr(token.size());
+
+                if (token == "true" || token == "false")
+                {
+                    values.push_back(token == "true" ? 1.0 : 0.0);
+                    continue;
+                }
+
+                double value{0.0};
+                auto [end, ec] =
+                    std::from_chars(token.data(), token.data() + token.size(), value);
+                if (ec != std::errc{} || end != token.data() + token.size())
+                {
+                    auto msg = fmt::format("error: property {} has a value {} that is "
+                                           "not a number",
+                                           name,
+                                           token);
+                    throw std::runtime_error{msg.c_str()};
+                }
+
+                values.push_back(value);
+            }
+
+            return values;
+        }
+
+        // Flattens JSON values into the string form custom properties are stored in.
+        std::string property_string(nlohmann::json const& value)
+        {
+            if (value.is_string())
+            {
+                return value.get<std::string>();
+            }
+
+            if (value.is_array())
+            {
+                std::string str;
+                for (auto const& element : value)
+                {
+                    str += str.empty() ? "" : " ";
+                    str += property_string(element);
+                }
+
+                return str;
+            }
+
+            return value.dump();
+        }
+
+        void write_value(std::byte* dest,
+                         assets::ParameterType type,
+                         double value,
+                         std::string_view name)
+        {
+            if (is_float(type))
+            {
+                auto f = static_cast<float>(value);
+                std::memcpy(dest, &f, sizeof(float));
+                return;
+            }
+
+            auto low  = is_signed(type) ? -2147483648.0 : 0.0;
+            auto high = is_signed(type) ? 2147483647.0 : 4294967295.0;
+            if (value != std::floor(value) || value < low || value > high)
+            {
+                auto msg = fmt::format("error: property {} has a value {} that doesn't "
+                                       "fit its {} type",
+                                       name,
+                                       value,
+                                       magic_enum::enum_name(type));
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            if (is_signed(type))
+            {
+                auto i = static_cast<std::int32_t>(value);
+                std::memcpy(dest, &i, sizeof(std::int32_t));
+            }
+            else
+            {
+                auto u = static_cast<std::uint32_t>(value);
+                std::memcpy(dest, &u, sizeof(std::uint32_t));
+            }
+        }
+    } // namespace
+
+    MaterialSchemas load_material_schemas(fs::path const& filename)
+    {
+        std::ifstream stream{filename};
+        if (!stream)
+        {
+            auto msg = fmt::format("error: unable to open material schemas {}",
+                                   filename.string());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        auto json = nlohmann::json::parse(stream);
+
+        MaterialSchemas schemas;
+        for (auto& [effect, entry] : json.items())
+        {
+            MaterialSchema schema;
+            if (entry.contains("layout"))
+            {
+                auto name   = entry["layout"].get<std::string>();
+                auto layout = magic_enum::enum_cast<assets::BlockLayout>(name);
+                if (!layout)
+                {
+                    auto msg = fmt::format("error: unknown block layout {}", name);
+                    throw std::runtime_error{msg.c_str()};
+                }
+                schema.layout = *layout;
+            }
+
+            for (auto& item : entry["parameters"])
+            {
+                SchemaParameter parameter;
+                parameter.name = item["name"].get<std::string>();
+
+                auto type_name = item["type"].get<std::string>();
+                auto type      = magic_enum::enum_cast<assets::ParameterType>(type_name);
+                if (!type)
+                {
+                    auto msg = fmt::format("error: unknown parameter type {}", type_name);
+                    throw std::runtime_error{msg.c_str()};
+                }
+                parameter.type = *type;
+
+                parameter.count = item.value("count", std::uint32_t{1});
+                if (parameter.count == 0)
+                {
+                    auto msg = fmt::format("error: parameter {} has a count of 0",
+                                           parameter.name);
+                    throw std::runtime_error{msg.c_str()};
+                }
+
+                if (item.contains("default"))
+                {
+                    parameter.default_value =
+                        parse_values(parameter.name, property_string(item["default"]));
+                }
+
+                schema.parameters.push_back(std::move(parameter));
+            }
+
+            schemas.insert({effect, std::move(schema)});
+        }
+
+        return schemas;
+    }
+
+    void compile_material(assets::MaterialAsset& material,
+                          MaterialSchema const& schema,
+                          PropertyMap& properties)
+    {
+        using assets::BlockLayout;
+
+        std::vector<assets::MaterialParameter> parameters;
+        std::uint32_t cursor{0};
+        std::uint32_t block_alignment{schema.layout == BlockLayout::std140 ? 16u : 4u};
+        for (auto const& parameter : schema.parameters)
+        {
+            auto size      = assets::parameter_size(parameter.type);
+            auto alignment = parameter_alignment(parameter.type);
+            auto stride    = round_up(size, alignment);
+            if (parameter.count > 1 && schema.layout == BlockLayout::std140)
+            {
+                // std140 pads the elements of arrays, and the arrays themselves, to vec4.
+                alignment = round_up(alignment, 16);
+                stride    = round_up(stride, 16);
+            }
+
+            auto offset = round_up(cursor, alignment);
+            cursor = offset + (parameter.count > 1 ? stride * parameter.count : size);
+
+            block_alignment = std::max(block_alignment, alignment);
+            parameters.push_back({material.strings.intern(parameter.name),
+                                  parameter.type,
+                                  offset,
+                                  parameter.count,
+                                  stride});
+        }
+
+        std::vector<std::byte> block(round_up(cursor, block_alignment));
+        for (std::size_t i{0}; i < parameters.size(); ++i)
+        {
+            auto const& parameter = schema.parameters[i];
+            auto const& entry     = parameters[i];
+
+            std::vector<double> values;
+            if (auto it = properties.find(parameter.name); it != properties.end())
+            {
+                values = parse_values(parameter.name, it->second);
+                properties.erase(it);
+            }
+            else if (!parameter.default_value.empty())
+            {
+                values = parameter.default_value;
+            }
+            else
+            {
+                continue;
+            }
+
+            auto components = component_count(parameter.type);
+            if (values.size() != std::size_t{components} * parameter.count)
+            {
+                auto msg = fmt::format("error: property {} needs {} values but has {}",
+                                       parameter.name,
+                                       components * parameter.count,
+                                       values.size());
+                throw std::runtime_error{msg.c_str()};
+            }
+
+            // Components of each element, including the columns of matrices, are packed
+            // back to back.
+            for (std::size_t j{0}; j < values.size(); ++j)
+            {
+                auto offset = entry.offset + (j / components) * entry.stride
+                              + (j % components) * 4;
+                write_value(block.data() + offset,
+                            parameter.type,
+                            values[j],
+                            parameter.name);
+            }
+        }
+
+        material.parameter_layout = schema.layout;
+        material.parameters       = std::move(parameters);
+        material.parameter_block  = std::move(block);
+    }
+
+    bool is_valid_material(std::string const& filename)
+    {
+        return fs::path{filename}.extension() == ".material";
+    }
+
+    assets::AssetFile konvert_material(std::string const& filename,
+                                       MaterialOptions const& options)
+    {
+        std::ifstream stream{filename};
+        if (!stream)
+        {
+            auto msg = fmt::format("error: unable to open file {}", filename);
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        auto json = nlohmann::json::parse(stream);
+
+        assets::MaterialAsset material;
+        auto base_effect     = json["base_effect"].get<std::string>();
+        material.base_effect = material.strings.intern(base_effect);
+
+        auto transparency = json.value("transparency", std::string{"opaque"});
+        auto mode         = magic_enum::enum_cast<assets::TransparencyMode>(transparency);
+        if (!mode)
+        {
+            auto msg = fmt::format("error: unknown transparency mode {}", transparency);
+            throw std::runtime_error{msg.c_str()};
+        }
+        material.transparency = *mode;
+
+        if (json.contains("textures"))
+        {
+            for (auto& [slot, path] : json["textures"].items())
+            {
+                auto value = property_string(path);
+                material.textures.insert(
+                    {material.strings.intern(slot), material.strings.intern(value)});
+            }
+        }
+
+        PropertyMap properties;
+        if (json.contains("custom_properties"))
+        {
+            for (auto& [name, value] : json["custom_properties"].items())
+            {
+                properties.insert({name, property_string(value)});
+            }
+        }
+
+        auto schemas = options.schema_table;
+        if (!schemas && !options.schemas.empty())
+        {
+            schemas = std::make_shared<MaterialSchemas const>(
+                load_material_schemas(options.schemas));
+        }
+
+        if (schemas)
+        {
+            if (auto it = schemas->find(base_effect); it != schemas->end())
+            {
+                compile_material(material, it->second, properties);
+            }
+        }
+
+        for (auto& [name, value] : properties)
+        {
+            material.custom_properties.insert(
+                {material.strings.intern(name), material.strings.intern(value)});
+        }
+
+        return material.pack();
+    }
+} // namespace kass
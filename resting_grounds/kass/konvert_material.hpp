@@ -0,0 +1,59 @@
+#pragma once
+
+#include <assets/asset_file.hpp>
+#include <assets/material_asset.hpp>
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace kass
+{
+    struct SchemaParameter
+    {
+        std::string name;
+        assets::ParameterType type{assets::ParameterType::float1};
+        std::uint32_t count{1};
+        // Used when a material doesn't set the property, all zeroes if empty.
+        std::vector<double> default_value;
+    };
+
+    // Parameters are laid out in the order they are listed, which should match the
+    // declaration order of the block in the shaders of the effect.
+    struct MaterialSchema
+    {
+        assets::BlockLayout layout{assets::BlockLayout::std140};
+        std::vector<SchemaParameter> parameters;
+    };
+
+    using MaterialSchemas = std::unordered_map<std::string, MaterialSchema>;
+    using PropertyMap     = std::unordered_map<std::string, std::string>;
+
+    struct MaterialOptions
+    {
+        // JSON file with the parameter schema of each base effect. Materials of effects
+        // without a schema keep their custom properties as strings.
+        std::filesystem::path schemas;
+        // The parsed schemas file, shared by every material of a run. It is loaded from
+        // schemas on each conversion when left empty.
+        std::shared_ptr<MaterialSchemas const> schema_table;
+    };
+
+    MaterialSchemas load_material_schemas(std::filesystem::path const& filename);
+
+    // Packs the properties listed by the schema into the parameter block of a material,
+    // removing them from properties. Values are lists of numbers or booleans separated
+    // by spaces or commas.
+    void compile_material(assets::MaterialAsset& material,
+                          MaterialSchema const& schema,
+                          PropertyMap& properties);
+
+    bool is_valid_material(std::string const& filename);
+
+    // Converts a material description, a JSON file laid out like the output of
+    // MaterialAsset::to_json().
+    assets::AssetFile konvert_material(std::string const& filename,
+                                       MaterialOptions const& options);
+} // namespace kass
@@ -0,0 +1,488 @@
+#include "konvert_mesh.hpp"
+#include "optimise_mesh.hpp"
+#include "simplify_mesh.hpp"
+
+#include <assets/mesh_asset.hpp>
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <fmt/printf.h>
+#include <nlohmann/json.hpp>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace fs = std::filesystem;
+
+namespace kass
+{
+    namespace
+    {
+        using assets::MeshAsset;
+        using assets::Vertex;
+
+        using assets::MeshFilter;
+
+        struct MeshData
+        {
+            std::vector<Vertex> vertices;
+            std::vector<std::uint32_t> indices;
+        };
+
+        MeshData read_mesh(aiMesh const& mesh)
+        {
+            MeshData data;
+            data.vertices.resize(mesh.mNumVertices);
+            for (unsigned int i{0}; i < mesh.mNumVertices; ++i)
+            {
+                // Missing attributes are left zeroed, except for the colour which
+                // defaults to white.
+                Vertex vertex{};
+                auto const& p   = mesh.mVertices[i];
+                vertex.position = {p.x, p.y, p.z};
+                vertex.colour   = {1.0f, 1.0f, 1.0f};
+
+                if (mesh.HasNormals())
+                {
+                    auto const& n = mesh.mNormals[i];
+                    vertex.normal = {n.x, n.y, n.z};
+                }
+
+                if (mesh.HasVertexColors(0))
+                {
+                    auto const& c = mesh.mColors[0][i];
+                    vertex.colour = {c.r, c.g, c.b};
+                }
+
+                if (mesh.HasTextureCoords(0))
+                {
+                    auto const& uv = mesh.mTextureCoords[0][i];
+                    vertex.uv      = {uv.x, uv.y};
+                }
+
+                if (mesh.HasTangentsAndBitangents())
+                {
+                    auto const& t    = mesh.mTangents[i];
+                    auto const& b    = mesh.mBitangents[i];
+                    vertex.tangent   = {t.x, t.y, t.z};
+                    vertex.bitangent = {b.x, b.y, b.z};
+                }
+
+                data.vertices[i] = vertex;
+            }
+
+            data.indices.reserve(mesh.mNumFaces * 3);
+            for (unsigned int i{0}; i < mesh.mNumFaces; ++i)
+            {
+                auto const& face = mesh.mFaces[i];
+                if (face.mNumIndices == 3)
+                {
+                    data.indices.insert(data.indices.end(),
+                                        face.mIndices,
+                                        face.mIndices + 3);
+                }
+            }
+
+            return data;
+        }
+
+        template<typename T>
+        std::vector<std::byte> to_bytes(std::vector<T> const& values)
+        {
+            std::vector<std::byte> bytes(values.size() * sizeof(T));
+            std::memcpy(bytes.data(), values.data(), bytes.size());
+            return bytes;
+        }
+
+        std::vector<std::byte> to_index_bytes(std::vector<std::uint32_t> const& indices,
+                                              std::uint8_t index_size)
+        {
+            if (index_size == sizeof(std::uint32_t))
+            {
+                return to_bytes(indices);
+            }
+
+            std::vector<std::uint16_t> narrow(indices.begin(), indices.end());
+            return to_bytes(narrow);
+        }
+
+        std::uint8_t select_index_size(std::size_t vertex_count)
+        {
+            return (vertex_count <= std::numeric_limits<std::uint16_t>::max() + 1)
+                       ? sizeof(std::uint16_t)
+                       : sizeof(std::uint32_t);
+        }
+
+        std::size_t packed_size(std::vector<std::byte> const& vertex_bytes,
+                                MeshData const& data,
+                                assets::VertexFormat format,
+                                MeshFilter filter,
+                                assets::ChunkCodec codec)
+        {
+            MeshAsset mesh{};
+            mesh.vertex_format = format;
+            mesh.index_size    = select_index_size(data.vertices.size());
+            mesh.filter        = filter;
+            mesh.codec         = codec;
+
+            auto file =
+                mesh.pack(vertex_bytes, to_index_bytes(data.indices, mesh.index_size));
+            return file.binary_blob.size();
+        }
+
+        void append_meshlets(MeshAsset::MeshletBuffers& buffers,
+                             MeshAsset::MeshletBuffers const& mesh_buffers,
+                             std::uint32_t base_vertex)
+        {
+            auto vertex_offset   = static_cast<std::uint32_t>(buffers.vertices.size());
+            auto triangle_offset =
+                static_cast<std::uint32_t>(buffers.triangles.size() / 3);
+            for (auto meshlet : mesh_buffers.meshlets)
+            {
+                meshlet.vertex_offset += vertex_offset;
+                meshlet.triangle_offset += triangle_offset;
+                buffers.meshlets.push_back(meshlet);
+            }
+
+            for (auto vertex : mesh_buffers.vertices)
+            {
+                buffers.vertices.push_back(base_vertex + vertex);
+            }
+
+            buffers.triangles.insert(buffers.triangles.end(),
+                                     mesh_buffers.triangles.begin(),
+                                     mesh_buffers.triangles.end());
+        }
+
+        float distance(float a, float b)
+        {
+            return std::abs(a - b);
+        }
+
+        bool same_direction(assets::Vector3D<float> const& original,
+                            assets::Vector3D<float> const& decoded,
+                            float min_cos)
+        {
+            float length2 = original[0] * original[0] + original[1] * original[1]
+                            + original[2] * original[2];
+            if (length2 == 0.0f)
+            {
+                return true;
+            }
+
+            float cos = (original[0] * decoded[0] + original[1] * decoded[1]
+                         + original[2] * decoded[2])
+                        / std::sqrt(length2);
+            return cos >= min_cos;
+        }
+
+        // The bitangent isn't checked: quantised formats rebuild it from the normal and
+        // tangent, which is what tangent-space normal maps are baked against.
+        bool within_tolerance(std::span<Vertex const> original,
+                              std::span<Vertex const> decoded,
+                              float size,
+                              QuantisationTolerance const& tolerance)
+        {
+            float max_position = tolerance.position * size;
+            float min_cos      = std::cos(tolerance.direction);
+            for (std::size_t i{0}; i < original.size(); ++i)
+            {
+                auto const& a = original[i];
+                auto const& b = decoded[i];
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    if (distance(a.position[k], b.position[k]) > max_position
+                        || distance(a.colour[k], b.colour[k]) > tolerance.colour)
+                    {
+                        return false;
+                    }
+                }
+
+                if (distance(a.uv[0], b.uv[0]) > tolerance.uv
+                    || distance(a.uv[1], b.uv[1]) > tolerance.uv
+                    || !same_direction(a.normal, b.normal, min_cos)
+                    || !same_direction(a.tangent, b.tangent, min_cos))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // Each level is simplified from the full-detail indices so that its error is
+        // measured against the original surface, then given its own compact vertices.
+        std::vector<MeshAsset::LodBuffers> build_lods(MeshData const& data,
+                                                      MeshOptions const& options,
+                                                      assets::VertexFormat format,
+                                                      assets::BoundingBox const& box,
+                                                      std::uint8_t index_size)
+        {
+            std::vector<MeshAsset::LodBuffers> lods;
+
+            float target  = static_cast<float>(data.indices.size() / 3);
+            auto previous = data.indices.size();
+            for (std::size_t level{0}; level < options.lod_count; ++level)
+            {
+                target *= options.lod_ratio;
+                auto target_count = static_cast<std::size_t>(target) * 3;
+                if (target_count == 0)
+                {
+                    break;
+                }
+
+                auto indices = data.indices;
+                auto error   = simplify_mesh(data.vertices, indices, target_count);
+
+                // Levels that barely shrink aren't worth streaming.
+                if (indices.empty() || indices.size() * 10 > previous * 9)
+                {
+                    break;
+                }
+                previous = indices.size();
+
+                auto vertices = data.vertices;
+                optimise_vertex_cache(indices, vertices.size());
+                optimise_vertex_fetch(vertices, indices);
+
+                MeshAsset::LodBuffers lod;
+                lod.vertices = assets::encode_vertices(vertices, format, box);
+                lod.indices  = to_index_bytes(indices, index_size);
+                lod.error    = error;
+                lods.push_back(std::move(lod));
+            }
+
+            return lods;
+        }
+
+        MeshStats optimise(std::string name, MeshData& data, bool with_stats)
+        {
+            MeshStats stats;
+            stats.name = std::move(name);
+            if (with_stats)
+            {
+                stats.triangle_count     = data.indices.size() / 3;
+                stats.input_vertex_count = data.vertices.size();
+                stats.input_acmr         = compute_acmr(data.indices);
+                stats.input_atvr  = compute_atvr(data.indices, data.vertices.size());
+                stats.input_bytes = packed_size(to_bytes(data.vertices),
+                                                data,
+                                                assets::VertexFormat::f32_pncvtb,
+                                                MeshFilter::none,
+                                                {assets::Codec::lz4});
+            }
+
+            weld_vertices(data.vertices, data.indices);
+            optimise_vertex_cache(data.indices, data.vertices.size());
+            optimise_overdraw(data.indices, data.vertices);
+            optimise_vertex_fetch(data.vertices, data.indices);
+
+            if (with_stats)
+            {
+                stats.vertex_count = data.vertices.size();
+                stats.acmr         = compute_acmr(data.indices);
+                stats.atvr         = compute_atvr(data.indices, data.vertices.size());
+            }
+
+            return stats;
+        }
+    } // namespace
+
+    bool is_valid_mesh(std::string const& filename)
+    {
+        auto extension = fs::path{filename}.extension();
+        return extension == ".gltf" || extension == ".glb";
+    }
+
+    std::vector<fs::path> mesh_dependencies(std::string const& filename)
+    {
+        fs::path path{filename};
+        if (path.extension() != ".gltf")
+        {
+            return {};
+        }
+
+        std::vector<fs::path> dependencies;
+        try
+        {
+            std::ifstream stream{path};
+            auto gltf = nlohmann::json::parse(stream);
+
+            for (auto const* key : {"buffers", "images"})
+            {
+                if (!gltf.contains(key))
+                {
+                    continue;
+                }
+
+                for (auto const& entry : gltf[key])
+                {
+                    if (!entry.contains("uri"))
+                    {
+                        continue;
+                    }
+
+                    auto uri = entry["uri"].get<std::string>();
+                    if (uri.starts_with("data:"))
+                    {
+                        continue;
+                    }
+
+                    dependencies.push_back(path.parent_path() / uri);
+                }
+            }
+        }
+        catch (std::exception const&)
+        {
+            // Malformed files are reported by the importer when they are converted.
+            return {};
+        }
+
+        return dependencies;
+    }
+
+    assets::VertexFormat select_vertex_format(std::span<Vertex const> vertices,
+                                              assets::BoundingBox const& box,
+                                              MeshOptions const& options)
+    {
+        using assets::VertexFormat;
+
+        if (!options.quantise)
+        {
+            return VertexFormat::f32_pncvtb;
+        }
+
+        float size{0.0f};
+        for (std::size_t k{0}; k < 3; ++k)
+        {
+            size = std::max(size, box.max[k] - box.min[k]);
+        }
+
+        // Candidates are ordered from smallest to largest.
+        for (auto format : {VertexFormat::q16_pncvt_8_8,
+                            VertexFormat::q16_pncvt_16_8,
+                            VertexFormat::q16_pncvt_16_16})
+        {
+            auto encoded = assets::encode_vertices(vertices, format, box);
+            auto decoded = assets::decode_vertices(encoded, format, box);
+            if (within_tolerance(vertices, decoded, size, options.tolerance))
+            {
+                return format;
+            }
+        }
+
+        return VertexFormat::f32_pncvtb;
+    }
+
+    assets::AssetFile konvert_mesh(std::string const& filename,
+                                   MeshOptions const& options,
+                                   assets::ChunkCodec codec,
+                                   std::vector<MeshStats>* stats)
+    {
+        Assimp::Importer importer;
+
+        // Node transforms are baked into the vertices so that the whole scene can be
+        // flattened into one mesh.
+        auto scene = importer.ReadFile(filename,
+                                       aiProcess_Triangulate | aiProcess_SortByPType
+                                           | aiProcess_GenSmoothNormals
+                                           | aiProcess_CalcTangentSpace
+                                           | aiProcess_PreTransformVertices);
+        if (scene == nullptr || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) != 0)
+        {
+            auto msg = fmt::format("error: unable to import {}: {}",
+                                   filename,
+                                   importer.GetErrorString());
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        std::vector<MeshData> meshes;
+        MeshData merged;
+        MeshAsset::MeshletBuffers meshlets;
+        for (unsigned int i{0}; i < scene->mNumMeshes; ++i)
+        {
+            auto const& mesh = *scene->mMeshes[i];
+            if ((mesh.mPrimitiveTypes & aiPrimitiveType_TRIANGLE) == 0)
+            {
+                continue;
+            }
+
+            // Meshes are optimised on their own and then appended, so each one keeps
+            // its locality in the merged buffers.
+            auto data       = read_mesh(mesh);
+            auto mesh_stats = optimise(mesh.mName.C_Str(), data, stats != nullptr);
+
+            // Meshlets never straddle two meshes, which keeps their cones tight.
+            auto base          = static_cast<std::uint32_t>(merged.vertices.size());
+            auto mesh_meshlets = build_meshlets(data.vertices, data.indices);
+            append_meshlets(meshlets, mesh_meshlets, base);
+
+            if (stats != nullptr)
+            {
+                mesh_stats.meshlet_count = mesh_meshlets.meshlets.size();
+                stats->push_back(std::move(mesh_stats));
+            }
+
+            merged.vertices.insert(merged.vertices.end(),
+                                   data.vertices.begin(),
+                                   data.vertices.end());
+            for (auto index : data.indices)
+            {
+                merged.indices.push_back(base + index);
+            }
+
+            if (stats != nullptr)
+            {
+                meshes.push_back(std::move(data));
+            }
+        }
+
+        if (merged.indices.empty())
+        {
+            auto msg = fmt::format("error: {} contains no triangle meshes", filename);
+            throw std::runtime_error{msg.c_str()};
+        }
+
+        // Quantised positions are stored relative to the bounds, so they have to be
+        // known before the format is chosen.
+        auto bounds = MeshAsset::calculate_bounds(merged.vertices);
+        auto box    = bounds.box();
+        auto format = select_vertex_format(merged.vertices, box, options);
+
+        auto vertex_bytes = assets::encode_vertices(merged.vertices, format, box);
+        auto index_size   = select_index_size(merged.vertices.size());
+        auto index_bytes  = to_index_bytes(merged.indices, index_size);
+
+        if (stats != nullptr)
+        {
+            for (std::size_t i{0}; i < meshes.size(); ++i)
+            {
+                auto& mesh_stats         = (*stats)[stats->size() - meshes.size() + i];
+                mesh_stats.vertex_format = format;
+                mesh_stats.bytes         = packed_size(
+                    assets::encode_vertices(meshes[i].vertices, format, box),
+                    meshes[i],
+                    format,
+                    MeshFilter::mesh_codec,
+                    codec);
+            }
+        }
+
+        auto lods = build_lods(merged, options, format, box, index_size);
+
+        MeshAsset mesh;
+        mesh.vertex_buffer_size = vertex_bytes.size();
+        mesh.index_buffer_size  = index_bytes.size();
+        mesh.bounds             = bounds;
+        mesh.vertex_format      = format;
+        mesh.index_size         = index_size;
+        mesh.filter             = MeshFilter::mesh_codec;
+        mesh.codec              = codec;
+        mesh.original_file      = filename;
+
+        return mesh.pack(vertex_bytes, index_bytes, meshlets, lods);
+    }
+} // namespace kass
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <assets/asset_file.hpp>
+#include <assets/codec.hpp>
+#include <assets/vertex_format.hpp>
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace kass
+{
+    // Largest error a quantised vertex format may introduce before the mesh falls back
+    // to a larger format.
+    struct QuantisationTolerance
+    {
+        // Relative to the largest dimension of the mesh bounds.
+        float position{1.0f / 16384.0f};
+        // Angle in radians between the original and decoded normals and tangents.
+        float direction{0.01f};
+        float colour{1.0f / 255.0f};
+        float uv{1.0f / 2048.0f};
+    };
+
+    struct MeshOptions
+    {
+        // Pick the smallest quantised vertex format within tolerance instead of always
+        // storing 32-bit floats.
+        bool quantise{true};
+        QuantisationTolerance tolerance;
+
+        // Number of simplified levels generated below the full-detail mesh, each one
+        // aiming for lod_ratio of the triangles of the level above. The chain stops
+        // early once simplification stalls.
+        std::size_t lod_count{4};
+        float lod_ratio{0.5f};
+    };
+
+    // Before and after figures for one mesh going through the optimisation stage. Bytes
+    // are the size of the vertex and index data once packed, before in the imported
+    // layout with plain LZ4 and after in the chosen vertex format with the mesh filter
+    // and the chosen codec.
+    struct MeshStats
+    {
+        std::string name;
+        assets::VertexFormat vertex_format{assets::VertexFormat::f32_pncvtb};
+        std::size_t triangle_count{0};
+        std::size_t input_vertex_count{0};
+        std::size_t vertex_count{0};
+        std::size_t meshlet_count{0};
+        float input_acmr{0.0f};
+        float acmr{0.0f};
+        float input_atvr{0.0f};
+        float atvr{0.0f};
+        std::size_t input_bytes{0};
+        std::size_t bytes{0};
+    };
+
+    bool is_valid_mesh(std::string const& filename);
+
+    // Files referenced by a glTF (buffers and images) that affect its conversion.
+    std::vector<std::filesystem::path> mesh_dependencies(std::string const& filename);
+
+    // Returns the smallest format that reproduces every vertex within tolerance.
+    assets::VertexFormat select_vertex_format(std::span<assets::Vertex const> vertices,
+                                              assets::BoundingBox const& box,
+                                              MeshOptions const& options);
+
+    // Flattens every mesh in the scene into a single optimised MeshAsset.
+    assets::AssetFile konvert_mesh(std::string const& filename,
+                                   MeshOptions const& options,
+                                   assets::ChunkCodec codec,
+                                   std::vector<MeshStats>* stats = nullptr);
+} // namespace kass
@@ -1,31 +1,482 @@
 #include "konverter.hpp"
+#include "konvert_cache.hpp"
 #include "konvert_image.hpp"
+#include "konvert_manifest.hpp"
 
+#include <assets/asset_bundle.hpp>
+#include <assets/dependency_manifest.hpp>
 #include <core/io/file_output_stream.hpp>
 
 #include <fmt/printf.h>
+#include <magic_enum.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
 
 namespace fs = std::filesystem;
 
 namespace kass
 {
-    void konvert_file(fs::path const& file)
+    namespace
+    {
+        static constexpr auto no_bundle = std::numeric_limits<std::size_t>::max();
+
+        struct FileJob
+        {
+            fs::path input;
+            std::size_t bundle{no_bundle};
+            std::uintmax_t size{0};
+            std::uint64_t key{0};
+            std::optional<assets::AssetFile> asset;
+            KonvertResult result;
+        };
+
+        struct BundleJob
+        {
+            fs::path root;
+            fs::path output;
+            std::vector<std::size_t> files;
+            std::uint64_t key{0};
+            bool up_to_date{false};
+            KonvertResult result;
+        };
+
+        std::vector<fs::path> scan_directory(fs::path const& root)
+        {
+            std::vector<fs::path> files;
+            for (auto const& entry : fs::recursive_directory_iterator{root})
+            {
+                if (entry.is_regular_file())
+                {
+                    files.push_back(entry.path());
+                }
+            }
+            std::sort(files.begin(), files.end());
+
+            return files;
+        }
+
+        // Returns the converted asset, going through the cache when one is provided.
+        // The manifest is updated by the caller once the outputs are known.
+        std::optional<assets::AssetFile> konvert_cached(fs::path const& file,
+                                                        KonvertOptions const& options,
+                                                        KonvertCache* cache,
+                                                        std::uint64_t key,
+                                                        KonvertResult& result,
+                                                        assets::ThreadPool* pool)
+        {
+            if (cache != nullptr)
+            {
+                if (auto cached = cache->find(key); cached)
+                {
+                    result.status = KonvertStatus::cached;
+                    return cached;
+                }
+            }
+
+            auto c_file = konvert(file, options, &result.meshes, pool);
+            if (!c_file)
+            {
+                result.status = KonvertStatus::skipped;
+                return {};
+            }
+
+            if (cache != nullptr)
+            {
+                cache->store(key, *c_file);
+            }
+
+            result.status = KonvertStatus::converted;
+            return c_file;
+        }
+
+        template<typename Fn>
+        void run_job(KonvertResult& result, Fn&& fn)
+        {
+            try
+            {
+                fn();
+            }
+            catch (std::exception const& e)
+            {
+                result.status = KonvertStatus::failed;
+                result.error  = e.what();
+            }
+        }
+    } // namespace
+
+    std::string konvert_options(KonvertOptions const& options)
+    {
+#if defined(KASS_USE_NVTT)
+        std::string textures{"nvtt"};
+#else
+        std::string textures{"regular"};
+#endif
+
+        auto const& tolerance = options.mesh.tolerance;
+        auto const& texture   = options.texture;
+        return fmt::format("textures={};tiles={};mips={},{},{};blocks={},{},{};hdr={};"
+                           "materials={};codec={};quantise={};tolerance={},{},{},{};"
+                           "lods={},{}",
+                           textures,
+                           texture.tile_size,
+                           magic_enum::enum_name(texture.mips.filter),
+                           texture.mips.srgb,
+                           texture.mips.premultiply_alpha,
+                           texture.block_compress,
+                           magic_enum::enum_name(texture.quality),
+                           texture.format ? magic_enum::enum_name(*texture.format)
+                                          : "auto",
+                           texture.hdr_tolerance,
+                           options.material.schemas.generic_string(),
+                           assets::codec_name(options.codec),
+                           options.mesh.quantise,
+                           tolerance.position,
+                           tolerance.direction,
+                           tolerance.colour,
+                           tolerance.uv,
+                           options.mesh.lod_count,
+                           options.mesh.lod_ratio);
+    }
+
+    std::vector<fs::path> konvert_dependencies(fs::path const& file,
+                                               KonvertOptions const& options)
     {
-        if (file.extension() == ".gltf")
-        {}
+        if (is_valid_mesh(file.string()))
+        {
+            return mesh_dependencies(file.string());
+        }
+        else if (is_valid_material(file.string()) && !options.material.schemas.empty())
+        {
+            return {options.material.schemas};
+        }
+
+        return {};
+    }
+
+    std::optional<assets::AssetFile> konvert(fs::path const& file,
+                                             KonvertOptions const& options,
+                                             std::vector<MeshStats>* stats,
+                                             assets::ThreadPool* pool)
+    {
+        if (is_valid_mesh(file.string()))
+        {
+            return konvert_mesh(file.string(), options.mesh, options.codec, stats);
+        }
         else if (is_valid_image(file.string()))
         {
-            auto c_file = compress_image(file.string());
+            auto c_file =
+                compress_image(file.string(), options.texture, options.codec, pool);
+            if (c_file.metadata.empty())
+            {
+                throw std::runtime_error{"error: failed to convert image"};
+            }
 
-            auto out = file.parent_path();
-            out /= "image.kass";
-            core::io::FileOutputStream stream{out.string()};
-            c_file.save(stream);
+            return c_file;
+        }
+        else if (is_valid_material(file.string()))
+        {
+            return konvert_material(file.string(), options.material);
         }
+
+        return {};
     }
 
-    void konvert_files(std::filesystem::path const&, bool)
-    {}
+    KonvertResult konvert_file(fs::path const& file,
+                               KonvertOptions const& options,
+                               KonvertCache* cache,
+                               assets::ThreadPool* pool)
+    {
+        KonvertResult result;
+        result.input = file;
+
+        // Keep the source extension so a.png, a.jpg and a.gltf don't all land on a.kass.
+        auto out = file.parent_path() / (file.filename().string() + ".kass");
+
+        run_job(result, [&]() {
+            std::uint64_t key{0};
+            if (cache != nullptr)
+            {
+                key = cache->key(file, konvert_dependencies(file, options));
+                if (cache->is_up_to_date(file, key))
+                {
+                    result.status  = KonvertStatus::up_to_date;
+                    result.outputs = {out};
+                    return;
+                }
+            }
+
+            auto c_file = konvert_cached(file, options, cache, key, result, pool);
+            if (!c_file)
+            {
+                return;
+            }
+
+            {
+                core::io::FileOutputStream stream{out.string()};
+                c_file->save(stream);
+            }
+            result.outputs = {out};
+
+            if (cache != nullptr)
+            {
+                cache->record(file, key, result.outputs);
+            }
+        });
+
+        return result;
+    }
+
+    std::vector<KonvertResult> konvert_files(fs::path const& path,
+                                             KonvertOptions const& options,
+                                             KonvertCache* cache,
+                                             assets::ThreadPool& pool)
+    {
+        return konvert_inputs({path}, options, cache, pool);
+    }
+
+    std::vector<KonvertResult> konvert_inputs(std::vector<fs::path> const& inputs,
+                                              KonvertOptions const& options,
+                                              KonvertCache* cache,
+                                              assets::ThreadPool& pool)
+    {
+        // Build the job list. Loose files and --split directories become one job per
+        // file, otherwise each directory becomes a bundle fed by one job per file.
+        std::vector<FileJob> files;
+        std::vector<BundleJob> bundles;
+        for (auto const& input : inputs)
+        {
+            if (!fs::is_directory(input))
+            {
+                FileJob job;
+                job.input = input;
+                files.push_back(std::move(job));
+                continue;
+            }
+
+            auto root = input.has_filename() ? input : input.parent_path();
+
+            std::size_t bundle{no_bundle};
+            if (!options.split)
+            {
+                bundle = bundles.size();
+
+                BundleJob job;
+                job.root         = root;
+                job.result.input = root;
+                job.output = root.parent_path() / (root.filename().string() + ".kbdl");
+                bundles.push_back(std::move(job));
+            }
+
+            for (auto& file : scan_directory(root))
+            {
+                if (bundle != no_bundle)
+                {
+                    bundles[bundle].files.push_back(files.size());
+                }
+
+                FileJob job;
+                job.input  = std::move(file);
+                job.bundle = bundle;
+                files.push_back(std::move(job));
+            }
+        }
+
+        // Start the largest inputs first so a single huge texture doesn't end up as the
+        // tail of the run.
+        for (auto& job : files)
+        {
+            job.result.input = job.input;
+
+            std::error_code ec;
+            job.size = fs::file_size(job.input, ec);
+        }
+
+        std::vector<std::size_t> order(files.size());
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return files[a].size > files[b].size;
+        });
+
+        // Loose files are converted outright, bundled files are only hashed for now.
+        pool.parallel_for(order.size(), [&](std::size_t i) {
+            auto& job = files[order[i]];
+            if (job.bundle == no_bundle)
+            {
+                job.result = konvert_file(job.input, options, cache, &pool);
+            }
+            else if (cache != nullptr)
+            {
+                run_job(job.result, [&]() {
+                    job.key = cache->key(job.input,
+                                         konvert_dependencies(job.input, options));
+                });
+            }
+        });
+
+        // The first member of a bundle that failed to convert, or to be hashed.
+        auto failed_member = [&files](BundleJob const& bundle) -> FileJob const* {
+            for (auto i : bundle.files)
+            {
+                if (files[i].result.status == KonvertStatus::failed)
+                {
+                    return &files[i];
+                }
+            }
+
+            return nullptr;
+        };
+
+        // A bundle is keyed on the names and keys of everything in its directory, so
+        // adding, removing or editing any file invalidates it. Bundles with a member
+        // that couldn't be hashed are never up to date.
+        for (auto& bundle : bundles)
+        {
+            if (cache == nullptr || failed_member(bundle) != nullptr)
+            {
+                continue;
+            }
+
+            std::string listing;
+            for (auto i : bundle.files)
+            {
+                listing += fmt::format("{}:{:016x};",
+                                       fs::relative(files[i].input, bundle.root)
+                                           .generic_string(),
+                                       files[i].key);
+            }
+
+            bundle.key        = hash_bytes(std::as_bytes(std::span{listing}));
+            bundle.up_to_date = cache->is_up_to_date(bundle.root, bundle.key);
+        }
+
+        std::vector<std::size_t> pending;
+        for (auto i : order)
+        {
+            auto& job = files[i];
+            if (job.bundle == no_bundle || job.result.status == KonvertStatus::failed)
+            {
+                continue;
+            }
+
+            if (bundles[job.bundle].up_to_date)
+            {
+                job.result.status  = KonvertStatus::up_to_date;
+                job.result.outputs = {bundles[job.bundle].output};
+                continue;
+            }
+
+            pending.push_back(i);
+        }
+
+        pool.parallel_for(pending.size(), [&](std::size_t i) {
+            auto& job = files[pending[i]];
+            run_job(job.result, [&]() {
+                job.asset = konvert_cached(job.input,
+                                           options,
+                                           cache,
+                                           job.key,
+                                           job.result,
+                                           &pool);
+            });
+        });
+
+        pool.parallel_for(bundles.size(), [&](std::size_t b) {
+            auto& bundle = bundles[b];
+            if (bundle.up_to_date)
+            {
+                bundle.result.status  = KonvertStatus::up_to_date;
+                bundle.result.outputs = {bundle.output};
+                return;
+            }
+
+            run_job(bundle.result, [&]() {
+                // Writing the bundle without a member would record it as up to date and
+                // hide the failure until one of its files changes.
+                if (auto failed = failed_member(bundle); failed != nullptr)
+                {
+                    auto msg = fmt::format("error: bundle member {} failed to convert",
+                                           failed->input.string());
+                    throw std::runtime_error{msg.c_str()};
+                }
+
+                // The manifest is built from the assets before they move into the writer.
+                std::vector<std::size_t> added;
+                std::vector<BundledAsset> bundled;
+                for (auto i : bundle.files)
+                {
+                    if (files[i].asset)
+                    {
+                        auto name =
+                            fs::relative(files[i].input, bundle.root).generic_string();
+                        added.push_back(i);
+                        bundled.push_back({std::move(name), &*files[i].asset});
+                    }
+                }
+                auto manifest = konvert_manifest(bundled);
+
+                assets::AssetBundleWriter writer{options.codec};
+                for (std::size_t j{0}; j < added.size(); ++j)
+                {
+                    auto& job = files[added[j]];
+                    writer.add(bundled[j].name, std::move(*job.asset));
+                    job.result.outputs = {bundle.output};
+                }
+
+                if (manifest)
+                {
+                    writer.add(assets::DependencyManifest::bundle_entry_name,
+                               std::move(*manifest));
+                }
+
+                if (writer.size() == 0)
+                {
+                    bundle.result.status = KonvertStatus::skipped;
+                    return;
+                }
+
+                {
+                    core::io::FileOutputStream stream{bundle.output.string()};
+                    writer.save(stream);
+                }
+
+                bundle.result.status  = KonvertStatus::converted;
+                bundle.result.outputs = {bundle.output};
+
+                if (cache != nullptr)
+                {
+                    for (auto i : bundle.files)
+                    {
+                        if (!files[i].result.outputs.empty())
+                        {
+                            cache->record(files[i].input, files[i].key, {bundle.output});
+                        }
+                    }
+                    cache->record(bundle.root, bundle.key, {bundle.output});
+                }
+            });
+        });
+
+        std::vector<KonvertResult> results;
+        results.reserve(files.size() + bundles.size());
+        for (auto& job : files)
+        {
+            results.push_back(std::move(job.result));
+        }
+
+        for (auto& bundle : bundles)
+        {
+            results.push_back(std::move(bundle.result));
+        }
+
+        std::stable_sort(results.begin(),
+                         results.end(),
+                         [](KonvertResult const& a, KonvertResult const& b) {
+                             return a.input < b.input;
+                         });
+        return results;
+    }
 } // namespace kass
 
 namespace detail
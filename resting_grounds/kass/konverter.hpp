@@ -1,9 +1,89 @@
 #pragma once
 
+#include "konvert_image.hpp"
+#include "konvert_material.hpp"
+#include "konvert_mesh.hpp"
+
+#include <assets/asset_file.hpp>
+#include <assets/codec.hpp>
+#include <assets/thread_pool.hpp>
+
 #include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace kass
 {
-    void konvert_file(std::filesystem::path const& file);
-    void konvert_files(std::filesystem::path const& path, bool split);
+    class KonvertCache;
+
+    // Bump whenever a change to the converters alters their output, so that cached
+    // conversions from older builds are not reused.
+    static constexpr std::uint32_t converter_version{13};
+
+    enum class KonvertStatus
+    {
+        converted,
+        cached,
+        up_to_date,
+        skipped,
+        failed
+    };
+
+    struct KonvertResult
+    {
+        std::filesystem::path input;
+        std::vector<std::filesystem::path> outputs;
+        KonvertStatus status{KonvertStatus::skipped};
+        std::string error;
+
+        // Only filled in for meshes that were converted on this run.
+        std::vector<MeshStats> meshes;
+    };
+
+    struct KonvertOptions
+    {
+        // Convert the files in input directories individually instead of bundling
+        // each directory.
+        bool split{false};
+        // Codec every chunk of every asset is compressed with. Slower codecs and higher
+        // levels only cost packing time, decoding stays fast.
+        assets::ChunkCodec codec;
+        MeshOptions mesh;
+        TextureOptions texture;
+        MaterialOptions material;
+    };
+
+    // Describes every build-time and run-time option that affects converter output.
+    std::string konvert_options(KonvertOptions const& options);
+
+    // Source files besides the input itself whose contents affect its conversion.
+    std::vector<std::filesystem::path>
+    konvert_dependencies(std::filesystem::path const& file,
+                         KonvertOptions const& options);
+
+    // Returns an empty optional for unsupported files, throws if conversion fails.
+    // Work within a single file, like encoding texture blocks, is spread over the pool
+    // when one is given.
+    std::optional<assets::AssetFile> konvert(std::filesystem::path const& file,
+                                             KonvertOptions const& options,
+                                             std::vector<MeshStats>* stats = nullptr,
+                                             assets::ThreadPool* pool = nullptr);
+
+    KonvertResult konvert_file(std::filesystem::path const& file,
+                               KonvertOptions const& options,
+                               KonvertCache* cache = nullptr,
+                               assets::ThreadPool* pool = nullptr);
+    std::vector<KonvertResult> konvert_files(std::filesystem::path const& path,
+                                             KonvertOptions const& options,
+                                             KonvertCache* cache,
+                                             assets::ThreadPool& pool);
+
+    // Expands directories recursively and converts everything on the pool. Results are
+    // returned sorted by input path regardless of the order in which jobs finished.
+    std::vector<KonvertResult>
+    konvert_inputs(std::vector<std::filesystem::path> const& inputs,
+                   KonvertOptions const& options,
+                   KonvertCache* cache,
+                   assets::ThreadPool& pool);
 } // namespace kass
@@ -0,0 +1,698 @@
+#include "optimise_mesh.hpp"
+#include "konvert_cache.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace kass
+{
+    namespace
+    {
+        using assets::Vector3D;
+        using assets::Vertex;
+
+        static constexpr auto invalid_index = std::numeric_limits<std::uint32_t>::max();
+
+        // FIFO cache simulated with timestamps: a vertex is resident if fewer than
+        // cache_size other vertices were inserted after it.
+        class FifoCache
+        {
+        public:
+            FifoCache(std::size_t vertex_count, std::size_t cache_size) :
+                m_timestamps(vertex_count, 0),
+                m_time{cache_size + 1},
+                m_cache_size{cache_size}
+            {}
+
+            // Returns true on a miss.
+            bool access(std::uint32_t vertex)
+            {
+                if (m_time - m_timestamps[vertex] > m_cache_size)
+                {
+                    m_timestamps[vertex] = m_time++;
+                    return true;
+                }
+
+                return false;
+            }
+
+            void reset()
+            {
+                m_time += m_cache_size + 1;
+            }
+
+        private:
+            std::vector<std::size_t> m_timestamps;
+            std::size_t m_time;
+            std::size_t m_cache_size;
+        };
+
+        std::size_t count_vertices(std::span<std::uint32_t const> indices)
+        {
+            if (indices.empty())
+            {
+                return 0;
+            }
+
+            return *std::max_element(indices.begin(), indices.end()) + std::size_t{1};
+        }
+
+        std::size_t count_misses(std::span<std::uint32_t const> indices,
+                                 std::size_t vertex_count,
+                                 std::size_t cache_size)
+        {
+            FifoCache cache{vertex_count, cache_size};
+            std::size_t misses{0};
+            for (auto index : indices)
+            {
+                misses += cache.access(index) ? 1 : 0;
+            }
+
+            return misses;
+        }
+
+        // Scoring from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+        static constexpr std::size_t forsyth_cache_size{32};
+        static constexpr std::size_t forsyth_max_valence{64};
+
+        struct ForsythScores
+        {
+            ForsythScores()
+            {
+                for (std::size_t i{0}; i < forsyth_cache_size; ++i)
+                {
+                    // The vertices of the last triangle get a fixed score so that the
+                    // next triangle isn't biased towards continuing a strip.
+                    float scale = 1.0f / (forsyth_cache_size - 3);
+                    cache[i] =
+                        (i < 3) ? 0.75f : std::pow(1.0f - (i - 3) * scale, 1.5f);
+                }
+
+                // Vertices with few triangles left are boosted so they are finished off
+                // instead of being left behind as isolated triangles.
+                valence[0] = 0.0f;
+                for (std::size_t i{1}; i < forsyth_max_valence; ++i)
+                {
+                    valence[i] = 2.0f / std::sqrt(static_cast<float>(i));
+                }
+            }
+
+            float operator()(int cache_position, std::uint32_t remaining) const
+            {
+                if (remaining == 0)
+                {
+                    return -1.0f;
+                }
+
+                float score =
+                    valence[std::min<std::size_t>(remaining, forsyth_max_valence - 1)];
+                if (cache_position >= 0)
+                {
+                    score += cache[cache_position];
+                }
+
+                return score;
+            }
+
+            std::array<float, forsyth_cache_size> cache;
+            std::array<float, forsyth_max_valence> valence;
+        };
+
+        // Triangle lists per vertex in CSR form. Emitted triangles are swapped to the
+        // end of each list so that only the first count[v] entries are live.
+        struct VertexAdjacency
+        {
+            VertexAdjacency(std::span<std::uint32_t const> indices,
+                            std::size_t vertex_count) :
+                offsets(vertex_count + 1, 0),
+                counts(vertex_count, 0),
+                triangles(indices.size())
+            {
+                for (auto index : indices)
+                {
+                    ++counts[index];
+                }
+
+                for (std::size_t v{0}; v < vertex_count; ++v)
+                {
+                    offsets[v + 1] = offsets[v] + counts[v];
+                }
+
+                std::vector<std::uint32_t> fill(vertex_count, 0);
+                for (std::size_t i{0}; i < indices.size(); ++i)
+                {
+                    auto v                             = indices[i];
+                    triangles[offsets[v] + fill[v]++] = static_cast<std::uint32_t>(i / 3);
+                }
+            }
+
+            std::span<std::uint32_t> live(std::uint32_t vertex)
+            {
+                return {triangles.data() + offsets[vertex], counts[vertex]};
+            }
+
+            void remove(std::uint32_t vertex, std::uint32_t triangle)
+            {
+                auto list = live(vertex);
+                auto it   = std::find(list.begin(), list.end(), triangle);
+                std::iter_swap(it, list.end() - 1);
+                --counts[vertex];
+            }
+
+            std::vector<std::size_t> offsets;
+            std::vector<std::uint32_t> counts;
+            std::vector<std::uint32_t> triangles;
+        };
+
+        Vector3D<float> subtract(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+        }
+
+        Vector3D<float> cross(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return {a[1] * b[2] - a[2] * b[1],
+                    a[2] * b[0] - a[0] * b[2],
+                    a[0] * b[1] - a[1] * b[0]};
+        }
+
+        float dot(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        // Splits the triangle list into clusters that can be reordered without hurting
+        // the vertex cache much. Hard boundaries sit where the cache is fully cold
+        // anyway, soft ones where the cluster so far is already within the threshold.
+        std::vector<std::size_t> find_clusters(std::span<std::uint32_t const> indices,
+                                               std::size_t vertex_count,
+                                               float threshold)
+        {
+            auto triangle_count = indices.size() / 3;
+
+            std::vector<std::size_t> hard;
+            FifoCache cache{vertex_count, vertex_cache_size};
+            for (std::size_t t{0}; t < triangle_count; ++t)
+            {
+                int misses{0};
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    misses += cache.access(indices[t * 3 + k]) ? 1 : 0;
+                }
+
+                if (t == 0 || misses == 3)
+                {
+                    hard.push_back(t);
+                }
+            }
+            hard.push_back(triangle_count);
+
+            std::vector<std::size_t> clusters;
+            for (std::size_t c{0}; c + 1 < hard.size(); ++c)
+            {
+                auto start = hard[c];
+                auto end   = hard[c + 1];
+
+                auto cluster = indices.subspan(start * 3, (end - start) * 3);
+                auto limit   = threshold
+                             * count_misses(cluster, vertex_count, vertex_cache_size)
+                             / static_cast<float>(end - start);
+
+                clusters.push_back(start);
+
+                cache.reset();
+                std::size_t misses{0};
+                std::size_t first{start};
+                for (std::size_t t{start}; t + 1 < end; ++t)
+                {
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        misses += cache.access(indices[t * 3 + k]) ? 1 : 0;
+                    }
+
+                    if (misses <= limit * (t + 1 - first))
+                    {
+                        clusters.push_back(t + 1);
+                        cache.reset();
+                        misses = 0;
+                        first  = t + 1;
+                    }
+                }
+            }
+            clusters.push_back(triangle_count);
+
+            return clusters;
+        }
+
+        // Fills in the bounding sphere and normal cone of a finished meshlet. Wide cones
+        // (more than about 84 degrees either side of the axis) can't cull anything, so
+        // their cutoff is left at 1.
+        void compute_meshlet_bounds(assets::MeshAsset::Meshlet& meshlet,
+                                    std::span<Vertex const> vertices,
+                                    std::span<std::uint32_t const> meshlet_vertices,
+                                    std::span<std::uint8_t const> meshlet_triangles)
+        {
+            std::vector<Vector3D<float>> positions(meshlet.vertex_count);
+            for (std::size_t i{0}; i < positions.size(); ++i)
+            {
+                positions[i] = vertices[meshlet_vertices[i]].position;
+            }
+
+            auto sphere = assets::compute_bounding_sphere(
+                std::as_bytes(std::span{positions}),
+                sizeof(Vector3D<float>));
+            meshlet.centre = sphere.centre;
+            meshlet.radius = sphere.radius;
+
+            std::vector<Vector3D<float>> normals;
+            normals.reserve(meshlet.triangle_count);
+            Vector3D<float> axis{0.0f, 0.0f, 0.0f};
+            for (std::size_t t{0}; t < meshlet.triangle_count; ++t)
+            {
+                auto const& p0 = positions[meshlet_triangles[t * 3 + 0]];
+                auto const& p1 = positions[meshlet_triangles[t * 3 + 1]];
+                auto const& p2 = positions[meshlet_triangles[t * 3 + 2]];
+
+                auto normal = cross(subtract(p1, p0), subtract(p2, p0));
+                auto length = std::sqrt(dot(normal, normal));
+                if (length == 0.0f)
+                {
+                    continue;
+                }
+
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    normal[k] /= length;
+                    axis[k] += normal[k];
+                }
+                normals.push_back(normal);
+            }
+
+            meshlet.cone_axis   = {0.0f, 0.0f, 0.0f};
+            meshlet.cone_cutoff = 1.0f;
+
+            auto length = std::sqrt(dot(axis, axis));
+            if (normals.empty() || length == 0.0f)
+            {
+                return;
+            }
+
+            for (auto& value : axis)
+            {
+                value /= length;
+            }
+            meshlet.cone_axis = axis;
+
+            float min_dot{1.0f};
+            for (auto const& normal : normals)
+            {
+                min_dot = std::min(min_dot, dot(axis, normal));
+            }
+
+            if (min_dot > 0.1f)
+            {
+                // The sine of the cone's half angle.
+                meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+            }
+        }
+    } // namespace
+
+    float compute_acmr(std::span<std::uint32_t const> indices, std::size_t cache_size)
+    {
+        if (indices.empty())
+        {
+            return 0.0f;
+        }
+
+        auto misses = count_misses(indices, count_vertices(indices), cache_size);
+        return misses / static_cast<float>(indices.size() / 3);
+    }
+
+    float compute_atvr(std::span<std::uint32_t const> indices,
+                       std::size_t vertex_count,
+                       std::size_t cache_size)
+    {
+        if (indices.empty() || vertex_count == 0)
+        {
+            return 0.0f;
+        }
+
+        auto misses = count_misses(indices, count_vertices(indices), cache_size);
+        return misses / static_cast<float>(vertex_count);
+    }
+
+    void weld_vertices(std::vector<Vertex>& vertices, std::span<std::uint32_t> indices)
+    {
+        // Open-addressed table of unique vertex indices, sized to stay under half full.
+        auto table_size = std::bit_ceil(std::max<std::size_t>(vertices.size() * 2, 16));
+        std::vector<std::uint32_t> table(table_size, invalid_index);
+        auto mask = table_size - 1;
+
+        std::vector<std::uint32_t> remap(vertices.size());
+        std::uint32_t unique{0};
+        for (std::size_t i{0}; i < vertices.size(); ++i)
+        {
+            auto bytes = std::as_bytes(std::span{&vertices[i], 1});
+            auto slot  = hash_bytes(bytes) & mask;
+            for (;; slot = (slot + 1) & mask)
+            {
+                if (table[slot] == invalid_index)
+                {
+                    // Unique vertices are compacted in place; the write never overtakes
+                    // the read.
+                    table[slot]      = unique;
+                    vertices[unique] = vertices[i];
+                    remap[i]         = unique++;
+                    break;
+                }
+
+                auto const& candidate = vertices[table[slot]];
+                if (std::memcmp(&candidate, &vertices[i], sizeof(Vertex)) == 0)
+                {
+                    remap[i] = table[slot];
+                    break;
+                }
+            }
+        }
+
+        vertices.resize(unique);
+        for (auto& index : indices)
+        {
+            index = remap[index];
+        }
+    }
+
+    void optimise_vertex_cache(std::span<std::uint32_t> indices,
+                               std::size_t vertex_count)
+    {
+        auto triangle_count = indices.size() / 3;
+        if (triangle_count == 0)
+        {
+            return;
+        }
+
+        static ForsythScores const score;
+
+        VertexAdjacency adjacency{indices, vertex_count};
+        std::vector<int> cache_position(vertex_count, -1);
+        std::vector<float> vertex_score(vertex_count);
+        for (std::uint32_t v{0}; v < vertex_count; ++v)
+        {
+            vertex_score[v] = score(-1, adjacency.counts[v]);
+        }
+
+        std::vector<float> triangle_score(triangle_count);
+        std::vector<bool> emitted(triangle_count, false);
+        std::size_t best{0};
+        for (std::size_t t{0}; t < triangle_count; ++t)
+        {
+            triangle_score[t] = vertex_score[indices[t * 3]]
+                                + vertex_score[indices[t * 3 + 1]]
+                                + vertex_score[indices[t * 3 + 2]];
+            if (triangle_score[t] > triangle_score[best])
+            {
+                best = t;
+            }
+        }
+
+        std::vector<std::uint32_t> output;
+        output.reserve(indices.size());
+
+        std::vector<std::uint32_t> cache;
+        std::vector<std::uint32_t> next_cache;
+        cache.reserve(forsyth_cache_size + 3);
+        next_cache.reserve(forsyth_cache_size + 3);
+
+        std::size_t cursor{0};
+        for (std::size_t emitted_count{0}; emitted_count < triangle_count;
+             ++emitted_count)
+        {
+            std::array<std::uint32_t, 3> triangle{
+                indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2]};
+
+            emitted[best] = true;
+            output.insert(output.end(), triangle.begin(), triangle.end());
+            for (auto v : triangle)
+            {
+                adjacency.remove(v, static_cast<std::uint32_t>(best));
+            }
+
+            // The emitted vertices move to the front of the LRU cache.
+            next_cache.assign(triangle.begin(), triangle.end());
+            for (auto v : cache)
+            {
+                if (std::find(triangle.begin(), triangle.end(), v) == triangle.end())
+                {
+                    next_cache.push_back(v);
+                }
+            }
+            std::swap(cache, next_cache);
+
+            for (std::size_t i{0}; i < cache.size(); ++i)
+            {
+                auto v            = cache[i];
+                cache_position[v] = (i < forsyth_cache_size) ? static_cast<int>(i) : -1;
+                vertex_score[v]   = score(cache_position[v], adjacency.counts[v]);
+            }
+
+            // Only triangles touching the cache changed score, so the next one is picked
+            // from among them.
+            float best_score{-1.0f};
+            for (auto v : cache)
+            {
+                for (auto t : adjacency.live(v))
+                {
+                    triangle_score[t] = vertex_score[indices[t * 3]]
+                                        + vertex_score[indices[t * 3 + 1]]
+                                        + vertex_score[indices[t * 3 + 2]];
+                    if (triangle_score[t] > best_score)
+                    {
+                        best_score = triangle_score[t];
+                        best       = t;
+                    }
+                }
+            }
+
+            cache.resize(std::min(cache.size(), forsyth_cache_size));
+
+            if (best_score < 0.0f)
+            {
+                // Dead end: restart from the next triangle in input order.
+                while (cursor < triangle_count && emitted[cursor])
+                {
+                    ++cursor;
+                }
+                best = cursor;
+            }
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void optimise_overdraw(std::span<std::uint32_t> indices,
+                           std::span<Vertex const> vertices,
+                           float threshold)
+    {
+        auto triangle_count = indices.size() / 3;
+        if (triangle_count == 0)
+        {
+            return;
+        }
+
+        auto clusters      = find_clusters(indices, vertices.size(), threshold);
+        auto cluster_count = clusters.size() - 1;
+
+        struct Cluster
+        {
+            Vector3D<float> centroid{};
+            Vector3D<float> normal{};
+            float area{0.0f};
+            float sort_key{0.0f};
+        };
+
+        // Area-weighted centroid and normal of every cluster and of the whole mesh.
+        std::vector<Cluster> info(cluster_count);
+        Vector3D<float> mesh_centroid{};
+        float mesh_area{0.0f};
+        for (std::size_t c{0}; c < cluster_count; ++c)
+        {
+            auto& cluster = info[c];
+            for (auto t = clusters[c]; t < clusters[c + 1]; ++t)
+            {
+                auto const& p0 = vertices[indices[t * 3]].position;
+                auto const& p1 = vertices[indices[t * 3 + 1]].position;
+                auto const& p2 = vertices[indices[t * 3 + 2]].position;
+
+                auto normal = cross(subtract(p1, p0), subtract(p2, p0));
+                auto area   = std::sqrt(dot(normal, normal));
+                for (std::size_t k{0}; k < 3; ++k)
+                {
+                    cluster.centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+                    cluster.normal[k] += normal[k];
+                }
+                cluster.area += area;
+            }
+
+            for (std::size_t k{0}; k < 3; ++k)
+            {
+                mesh_centroid[k] += cluster.centroid[k];
+            }
+            mesh_area += cluster.area;
+
+            if (cluster.area > 0.0f)
+            {
+                for (auto& value : cluster.centroid)
+                {
+                    value /= cluster.area;
+                }
+            }
+        }
+
+        if (mesh_area > 0.0f)
+        {
+            for (auto& value : mesh_centroid)
+            {
+                value /= mesh_area;
+            }
+        }
+
+        for (auto& cluster : info)
+        {
+            float length = std::sqrt(dot(cluster.normal, cluster.normal));
+            if (length > 0.0f)
+            {
+                cluster.sort_key =
+                    dot(subtract(cluster.centroid, mesh_centroid), cluster.normal)
+                    / length;
+            }
+        }
+
+        // Clusters that face away from the centre are the most likely occluders, so
+        // they go first.
+        std::vector<std::size_t> order(cluster_count);
+        std::iota(order.begin(), order.end(), std::size_t{0});
+        std::stable_sort(order.begin(),
+                         order.end(),
+                         [&info](std::size_t a, std::size_t b) {
+                             return info[a].sort_key > info[b].sort_key;
+                         });
+
+        std::vector<std::uint32_t> output;
+        output.reserve(indices.size());
+        for (auto c : order)
+        {
+            output.insert(output.end(),
+                          indices.begin() + clusters[c] * 3,
+                          indices.begin() + clusters[c + 1] * 3);
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void optimise_vertex_fetch(std::vector<Vertex>& vertices,
+                               std::span<std::uint32_t> indices)
+    {
+        std::vector<std::uint32_t> remap(vertices.size(), invalid_index);
+        std::vector<Vertex> output;
+        output.reserve(vertices.size());
+
+        for (auto& index : indices)
+        {
+            if (remap[index] == invalid_index)
+            {
+                remap[index] = static_cast<std::uint32_t>(output.size());
+                output.push_back(vertices[index]);
+            }
+
+            index = remap[index];
+        }
+
+        vertices = std::move(output);
+    }
+
+    assets::MeshAsset::MeshletBuffers
+    build_meshlets(std::span<Vertex const> vertices,
+                   std::span<std::uint32_t const> indices,
+                   std::size_t max_vertices,
+                   std::size_t max_triangles)
+    {
+        // Local indices are stored in a byte each.
+        max_vertices  = std::clamp(max_vertices, std::size_t{3}, std::size_t{256});
+        max_triangles = std::max(max_triangles, std::size_t{1});
+
+        assets::MeshAsset::MeshletBuffers buffers;
+        auto& meshlets = buffers.meshlets;
+
+        // Position of each vertex in the current meshlet, if it is in it.
+        std::vector<std::uint32_t> local(vertices.size(), invalid_index);
+
+        assets::MeshAsset::Meshlet meshlet{};
+        auto finish = [&]() {
+            if (meshlet.triangle_count == 0)
+            {
+                return;
+            }
+
+            auto meshlet_vertices = std::span{buffers.vertices}.subspan(
+                meshlet.vertex_offset,
+                meshlet.vertex_count);
+            for (auto vertex : meshlet_vertices)
+            {
+                local[vertex] = invalid_index;
+            }
+
+            compute_meshlet_bounds(meshlet,
+                                   vertices,
+                                   meshlet_vertices,
+                                   std::span{buffers.triangles}.subspan(
+                                       meshlet.triangle_offset * std::size_t{3},
+                                       meshlet.triangle_count * std::size_t{3}));
+            meshlets.push_back(meshlet);
+
+            meshlet                 = {};
+            meshlet.vertex_offset   = static_cast<std::uint32_t>(buffers.vertices.size());
+            meshlet.triangle_offset =
+                static_cast<std::uint32_t>(buffers.triangles.size() / 3);
+        };
+
+        for (std::size_t t{0}; t < indices.size() / 3; ++t)
+        {
+            auto triangle = indices.subspan(t * 3, 3);
+            auto first    = triangle.begin();
+
+            std::size_t new_vertices{0};
+            for (std::size_t k{0}; k < 3; ++k)
+            {
+                bool seen = local[triangle[k]] != invalid_index
+                            || std::find(first, first + k, triangle[k]) != first + k;
+                new_vertices += seen ? 0 : 1;
+            }
+
+            if (meshlet.vertex_count + new_vertices > max_vertices
+                || meshlet.triangle_count == max_triangles)
+            {
+                finish();
+            }
+
+            for (auto vertex : triangle)
+            {
+                if (local[vertex] == invalid_index)
+                {
+                    local[vertex] = meshlet.vertex_count++;
+                    buffers.vertices.push_back(vertex);
+                }
+
+                buffers.triangles.push_back(static_cast<std::uint8_t>(local[vertex]));
+            }
+            ++meshlet.triangle_count;
+        }
+        finish();
+
+        return buffers;
+    }
+} // namespace kass
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <assets/mesh_asset.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace kass
+{
+    // Cache size used when simulating the post-transform vertex cache.
+    static constexpr std::size_t vertex_cache_size{16};
+
+    // Average number of cache misses per triangle, lower is better (0.5 is optimal).
+    float compute_acmr(std::span<std::uint32_t const> indices,
+                       std::size_t cache_size = vertex_cache_size);
+
+    // Average number of cache misses per vertex, lower is better (1.0 is optimal).
+    float compute_atvr(std::span<std::uint32_t const> indices,
+                       std::size_t vertex_count,
+                       std::size_t cache_size = vertex_cache_size);
+
+    // Merges bit-identical vertices and rewrites the indices to match.
+    void weld_vertices(std::vector<assets::Vertex>& vertices,
+                       std::span<std::uint32_t> indices);
+
+    // Reorders triangles for the post-transform cache using Forsyth's algorithm.
+    void optimise_vertex_cache(std::span<std::uint32_t> indices,
+                               std::size_t vertex_count);
+
+    // Reorders clusters of cache-optimised triangles so that those facing out from the
+    // centre of the mesh are drawn first (Sander et al.). Clusters are only split where
+    // the ACMR stays within threshold times that of the input.
+    void optimise_overdraw(std::span<std::uint32_t> indices,
+                           std::span<assets::Vertex const> vertices,
+                           float threshold = 1.05f);
+
+    // Renumbers vertices in order of first use by the index buffer and drops those that
+    // are never referenced.
+    void optimise_vertex_fetch(std::vector<assets::Vertex>& vertices,
+                               std::span<std::uint32_t> indices);
+
+    // Splits the triangles into meshlets in index order, so the input should already be
+    // cache optimised. Each meshlet gets a bounding sphere and a normal cone for culling.
+    assets::MeshAsset::MeshletBuffers
+    build_meshlets(std::span<assets::Vertex const> vertices,
+                   std::span<std::uint32_t const> indices,
+                   std::size_t max_vertices  = assets::MeshAsset::max_meshlet_vertices,
+                   std::size_t max_triangles = assets::MeshAsset::max_meshlet_triangles);
+} // namespace kass
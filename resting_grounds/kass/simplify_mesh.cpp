@@ -0,0 +1,835 @@
+#include "simplify_mesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <tuple>
+
+namespace kass
+{
+    namespace
+    {
+        using assets::Vector3D;
+        using assets::Vertex;
+
+        static constexpr auto invalid_index = std::numeric_limits<std::uint32_t>::max();
+
+        // Open edges are weighted up so the silhouette of borders and seams survives
+        // longer than the interior.
+        static constexpr double edge_weight{4.0};
+
+        enum class VertexKind : std::uint8_t
+        {
+            manifold,
+            border,
+            seam,
+            locked
+        };
+
+        // Sum of squared distances to a set of weighted planes, stored as
+        // x^T A x + 2 b.x + c and normalised by the total weight.
+        struct Quadric
+        {
+            void add_plane(Vector3D<float> const& normal, float distance, double weight)
+            {
+                double n[3] = {normal[0], normal[1], normal[2]};
+                a00 += weight * n[0] * n[0];
+                a11 += weight * n[1] * n[1];
+                a22 += weight * n[2] * n[2];
+                a01 += weight * n[0] * n[1];
+                a02 += weight * n[0] * n[2];
+                a12 += weight * n[1] * n[2];
+                b0 += weight * n[0] * distance;
+                b1 += weight * n[1] * distance;
+                b2 += weight * n[2] * distance;
+                c += weight * distance * distance;
+                w += weight;
+            }
+
+            Quadric& operator+=(Quadric const& other)
+            {
+                a00 += other.a00;
+                a11 += other.a11;
+                a22 += other.a22;
+                a01 += other.a01;
+                a02 += other.a02;
+                a12 += other.a12;
+                b0 += other.b0;
+                b1 += other.b1;
+                b2 += other.b2;
+                c += other.c;
+                w += other.w;
+                return *this;
+            }
+
+            // Mean squared distance from the point to the planes.
+            float error(Vector3D<float> const& p) const
+            {
+                double x = p[0], y = p[1], z = p[2];
+                double r = a00 * x * x + a11 * y * y + a22 * z * z
+                           + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                           + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+                return (w > 0.0) ? static_cast<float>(std::abs(r) / w) : 0.0f;
+            }
+
+            double a00{0.0}, a11{0.0}, a22{0.0}, a01{0.0}, a02{0.0}, a12{0.0};
+            double b0{0.0}, b1{0.0}, b2{0.0}, c{0.0};
+            double w{0.0};
+        };
+
+        struct Collapse
+        {
+            std::uint32_t from;
+            std::uint32_t to;
+            bool bidirectional;
+            float error;
+        };
+
+        Vector3D<float> subtract(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+        }
+
+        Vector3D<float> cross(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return {a[1] * b[2] - a[2] * b[1],
+                    a[2] * b[0] - a[0] * b[2],
+                    a[0] * b[1] - a[1] * b[0]};
+        }
+
+        float dot(Vector3D<float> const& a, Vector3D<float> const& b)
+        {
+            return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+        }
+
+        float normalise(Vector3D<float>& v)
+        {
+            float length = std::sqrt(dot(v, v));
+            if (length > 0.0f)
+            {
+                for (auto& value : v)
+                {
+                    value /= length;
+                }
+            }
+
+            return length;
+        }
+
+        std::uint64_t edge_key(std::uint32_t a, std::uint32_t b)
+        {
+            return (std::uint64_t{a} << 32) | b;
+        }
+
+        bool can_collapse(VertexKind from, VertexKind to)
+        {
+            switch (from)
+            {
+            case VertexKind::manifold:
+                return true;
+            case VertexKind::border:
+                return to == VertexKind::border || to == VertexKind::locked;
+            case VertexKind::seam:
+                return to == VertexKind::seam || to == VertexKind::locked;
+            default:
+                return false;
+            }
+        }
+
+        bool is_open_kind(VertexKind kind)
+        {
+            return kind == VertexKind::border || kind == VertexKind::seam;
+        }
+
+        class Simplifier
+        {
+        public:
+            Simplifier(std::span<Vertex const> vertices,
+                       std::vector<std::uint32_t>& indices) :
+                m_vertices{vertices},
+                m_indices{indices},
+                m_position(vertices.size()),
+                m_wedge(vertices.size()),
+                m_loop(vertices.size(), invalid_index),
+                m_loopback(vertices.size(), invalid_index),
+                m_kind(vertices.size(), VertexKind::locked),
+                m_quadrics(vertices.size())
+            {
+                build_positions();
+                classify_vertices();
+                build_quadrics();
+            }
+
+            float simplify(std::size_t target_index_count, float max_error)
+            {
+                float limit = max_error * max_error;
+                float result{0.0f};
+                while (m_indices.size() > target_index_count)
+                {
+                    auto collapses = pick_collapses();
+                    if (collapses.empty())
+                    {
+                        break;
+                    }
+
+                    std::vector<std::uint32_t> remap(m_vertices.size());
+                    std::iota(remap.begin(), remap.end(), std::uint32_t{0});
+
+                    auto goal =
+                        (m_indices.size() - target_index_count) / std::size_t{3};
+                    float error{0.0f};
+                    if (perform_collapses(collapses, remap, goal, limit, error) == 0)
+                    {
+                        break;
+                    }
+
+                    result = std::max(result, error);
+                    apply_collapses(remap);
+                }
+
+                return std::sqrt(result);
+            }
+
+        private:
+            Vector3D<float> const& position(std::uint32_t vertex) const
+            {
+                return m_vertices[vertex].position;
+            }
+
+            // Vertices with bit-identical positions are grouped under the lowest index,
+            // with a ring through m_wedge linking every vertex in the group.
+            void build_positions()
+            {
+                std::vector<std::uint32_t> order(m_vertices.size());
+                std::iota(order.begin(), order.end(), std::uint32_t{0});
+                std::stable_sort(order.begin(),
+                                 order.end(),
+                                 [this](std::uint32_t a, std::uint32_t b) {
+                                     return position(a) < position(b);
+                                 });
+
+                for (std::size_t i{0}; i < order.size();)
+                {
+                    auto end = i + 1;
+                    auto const& p = position(order[i]);
+                    while (end < order.size() && position(order[end]) == p)
+                    {
+                        ++end;
+                    }
+
+                    for (auto k{i}; k < end; ++k)
+                    {
+                        m_position[order[k]] = order[i];
+                        m_wedge[order[k]]    = order[(k + 1 < end) ? k + 1 : i];
+                    }
+                    i = end;
+                }
+            }
+
+            // An open edge has no twin running the other way between the same vertices.
+            // Each vertex records its open edges in and out; one that has several is
+            // marked by pointing at itself.
+            void classify_vertices()
+            {
+                std::vector<std::uint64_t> edges;
+                std::vector<std::uint64_t> position_edges;
+                edges.reserve(m_indices.size());
+                position_edges.reserve(m_indices.size());
+                for (std::size_t t{0}; t < m_indices.size(); t += 3)
+                {
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        auto a = m_indices[t + k];
+                        auto b = m_indices[t + (k + 1) % 3];
+                        edges.push_back(edge_key(a, b));
+                        position_edges.push_back(edge_key(m_position[a], m_position[b]));
+                    }
+                }
+                std::sort(edges.begin(), edges.end());
+                std::sort(position_edges.begin(), position_edges.end());
+                auto closed = [&position_edges](std::uint32_t a, std::uint32_t b) {
+                    return std::binary_search(position_edges.begin(),
+                                              position_edges.end(),
+                                              edge_key(b, a));
+                };
+
+                for (std::size_t t{0}; t < m_indices.size(); t += 3)
+                {
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        auto a = m_indices[t + k];
+                        auto b = m_indices[t + (k + 1) % 3];
+                        auto reverse = edge_key(b, a);
+                        if (std::binary_search(edges.begin(), edges.end(), reverse))
+                        {
+                            continue;
+                        }
+
+                        m_loop[a]     = (m_loop[a] == invalid_index) ? b : a;
+                        m_loopback[b] = (m_loopback[b] == invalid_index) ? a : b;
+                    }
+                }
+
+                for (std::uint32_t v{0}; v < m_vertices.size(); ++v)
+                {
+                    if (m_position[v] != v)
+                    {
+                        continue;
+                    }
+
+                    auto kind = VertexKind::locked;
+                    auto w    = m_wedge[v];
+                    if (w == v)
+                    {
+                        auto in  = m_loopback[v];
+                        auto out = m_loop[v];
+                        if (in == invalid_index && out == invalid_index)
+                        {
+                            kind = VertexKind::manifold;
+                        }
+                        else if (in != invalid_index && in != v && out != invalid_index
+                                 && out != v)
+                        {
+                            kind = VertexKind::border;
+
+                            // Open only because the neighbours split their attributes,
+                            // as around a pole with a vertex per column. The surface
+                            // is closed, so the vertex moves like an interior one.
+                            if (closed(v, m_position[out]) && closed(m_position[in], v))
+                            {
+                                kind          = VertexKind::manifold;
+                                m_loop[v]     = invalid_index;
+                                m_loopback[v] = invalid_index;
+                            }
+                        }
+                    }
+                    else if (m_wedge[w] == v && is_seam(v, w))
+                    {
+                        kind = VertexKind::seam;
+                    }
+
+                    auto u = v;
+                    do
+                    {
+                        m_kind[u] = kind;
+                        u         = m_wedge[u];
+                    } while (u != v);
+                }
+            }
+
+            // Two vertices form a seam when each has a single open edge in and out and
+            // those edges meet up at the same positions, i.e. the surface is closed and
+            // only the attributes are split.
+            bool is_seam(std::uint32_t v, std::uint32_t w) const
+            {
+                auto valid = [this](std::uint32_t vertex) {
+                    auto in  = m_loopback[vertex];
+                    auto out = m_loop[vertex];
+                    return in != invalid_index && in != vertex && out != invalid_index
+                           && out != vertex;
+                };
+
+                return valid(v) && valid(w)
+                       && m_position[m_loopback[v]] == m_position[m_loop[w]]
+                       && m_position[m_loop[v]] == m_position[m_loopback[w]];
+            }
+
+            // Every position accumulates the planes of its triangles weighted by area,
+            // plus a plane through each open edge perpendicular to its triangle.
+            void build_quadrics()
+            {
+                for (std::size_t t{0}; t < m_indices.size(); t += 3)
+                {
+                    auto const& p0 = position(m_indices[t + 0]);
+                    auto const& p1 = position(m_indices[t + 1]);
+                    auto const& p2 = position(m_indices[t + 2]);
+
+                    auto normal = cross(subtract(p1, p0), subtract(p2, p0));
+                    auto area   = normalise(normal) * 0.5f;
+
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        m_quadrics[m_position[m_indices[t + k]]].add_plane(
+                            normal,
+                            -dot(normal, p0),
+                            area);
+                    }
+
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        auto a = m_indices[t + k];
+                        auto b = m_indices[t + (k + 1) % 3];
+                        if (!is_open_kind(m_kind[a]) || m_loop[a] != b)
+                        {
+                            continue;
+                        }
+
+                        // Both sides of a seam are open, only count it once.
+                        if (m_kind[a] == VertexKind::seam
+                            && m_position[b] > m_position[a])
+                        {
+                            continue;
+                        }
+
+                        auto edge        = subtract(position(b), position(a));
+                        auto edge_normal = cross(edge, normal);
+                        normalise(edge_normal);
+
+                        double weight = dot(edge, edge) * edge_weight;
+                        auto distance = -dot(edge_normal, position(a));
+                        for (auto vertex : {a, b})
+                        {
+                            m_quadrics[m_position[vertex]].add_plane(edge_normal,
+                                                                     distance,
+                                                                     weight);
+                        }
+                    }
+                }
+            }
+
+            std::vector<Collapse> pick_collapses() const
+            {
+                // Border and seam vertices may only slide along their own edges.
+                auto along = [this](std::uint32_t from, std::uint32_t to) {
+                    return !is_open_kind(m_kind[from]) || m_loop[from] == to
+                           || m_loopback[from] == to;
+                };
+
+                std::vector<Collapse> collapses;
+                for (std::size_t t{0}; t < m_indices.size(); t += 3)
+                {
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        auto a = m_indices[t + k];
+                        auto b = m_indices[t + (k + 1) % 3];
+                        if (m_position[a] == m_position[b])
+                        {
+                            continue;
+                        }
+
+                        bool forward  = can_collapse(m_kind[a], m_kind[b]) && along(a, b);
+                        bool backward = can_collapse(m_kind[b], m_kind[a]) && along(b, a);
+                        if (!forward && !backward)
+                        {
+                            continue;
+                        }
+
+                        // Interior edges show up once from each side.
+                        if (m_loop[a] != b && m_position[b] > m_position[a])
+                        {
+                            continue;
+                        }
+
+                        Collapse collapse;
+                        collapse.from          = forward ? a : b;
+                        collapse.to            = forward ? b : a;
+                        collapse.bidirectional = forward && backward;
+                        collapse.error         = 0.0f;
+                        collapses.push_back(collapse);
+                    }
+                }
+
+                for (auto& collapse : collapses)
+                {
+                    collapse.error = m_quadrics[m_position[collapse.from]].error(
+                        position(collapse.to));
+                    if (collapse.bidirectional)
+                    {
+                        auto reverse = m_quadrics[m_position[collapse.to]].error(
+                            position(collapse.from));
+                        if (reverse < collapse.error)
+                        {
+                            std::swap(collapse.from, collapse.to);
+                            collapse.error = reverse;
+                        }
+                    }
+                }
+
+                std::stable_sort(collapses.begin(),
+                                 collapses.end(),
+                                 [](Collapse const& a, Collapse const& b) {
+                                     return a.error < b.error;
+                                 });
+                return collapses;
+            }
+
+            // Triangles around each position, rebuilt every pass.
+            void build_adjacency()
+            {
+                m_offsets.assign(m_vertices.size() + 1, 0);
+                for (auto index : m_indices)
+                {
+                    ++m_offsets[m_position[index] + 1];
+                }
+                std::partial_sum(m_offsets.begin(), m_offsets.end(), m_offsets.begin());
+
+                m_triangles.resize(m_indices.size());
+                auto fill = m_offsets;
+                for (std::size_t i{0}; i < m_indices.size(); ++i)
+                {
+                    m_triangles[fill[m_position[m_indices[i]]]++] =
+                        static_cast<std::uint32_t>(i / 3);
+                }
+            }
+
+            // Position of a corner once the collapses picked so far this pass are done.
+            std::uint32_t current(std::uint32_t vertex,
+                                  std::vector<std::uint32_t> const& remap) const
+            {
+                return m_position[remap[vertex]];
+            }
+
+            std::array<std::uint32_t, 3>
+            current_corners(std::uint32_t triangle,
+                            std::vector<std::uint32_t> const& remap) const
+            {
+                auto t = triangle * std::size_t{3};
+                return {current(m_indices[t], remap),
+                        current(m_indices[t + 1], remap),
+                        current(m_indices[t + 2], remap)};
+            }
+
+            // Positions sharing a surviving triangle with position p. Positions that take
+            // part in a collapse are locked for the rest of the pass, so the triangles of
+            // an unlocked position are still exactly those listed in the adjacency.
+            void gather_ring(std::uint32_t p,
+                             std::vector<std::uint32_t> const& remap,
+                             std::vector<std::uint32_t>& ring) const
+            {
+                ring.clear();
+                for (auto i{m_offsets[p]}; i < m_offsets[p + 1]; ++i)
+                {
+                    auto corners = current_corners(m_triangles[i], remap);
+                    if (corners[0] == corners[1] || corners[1] == corners[2]
+                        || corners[0] == corners[2])
+                    {
+                        continue;
+                    }
+
+                    for (auto corner : corners)
+                    {
+                        if (corner != p)
+                        {
+                            ring.push_back(corner);
+                        }
+                    }
+                }
+
+                std::sort(ring.begin(), ring.end());
+                ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+            }
+
+            // The link condition: the only neighbours p0 and p1 may share are the
+            // opposite corners of the triangles on their edge. Any other common neighbour
+            // would be joined to the merged position by two edges, folding a fin or a
+            // pair of overlapping triangles into the surface.
+            bool breaks_link(std::uint32_t p0,
+                             std::uint32_t p1,
+                             std::vector<std::uint32_t> const& remap)
+            {
+                gather_ring(p0, remap, m_ring);
+                gather_ring(p1, remap, m_other_ring);
+
+                m_shared.clear();
+                std::set_intersection(m_ring.begin(),
+                                      m_ring.end(),
+                                      m_other_ring.begin(),
+                                      m_other_ring.end(),
+                                      std::back_inserter(m_shared));
+
+                m_opposite.clear();
+                for (auto i{m_offsets[p0]}; i < m_offsets[p0 + 1]; ++i)
+                {
+                    auto corners = current_corners(m_triangles[i], remap);
+                    if (std::find(corners.begin(), corners.end(), p1) == corners.end())
+                    {
+                        continue;
+                    }
+
+                    for (auto corner : corners)
+                    {
+                        if (corner != p0 && corner != p1)
+                        {
+                            m_opposite.push_back(corner);
+                        }
+                    }
+                }
+
+                std::sort(m_opposite.begin(), m_opposite.end());
+                return !std::includes(m_opposite.begin(),
+                                      m_opposite.end(),
+                                      m_shared.begin(),
+                                      m_shared.end());
+            }
+
+            // Moving a position onto another must not turn any surviving triangle
+            // around it over. Corners are taken where the collapses already picked this
+            // pass leave them, as those are applied together. Turns of more than about
+            // 75 degrees count too, or a triangle could fold over across two passes.
+            bool flips_triangles(std::uint32_t from,
+                                 std::uint32_t to,
+                                 std::vector<std::uint32_t> const& remap) const
+            {
+                auto target = m_position[to];
+                for (auto i{m_offsets[from]}; i < m_offsets[from + 1]; ++i)
+                {
+                    auto t = m_triangles[i] * std::size_t{3};
+
+                    std::array<Vector3D<float>, 3> before;
+                    std::array<Vector3D<float>, 3> after;
+                    bool collapses{false};
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        auto p     = current(m_indices[t + k], remap);
+                        before[k]  = position(p);
+                        after[k]   = (p == from) ? position(target) : before[k];
+                        collapses |= (p == target);
+                    }
+
+                    if (collapses)
+                    {
+                        continue;
+                    }
+
+                    auto n0 = cross(subtract(before[1], before[0]),
+                                    subtract(before[2], before[0]));
+                    auto n1 =
+                        cross(subtract(after[1], after[0]), subtract(after[2], after[0]));
+                    auto lengths = std::sqrt(dot(n0, n0) * dot(n1, n1));
+                    if (dot(n0, n0) > 0.0f && dot(n0, n1) <= 0.25f * lengths)
+                    {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
+            // Applies the cheapest collapses, touching each position at most once per
+            // pass. The pass stops early once errors climb well past those needed to
+            // reach the goal, so later passes can re-rank with the merged quadrics.
+            std::size_t perform_collapses(std::vector<Collapse> const& collapses,
+                                          std::vector<std::uint32_t>& remap,
+                                          std::size_t goal,
+                                          float limit,
+                                          float& error)
+            {
+                build_adjacency();
+
+                auto goal_index = std::min(goal / 2, collapses.size() - 1);
+                float error_goal = collapses[goal_index].error * 1.5f;
+
+                std::vector<bool> locked(m_vertices.size(), false);
+                std::size_t removed{0};
+                std::size_t performed{0};
+                for (auto const& collapse : collapses)
+                {
+                    if (collapse.error > limit || removed >= goal
+                        || (collapse.error > error_goal && removed > goal / 10))
+                    {
+                        break;
+                    }
+
+                    auto from = collapse.from;
+                    auto to   = collapse.to;
+                    auto p0   = m_position[from];
+                    auto p1   = m_position[to];
+                    if (locked[p0] || locked[p1] || breaks_link(p0, p1, remap)
+                        || flips_triangles(p0, to, remap))
+                    {
+                        continue;
+                    }
+
+                    // The other side of a seam follows along its own open edge.
+                    if (m_kind[from] == VertexKind::seam)
+                    {
+                        auto twin   = m_wedge[from];
+                        auto target =
+                            (m_loop[from] == to) ? m_loopback[twin] : m_loop[twin];
+                        if (target == invalid_index || m_position[target] != p1)
+                        {
+                            continue;
+                        }
+
+                        remap[twin] = target;
+                    }
+
+                    remap[from] = to;
+                    m_quadrics[p1] += m_quadrics[p0];
+                    locked[p0] = true;
+                    locked[p1] = true;
+
+                    removed += (m_kind[from] == VertexKind::border) ? 1 : 2;
+                    error = std::max(error, collapse.error);
+                    ++performed;
+                }
+
+                return performed;
+            }
+
+            void apply_collapses(std::vector<std::uint32_t> const& remap)
+            {
+                std::vector<bool> changed;
+                std::size_t write{0};
+                for (std::size_t t{0}; t < m_indices.size(); t += 3)
+                {
+                    auto a = remap[m_indices[t + 0]];
+                    auto b = remap[m_indices[t + 1]];
+                    auto c = remap[m_indices[t + 2]];
+                    if (m_position[a] == m_position[b] || m_position[b] == m_position[c]
+                        || m_position[a] == m_position[c])
+                    {
+                        continue;
+                    }
+
+                    changed.push_back(a != m_indices[t + 0] || b != m_indices[t + 1]
+                                      || c != m_indices[t + 2]);
+                    m_indices[write++] = a;
+                    m_indices[write++] = b;
+                    m_indices[write++] = c;
+                }
+                m_indices.resize(write);
+
+                remove_coincident_triangles(changed);
+
+                // A collapse along a two-edge loop leaves the target pointing at itself,
+                // in which case the loop skips over the removed vertex.
+                for (auto* loop : {&m_loop, &m_loopback})
+                {
+                    auto& edges = *loop;
+                    for (std::uint32_t v{0}; v < edges.size(); ++v)
+                    {
+                        if (edges[v] == invalid_index)
+                        {
+                            continue;
+                        }
+
+                        auto target = remap[edges[v]];
+                        edges[v]    = (target == v) ? edges[edges[v]] : target;
+                    }
+                }
+            }
+
+            // Collapses that close up a thin region can leave triangles lying on top of
+            // each other. Where a triangle changed by this pass coincides with others,
+            // opposite windings cancel out and at most one of the majority is kept, so
+            // untouched double-sided input is left as it is.
+            void remove_coincident_triangles(std::vector<bool> const& changed)
+            {
+                struct Face
+                {
+                    std::array<std::uint32_t, 3> key;
+                    bool forward;
+                    std::uint32_t triangle;
+                };
+
+                std::vector<Face> faces(m_indices.size() / 3);
+                for (std::size_t t{0}; t < faces.size(); ++t)
+                {
+                    // Rotating the smallest corner to the front keeps the winding.
+                    std::array<std::uint32_t, 3> corners;
+                    std::size_t first{0};
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        corners[k] = m_position[m_indices[t * 3 + k]];
+                        first      = (corners[k] < corners[first]) ? k : first;
+                    }
+
+                    auto b = corners[(first + 1) % 3];
+                    auto c = corners[(first + 2) % 3];
+
+                    faces[t] = {{corners[first], std::min(b, c), std::max(b, c)},
+                                b < c,
+                                static_cast<std::uint32_t>(t)};
+                }
+
+                std::sort(faces.begin(), faces.end(), [](Face const& a, Face const& b) {
+                    return std::tie(a.key, a.triangle) < std::tie(b.key, b.triangle);
+                });
+
+                std::vector<bool> keep(faces.size(), true);
+                for (std::size_t i{0}; i < faces.size();)
+                {
+                    auto end = i + 1;
+                    while (end < faces.size() && faces[end].key == faces[i].key)
+                    {
+                        ++end;
+                    }
+
+                    bool touched{false};
+                    std::ptrdiff_t winding{0};
+                    for (auto k{i}; k < end; ++k)
+                    {
+                        touched |= changed[faces[k].triangle];
+                        winding += faces[k].forward ? 1 : -1;
+                    }
+
+                    if (end - i > 1 && touched)
+                    {
+                        // Keep the first triangle facing the way most of them do, if any.
+                        bool kept{false};
+                        for (auto k{i}; k < end; ++k)
+                        {
+                            auto majority =
+                                winding != 0 && faces[k].forward == (winding > 0);
+                            keep[faces[k].triangle] = majority && !kept;
+                            kept |= majority;
+                        }
+                    }
+                    i = end;
+                }
+
+                std::size_t write{0};
+                for (std::size_t t{0}; t < keep.size(); ++t)
+                {
+                    if (!keep[t])
+                    {
+                        continue;
+                    }
+
+                    for (std::size_t k{0}; k < 3; ++k)
+                    {
+                        m_indices[write++] = m_indices[t * 3 + k];
+                    }
+                }
+                m_indices.resize(write);
+            }
+
+            std::span<Vertex const> m_vertices;
+            std::vector<std::uint32_t>& m_indices;
+
+            std::vector<std::uint32_t> m_position;
+            std::vector<std::uint32_t> m_wedge;
+            std::vector<std::uint32_t> m_loop;
+            std::vector<std::uint32_t> m_loopback;
+            std::vector<VertexKind> m_kind;
+            std::vector<Quadric> m_quadrics;
+
+            std::vector<std::size_t> m_offsets;
+            std::vector<std::uint32_t> m_triangles;
+
+            // Scratch space for breaks_link().
+            std::vector<std::uint32_t> m_ring;
+            std::vector<std::uint32_t> m_other_ring;
+            std::vector<std::uint32_t> m_shared;
+            std::vector<std::uint32_t> m_opposite;
+        };
+    } // namespace
+
+    float simplify_mesh(std::span<Vertex const> vertices,
+                        std::vector<std::uint32_t>& indices,
+                        std::size_t target_index_count,
+                        float max_error)
+    {
+        if (indices.size() <= target_index_count)
+        {
+            return 0.0f;
+        }
+
+        Simplifier simplifier{vertices, indices};
+        return simplifier.simplify(target_index_count, max_error);
+    }
+} // namespace kass
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <assets/vertex_format.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace kass
+{
+    // Collapses edges in order of quadric error until at most target_index_count
+    // indices remain or the next collapse would exceed max_error. Vertices are never
+    // moved or created, so the result still indexes the input vertices. Vertices that
+    // share a position but not their attributes form a seam, which like the mesh border
+    // only collapses along itself.
+    // Errors are the root mean square distance, in mesh units, from a merged vertex to
+    // the planes of the triangles it replaced, weighted by area. That is an estimate of
+    // how far the surface moved rather than a bound on it. Returns the largest error
+    // of the collapses performed.
+    float simplify_mesh(std::span<assets::Vertex const> vertices,
+                        std::vector<std::uint32_t>& indices,
+                        std::size_t target_index_count,
+                        float max_error = std::numeric_limits<float>::max());
+} // namespace kass